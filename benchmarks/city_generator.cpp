@@ -0,0 +1,203 @@
+#include "city_generator.h"
+
+#include "json_writer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace benchmarks
+{
+    using namespace std::string_literals;
+    using namespace std::string_view_literals;
+
+    namespace
+    {
+        struct GridStop
+        {
+            double x = 0;
+            double y = 0;
+        };
+
+        std::string StopName(size_t index_)
+        {
+            return "Stop "s + std::to_string(index_);
+        }
+
+        void WriteRenderSettings(json::Writer& writer_)
+        {
+            writer_.Key("render_settings"sv).StartDict();
+            writer_.Key("width"sv).Value(1200.0).Key("height"sv).Value(1200.0).Key("padding"sv).Value(50.0);
+            writer_.Key("stop_radius"sv).Value(5.0).Key("line_width"sv).Value(14.0);
+            writer_.Key("bus_label_font_size"sv).Value(20).Key("bus_label_offset"sv).StartArray().Value(7.0).Value(15.0).EndArray();
+            writer_.Key("stop_label_font_size"sv).Value(20).Key("stop_label_offset"sv).StartArray().Value(7.0).Value(-3.0).EndArray();
+            writer_.Key("underlayer_color"sv).StartArray().Value(255).Value(255).Value(255).Value(0.85).EndArray();
+            writer_.Key("underlayer_width"sv).Value(3.0);
+            writer_.Key("color_palette"sv).StartArray().Value("green"sv).StartArray().Value(255).Value(160).Value(0).EndArray().Value("red"sv).EndArray();
+            writer_.EndDict();
+        }
+    }//end namespace
+
+    void WriteCity(const CitySettings& settings_, std::ostream& output_)
+    {
+        std::mt19937 random(settings_.seed);
+
+        const auto uniform = [&random](double min_, double max_)
+            {
+                return std::uniform_real_distribution<double>(min_, max_)(random);
+            };
+        const auto index = [&random](size_t size_)
+            {
+                return std::uniform_int_distribution<size_t>(0, size_ - 1)(random);
+            };
+
+        const size_t side = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(settings_.stop_count))));
+        std::vector<GridStop> stops(settings_.stop_count);
+
+        for (size_t i = 0; i < stops.size(); ++i)
+        {
+            stops[i] = { i % side + uniform(-0.3, 0.3), i / side + uniform(-0.3, 0.3) };
+        }
+
+        // Turns are one of the four grid directions; a bus that runs off the grid turns back.
+        static const int DIRECTIONS[4][2] = { { 1, 0 }, { 0, 1 }, { -1, 0 }, { 0, -1 } };
+
+        std::vector<std::vector<size_t>> routes;
+        std::vector<bool> roundtrips;
+        std::map<std::pair<size_t, size_t>, int> distances;
+
+        for (size_t bus = 0; bus < settings_.bus_count; ++bus)
+        {
+            const size_t stop_count = 5 + index(36);
+            long x = static_cast<long>(index(side));
+            long y = static_cast<long>(index(side));
+            const int* direction = DIRECTIONS[index(4)];
+            int dx = direction[0];
+            int dy = direction[1];
+
+            std::vector<size_t> route;
+
+            for (size_t step = 0; step < stop_count * 3 && route.size() < stop_count; ++step)
+            {
+                const bool on_grid = x >= 0 && y >= 0 && x < static_cast<long>(side) && y < static_cast<long>(side);
+                const size_t stop = on_grid ? static_cast<size_t>(y) * side + static_cast<size_t>(x) : stops.size();
+
+                if (stop < stops.size() && std::find(route.begin(), route.end(), stop) == route.end())
+                {
+                    route.push_back(stop);
+                }
+                if (uniform(0, 1) < 0.25)
+                {
+                    direction = DIRECTIONS[index(4)];
+                    dx = direction[0];
+                    dy = direction[1];
+                }
+
+                x += dx;
+                y += dy;
+
+                if (x < 0 || y < 0 || x >= static_cast<long>(side) || y >= static_cast<long>(side))
+                {
+                    dx = -dx;
+                    dy = -dy;
+                    x += 2 * dx;
+                    y += 2 * dy;
+                }
+            }
+
+            if (route.size() < 2)
+            {
+                continue;
+            }
+
+            const bool is_roundtrip = uniform(0, 1) < 0.3;
+
+            if (is_roundtrip)
+            {
+                route.push_back(route.front());
+            }
+
+            for (size_t i = 0; i + 1 < route.size(); ++i)
+            {
+                const GridStop& from = stops[route[i]];
+                const GridStop& to = stops[route[i + 1]];
+                const double meters = std::hypot(from.x - to.x, from.y - to.y) * (20000.0 / side) + 100;
+
+                distances.emplace(std::pair{ route[i], route[i + 1] }, static_cast<int>(meters * uniform(1.0, 1.3)));
+            }
+
+            routes.push_back(std::move(route));
+            roundtrips.push_back(is_roundtrip);
+        }
+
+        json::Writer writer(output_, json::WriterFormat::COMPACT);
+
+        writer.StartDict().Key("base_requests"sv).StartArray();
+
+        for (size_t i = 0; i < stops.size(); ++i)
+        {
+            writer.StartDict();
+            writer.Key("type"sv).Value("Stop"sv).Key("name"sv).Value(StopName(i));
+            writer.Key("latitude"sv).Value(55.5 + stops[i].y * 0.3 / side).Key("longitude"sv).Value(37.4 + stops[i].x * 0.4 / side);
+            writer.Key("road_distances"sv).StartDict();
+
+            for (auto it = distances.lower_bound({ i, 0 }); it != distances.end() && it->first.first == i; ++it)
+            {
+                writer.Key(StopName(it->first.second)).Value(it->second);
+            }
+
+            writer.EndDict().EndDict();
+        }
+
+        for (size_t bus = 0; bus < routes.size(); ++bus)
+        {
+            writer.StartDict();
+            writer.Key("type"sv).Value("Bus"sv).Key("name"sv).Value(std::to_string(bus));
+            writer.Key("stops"sv).StartArray();
+
+            for (const size_t stop : routes[bus])
+            {
+                writer.Value(StopName(stop));
+            }
+
+            writer.EndArray().Key("is_roundtrip"sv).Value(static_cast<bool>(roundtrips[bus])).EndDict();
+        }
+
+        writer.EndArray();
+
+        WriteRenderSettings(writer);
+
+        writer.Key("routing_settings"sv).StartDict().Key("bus_wait_time"sv).Value(6).Key("bus_velocity"sv).Value(40).EndDict();
+        writer.Key("stat_requests"sv).StartArray();
+
+        for (size_t id = 0; id < settings_.request_count; ++id)
+        {
+            const size_t kind = index(5);
+
+            writer.StartDict().Key("id"sv).Value(static_cast<int>(id));
+
+            if (kind == 0 && !routes.empty())
+            {
+                writer.Key("type"sv).Value("Bus"sv).Key("name"sv).Value(std::to_string(index(routes.size())));
+            }
+            else if (kind == 1 || routes.empty())
+            {
+                writer.Key("type"sv).Value("Stop"sv).Key("name"sv).Value(StopName(index(stops.size())));
+            }
+            else
+            {
+                writer.Key("type"sv).Value("Route"sv).Key("from"sv).Value(StopName(index(stops.size()))).Key("to"sv).Value(StopName(index(stops.size())));
+            }
+
+            writer.EndDict();
+        }
+
+        writer.EndArray().EndDict();
+        writer.Flush();
+    }
+
+}//end namespace benchmarks
\ No newline at end of file
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+namespace benchmarks
+{
+    struct CitySettings
+    {
+        size_t stop_count = 500;
+        size_t bus_count = 100;
+        size_t request_count = 200;
+        uint32_t seed = 1;
+    };
+
+    // Writes the input document of a made-up city, the same for the same settings: stops on a
+    // jittered square grid, buses that run between neighbouring stops and now and then turn, road
+    // distances a little longer than straight lines. Stat requests are Bus, Stop and, three times
+    // as often, Route between random stops.
+    void WriteCity(const CitySettings& settings_, std::ostream& output_);
+
+}//end namespace benchmarks
\ No newline at end of file
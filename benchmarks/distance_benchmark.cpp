@@ -0,0 +1,160 @@
+#include "city_generator.h"
+
+#include "json_reader.h"
+#include "transport_router.h"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace std::string_literals;
+
+// Times TransportCatalogue::GetDistanceStop against the unordered_map keyed by Stop* pairs it
+// replaced, which made up to four lookups a call: count then at, in each direction. Both answer
+// the stop pairs next to each other on every bus, as TransportRouter asks for them, and pairs
+// with no distance at all. Also times building a pairwise router, the main user of the lookups.
+//
+// Usage: distance_benchmark [<stops> <buses>]
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+    using StopPair = std::pair<const Stop*, const Stop*>;
+
+    static const int RUNS = 5;
+
+    struct StopPairHasher
+    {
+        size_t operator()(const StopPair& points_) const
+        {
+            const size_t hash_first = std::hash<const void*>{}(points_.first);
+            const size_t hash_second = std::hash<const void*>{}(points_.second);
+            return hash_first ^ (hash_second + 0x9e3779b9 + (hash_first << 6) + (hash_first >> 2));
+        }
+    };
+
+    using DistanceMap = std::unordered_map<StopPair, int, StopPairHasher>;
+
+    size_t GetMapDistance(const DistanceMap& distances_, const Stop* start_, const Stop* finish_)
+    {
+        if (distances_.count({ start_, finish_ }))
+        {
+            return distances_.at({ start_, finish_ });
+        }
+        else if (distances_.count({ finish_, start_ }))
+        {
+            return distances_.at({ finish_, start_ });
+        }
+        return 0;
+    }
+
+    // Best of RUNS passes over pairs_, in nanoseconds per lookup; sum_ keeps the lookups from being optimized away.
+    template <typename Lookup>
+    double TimeLookups(const std::vector<StopPair>& pairs_, Lookup lookup_, size_t& sum_)
+    {
+        double best = 0;
+
+        for (int run = 0; run < RUNS; ++run)
+        {
+            const Clock::time_point start = Clock::now();
+
+            sum_ = 0;
+
+            for (const auto& [from, to] : pairs_)
+            {
+                sum_ += lookup_(from, to);
+            }
+
+            const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            best = run == 0 ? seconds : std::min(best, seconds);
+        }
+        return best * 1e9 / std::max<size_t>(pairs_.size(), 1);
+    }
+}//end namespace
+
+int main(int argc, char* argv[])
+{
+    benchmarks::CitySettings city;
+    city.stop_count = 20000;
+    city.bus_count = 4000;
+    city.request_count = 0;
+
+    if (argc >= 3)
+    {
+        city.stop_count = std::stoul(argv[1]);
+        city.bus_count = std::stoul(argv[2]);
+    }
+
+    std::stringstream document;
+    benchmarks::WriteCity(city, document);
+
+    transport::TransportCatalogue catalogue;
+    std::vector<StatRequest> stat_requests;
+    map_renderer::RenderSettings render_settings;
+    RoutingSettings routing_settings;
+
+    json::JSON_R reader(document, catalogue);
+    reader.Parse(catalogue, stat_requests, render_settings, routing_settings);
+
+    const std::deque<Stop>& stops = catalogue.GetStops();
+    DistanceMap distance_map;
+
+    catalogue.GetDistances().ForEachGiven([&](StopId from_, StopId to_, int distance_)
+        {
+            distance_map.emplace(StopPair{ &stops[from_], &stops[to_] }, distance_);
+        });
+
+    std::vector<StopPair> adjacent_pairs;
+
+    for (BusId bus = 0; bus < catalogue.GetBuses().size(); ++bus)
+    {
+        const auto stop_ids = catalogue.GetBusStopIds(bus);
+
+        for (auto it = stop_ids.begin(); it != stop_ids.end() && std::next(it) != stop_ids.end(); ++it)
+        {
+            adjacent_pairs.emplace_back(&stops[*it], &stops[*std::next(it)]);
+        }
+    }
+
+    // The stops a bus reaches two stops later are seldom given a distance.
+    std::vector<StopPair> missing_pairs;
+
+    for (size_t i = 0; i + 1 < adjacent_pairs.size(); i += 7)
+    {
+        missing_pairs.emplace_back(adjacent_pairs[i].first, adjacent_pairs[i + 1].second);
+    }
+
+    std::cout << stops.size() << " stops, "s << catalogue.GetBuses().size() << " buses, "s << distance_map.size() << " distances given\n"s;
+
+    for (const auto& [name, pairs] : { std::pair{ "adjacent pairs"s, &adjacent_pairs }, std::pair{ "other pairs"s, &missing_pairs } })
+    {
+        size_t table_sum = 0;
+        size_t map_sum = 0;
+
+        const double table_ns = TimeLookups(*pairs, [&catalogue](const Stop* from_, const Stop* to_) { return catalogue.GetDistanceStop(from_->id, to_->id); }, table_sum);
+        const double map_ns = TimeLookups(*pairs, [&distance_map](const Stop* from_, const Stop* to_) { return GetMapDistance(distance_map, from_, to_); }, map_sum);
+
+        std::cout << name << ", "s << pairs->size() << " lookups:\n"s;
+        std::cout << "  unordered_map: "s << map_ns << " ns\n"s;
+        std::cout << "  DistanceTable: "s << table_ns << " ns\n"s;
+
+        if (table_sum != map_sum)
+        {
+            std::cout << "  distances differ: "s << table_sum << " != "s << map_sum << '\n';
+            return 1;
+        }
+    }
+
+    routing_settings.bus_graph_model = BusGraphModel::PAIRWISE;
+
+    const Clock::time_point start = Clock::now();
+    const router::TransportRouter routing(catalogue, routing_settings);
+
+    std::cout << "pairwise router: "s << std::chrono::duration<double>(Clock::now() - start).count() << " s, "s << routing.GetGraph().GetEdgeCount() << " edges\n"s;
+}
\ No newline at end of file
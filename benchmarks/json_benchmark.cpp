@@ -0,0 +1,148 @@
+#include "city_generator.h"
+
+#include "json_reader.h"
+#include "request_handler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std::string_literals;
+
+// Counts heap allocations and times, best of RUNS, the two places json::Node trees are built:
+// json::Load of a whole input document with the tree destroyed afterwards, and
+// RequestHandler::ExecuteQueries building the response document with the router built beforehand.
+// Map requests are left out; Route requests are timed apart, as the search dominates them.
+//
+// Usage: json_benchmark [<stops> <buses> <requests>]
+
+namespace
+{
+    size_t allocation_count = 0;
+
+    static const int RUNS = 3;
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Measure
+    {
+        double seconds = 0;
+        size_t allocations = 0;
+    };
+
+    template <typename Action>
+    Measure MeasureBest(Action action_)
+    {
+        Measure best;
+
+        for (int run = 0; run < RUNS; ++run)
+        {
+            const size_t allocations = allocation_count;
+            const Clock::time_point start = Clock::now();
+
+            action_();
+
+            const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+            if (run == 0 || seconds < best.seconds)
+            {
+                best = { seconds, allocation_count - allocations };
+            }
+        }
+        return best;
+    }
+}//end namespace
+
+void* operator new(size_t size_)
+{
+    ++allocation_count;
+
+    if (void* pointer = std::malloc(size_ == 0 ? 1 : size_))
+    {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer_) noexcept
+{
+    std::free(pointer_);
+}
+
+void operator delete(void* pointer_, size_t) noexcept
+{
+    std::free(pointer_);
+}
+
+int main(int argc, char* argv[])
+{
+    benchmarks::CitySettings city;
+    city.stop_count = 2000;
+    city.bus_count = 400;
+    city.request_count = 10000;
+
+    if (argc >= 4)
+    {
+        city.stop_count = std::stoul(argv[1]);
+        city.bus_count = std::stoul(argv[2]);
+        city.request_count = std::stoul(argv[3]);
+    }
+
+    std::stringstream stream;
+    benchmarks::WriteCity(city, stream);
+    const std::string document = stream.str();
+
+    std::cout << "input: "s << document.size() / 1024 << " KiB\n"s;
+
+    const Measure load = MeasureBest([&document]()
+        {
+            const json::Document tree = json::Load(document);
+        });
+
+    std::cout << "json::Load and destroy: "s << load.seconds << " s, "s << load.allocations << " allocations\n"s;
+
+    transport::TransportCatalogue catalogue;
+    std::vector<StatRequest> stat_requests;
+    map_renderer::RenderSettings render_settings;
+    RoutingSettings routing_settings;
+
+    {
+        std::istringstream input(document);
+        json::JSON_R reader(input, catalogue);
+        reader.Parse(catalogue, stat_requests, render_settings, routing_settings);
+    }
+
+    // Route answers are dominated by the search, so they are timed apart from Bus and Stop.
+    std::vector<StatRequest> lookup_requests;
+    std::vector<StatRequest> route_requests;
+
+    for (const StatRequest& request : stat_requests)
+    {
+        if (request.type == "Route"s)
+        {
+            route_requests.push_back(request);
+        }
+        else if (request.type != "Map"s)
+        {
+            lookup_requests.push_back(request);
+        }
+    }
+
+    const router::TransportRouter routing(catalogue, routing_settings);
+
+    for (const auto& [name, requests] : { std::pair{ "Bus and Stop"s, &lookup_requests }, std::pair{ "Route"s, &route_requests } })
+    {
+        const Measure queries = MeasureBest([&]()
+            {
+                request_handler::RequestHandler handler;
+                handler.ExecuteQueries(catalogue, *requests, render_settings, routing);
+            });
+
+        std::cout << "ExecuteQueries, "s << requests->size() << ' ' << name << " requests: "s << queries.seconds << " s, "s << queries.allocations << " allocations\n"s;
+    }
+}
\ No newline at end of file
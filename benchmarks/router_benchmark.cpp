@@ -0,0 +1,155 @@
+#include "city_generator.h"
+
+#include "json_reader.h"
+#include "transport_router.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std::string_literals;
+
+// Compares the router backends on a generated city: preprocessing time, time per Route query
+// between random stops, and whether every query finds a route of the same weight as ON_DEMAND.
+//
+// Usage: router_benchmark [<stops> <buses> [<queries> [pairwise|ride_chain]]]
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    double Seconds(Clock::time_point start_)
+    {
+        return std::chrono::duration<double>(Clock::now() - start_).count();
+    }
+
+    struct ModeResult
+    {
+        double build_seconds = 0;
+        double query_seconds = 0;
+        size_t shortcut_count = 0;
+        std::vector<std::optional<double>> weights;
+    };
+
+    ModeResult RunMode(const transport::TransportCatalogue& catalogue_, RoutingSettings routing_settings_, graph::RouterMode mode_, const std::vector<std::pair<const Stop*, const Stop*>>& queries_)
+    {
+        ModeResult result;
+        routing_settings_.router_mode = mode_;
+
+        Clock::time_point start = Clock::now();
+        const router::TransportRouter routing(catalogue_, routing_settings_);
+        result.build_seconds = Seconds(start);
+
+        start = Clock::now();
+
+        for (const auto& [from, to] : queries_)
+        {
+            const auto route = routing.GetRouterInfo(routing.GetRouterByStop(from)->bus_wait_start, routing.GetRouterByStop(to)->bus_wait_start);
+            result.weights.push_back(route ? std::optional<double>(route->total_time) : std::nullopt);
+        }
+        result.query_seconds = Seconds(start);
+
+        result.shortcut_count = routing.GetRouter().GetRouterData().hierarchy.shortcut_count;
+
+        return result;
+    }
+
+    size_t CountMatches(const ModeResult& lhs_, const ModeResult& rhs_)
+    {
+        size_t matches = 0;
+
+        for (size_t i = 0; i < lhs_.weights.size(); ++i)
+        {
+            const auto& lhs = lhs_.weights[i];
+            const auto& rhs = rhs_.weights[i];
+
+            if (lhs.has_value() == rhs.has_value() && (!lhs || std::abs(*lhs - *rhs) <= 1e-9 * std::max(1.0, std::abs(*lhs))))
+            {
+                ++matches;
+            }
+        }
+        return matches;
+    }
+}//end namespace
+
+int main(int argc, char* argv[])
+{
+    benchmarks::CitySettings city;
+    size_t query_count = 2000;
+    std::string model = "pairwise"s;
+
+    if (argc >= 3)
+    {
+        city.stop_count = std::stoul(argv[1]);
+        city.bus_count = std::stoul(argv[2]);
+    }
+    if (argc >= 4)
+    {
+        query_count = std::stoul(argv[3]);
+    }
+    if (argc >= 5)
+    {
+        model = argv[4];
+    }
+
+    std::stringstream document;
+    benchmarks::WriteCity(city, document);
+
+    transport::TransportCatalogue catalogue;
+    std::vector<StatRequest> stat_requests;
+    map_renderer::RenderSettings render_settings;
+    RoutingSettings routing_settings;
+
+    json::JSON_R reader(document, catalogue);
+    reader.Parse(catalogue, stat_requests, render_settings, routing_settings);
+
+    routing_settings.bus_graph_model = model == "ride_chain"s ? BusGraphModel::RIDE_CHAIN : BusGraphModel::PAIRWISE;
+
+    const std::deque<Stop>& stops = catalogue.GetStops();
+    std::mt19937 random(city.seed);
+    std::uniform_int_distribution<size_t> stop_index(0, stops.size() - 1);
+    std::vector<std::pair<const Stop*, const Stop*>> queries;
+
+    for (size_t i = 0; i < query_count; ++i)
+    {
+        const Stop* from = &stops[stop_index(random)];
+        queries.emplace_back(from, &stops[stop_index(random)]);
+    }
+
+    std::cout << city.stop_count << " stops, "s << catalogue.GetBuses().size() << " buses, "s << model << " graph, "s << query_count << " Route queries\n"s;
+
+    const std::pair<const char*, graph::RouterMode> modes[] = { { "on_demand", graph::RouterMode::ON_DEMAND }, { "contraction_hierarchy", graph::RouterMode::CONTRACTION_HIERARCHY } };
+    std::optional<ModeResult> reference;
+
+    for (const auto& [name, mode] : modes)
+    {
+        std::cout << name << '\n';
+
+        const ModeResult result = RunMode(catalogue, routing_settings, mode, queries);
+
+        std::cout << "  preprocessing: "s << result.build_seconds << " s\n"s;
+        std::cout << "  query: "s << result.query_seconds * 1e6 / std::max<size_t>(query_count, 1) << " us\n"s;
+
+        if (mode == graph::RouterMode::CONTRACTION_HIERARCHY)
+        {
+            std::cout << "  shortcuts: "s << result.shortcut_count << '\n';
+        }
+
+        if (reference)
+        {
+            std::cout << "  same weight as on_demand: "s << CountMatches(*reference, result) << " of "s << query_count << '\n';
+        }
+        else
+        {
+            reference = result;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,415 @@
+#include "catalogue_view.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace transport
+{
+    using namespace std::string_literals;
+
+    static const size_t IMAGE_ALIGNMENT = 8;
+
+    class ImageWriter
+    {
+    public:
+
+        template <typename T>
+        uint64_t Append(const T* values_, size_t count_)
+        {
+            const uint64_t offset = (bytes.size() + IMAGE_ALIGNMENT - 1) / IMAGE_ALIGNMENT * IMAGE_ALIGNMENT;
+
+            bytes.resize(offset + count_ * sizeof(T));
+
+            if (count_ > 0)
+            {
+                std::memcpy(bytes.data() + offset, values_, count_ * sizeof(T));
+            }
+            return offset;
+        }
+
+        template <typename T>
+        uint64_t Append(const std::vector<T>& values_)
+        {
+            return Append(values_.data(), values_.size());
+        }
+
+        std::vector<char>& GetBytes()
+        {
+            return bytes;
+        }
+
+    private:
+
+        std::vector<char> bytes;
+    };
+
+    class NameInterner
+    {
+    public:
+
+        uint32_t Intern(std::string_view name_)
+        {
+            const auto [it, inserted] = offsets.emplace(name_, static_cast<uint32_t>(names.size()));
+
+            if (inserted)
+            {
+                if (names.size() + name_.size() > std::numeric_limits<uint32_t>::max())
+                {
+                    throw std::length_error("catalogue names do not fit the image"s);
+                }
+                names += name_;
+            }
+            return it->second;
+        }
+
+        const std::string& GetNames() const
+        {
+            return names;
+        }
+
+    private:
+
+        std::string names;
+        std::unordered_map<std::string_view, uint32_t> offsets;
+    };
+
+    namespace
+    {
+        // Perfect hash over the first record of every name, the one the catalogue's GetStop and GetBus
+        // resolve to; later records with the same name stay in the image but are not found by name.
+        perfect_hash::Table BuildNameTable(const std::vector<std::string_view>& names_)
+        {
+            std::unordered_set<std::string_view> seen;
+            std::vector<std::string_view> keys;
+            std::vector<uint32_t> records;
+
+            for (size_t i = 0; i < names_.size(); ++i)
+            {
+                if (seen.insert(names_[i]).second)
+                {
+                    keys.push_back(names_[i]);
+                    records.push_back(static_cast<uint32_t>(i));
+                }
+            }
+
+            perfect_hash::Table table = perfect_hash::Build(keys);
+
+            for (uint32_t& slot : table.slots)
+            {
+                if (slot != perfect_hash::EMPTY_SLOT)
+                {
+                    slot = records[slot];
+                }
+            }
+            return table;
+        }
+    }//end namespace
+
+    std::vector<char> MakeCatalogueImage(const TransportCatalogue& catalogue_)
+    {
+        const std::deque<Stop>& stops = catalogue_.GetStops();
+        const std::deque<Bus>& buses = catalogue_.GetBuses();
+
+        std::vector<std::string_view> stop_names;
+        std::vector<std::string_view> bus_names;
+
+        for (const Stop& stop : stops)
+        {
+            stop_names.push_back(catalogue_.GetStopName(stop.id));
+        }
+        for (const Bus& bus : buses)
+        {
+            bus_names.push_back(catalogue_.GetBusName(bus.id));
+        }
+
+        std::vector<std::vector<image::DistanceRecord>> distance_rows(stops.size());
+
+        catalogue_.GetDistances().ForEachGiven([&distance_rows](StopId from_, StopId to_, int distance_)
+            {
+                distance_rows[from_].push_back({ to_, distance_ });
+            });
+
+        NameInterner interner;
+
+        std::vector<image::StopRecord> stop_records;
+        std::vector<BusIndex> stop_buses;
+        std::vector<image::DistanceRecord> distances;
+
+        for (const Stop& stop : stops)
+        {
+            image::StopRecord record;
+            const geo::Coordinates& coordinates = catalogue_.GetStopCoordinates(stop.id);
+
+            record.latitude = coordinates.latitude;
+            record.longitude = coordinates.longitude;
+            record.name_offset = interner.Intern(stop_names[stop.id]);
+            record.name_size = static_cast<uint32_t>(stop_names[stop.id].size());
+
+            // Already one per name and sorted by name.
+            const ranges::Range<const BusId*> bus_ids = catalogue_.GetStopBusIds(stop.id);
+
+            record.buses_begin = static_cast<uint32_t>(stop_buses.size());
+            stop_buses.insert(stop_buses.end(), bus_ids.begin(), bus_ids.end());
+
+            record.buses_end = static_cast<uint32_t>(stop_buses.size());
+
+            std::vector<image::DistanceRecord>& row = distance_rows[stop_records.size()];
+
+            std::sort(row.begin(), row.end(), [](const image::DistanceRecord& lhs, const image::DistanceRecord& rhs)
+                {
+                    return lhs.to < rhs.to;
+                });
+
+            record.distances_begin = static_cast<uint32_t>(distances.size());
+            distances.insert(distances.end(), row.begin(), row.end());
+            record.distances_end = static_cast<uint32_t>(distances.size());
+
+            stop_records.push_back(record);
+        }
+
+        std::vector<image::BusRecord> bus_records;
+        std::vector<StopIndex> bus_stops;
+
+        for (const Bus& bus : buses)
+        {
+            image::BusRecord record;
+            record.route_length = bus.route_length;
+            record.name_offset = interner.Intern(bus_names[bus.id]);
+            record.name_size = static_cast<uint32_t>(bus_names[bus.id].size());
+            record.is_roundtrip = bus.is_roundtrip;
+            record.stops_begin = static_cast<uint32_t>(bus_stops.size());
+
+            const ranges::Range<const StopId*> stop_ids = catalogue_.GetBusStopIds(bus.id);
+
+            bus_stops.insert(bus_stops.end(), stop_ids.begin(), stop_ids.end());
+
+            record.stops_end = static_cast<uint32_t>(bus_stops.size());
+
+            bus_records.push_back(record);
+        }
+
+        const perfect_hash::Table stop_table = BuildNameTable(stop_names);
+        const perfect_hash::Table bus_table = BuildNameTable(bus_names);
+
+        image::Header header;
+        ImageWriter writer;
+
+        writer.Append(&header, 1);
+
+        header.stop_count = static_cast<uint32_t>(stop_records.size());
+        header.bus_count = static_cast<uint32_t>(bus_records.size());
+        header.bus_stop_count = static_cast<uint32_t>(bus_stops.size());
+        header.stop_bus_count = static_cast<uint32_t>(stop_buses.size());
+        header.distance_count = static_cast<uint32_t>(distances.size());
+        header.stop_seed_count = static_cast<uint32_t>(stop_table.seeds.size());
+        header.stop_slot_count = static_cast<uint32_t>(stop_table.slots.size());
+        header.bus_seed_count = static_cast<uint32_t>(bus_table.seeds.size());
+        header.bus_slot_count = static_cast<uint32_t>(bus_table.slots.size());
+        header.names_size = static_cast<uint32_t>(interner.GetNames().size());
+
+        header.stops_offset = writer.Append(stop_records);
+        header.buses_offset = writer.Append(bus_records);
+        header.bus_stops_offset = writer.Append(bus_stops);
+        header.stop_buses_offset = writer.Append(stop_buses);
+        header.distances_offset = writer.Append(distances);
+        header.stop_seeds_offset = writer.Append(stop_table.seeds);
+        header.stop_slots_offset = writer.Append(stop_table.slots);
+        header.bus_seeds_offset = writer.Append(bus_table.seeds);
+        header.bus_slots_offset = writer.Append(bus_table.slots);
+        header.names_offset = writer.Append(interner.GetNames().data(), interner.GetNames().size());
+
+        std::memcpy(writer.GetBytes().data(), &header, sizeof(header));
+
+        return std::move(writer.GetBytes());
+    }
+
+    template <typename T>
+    const T* CatalogueView::GetSection(uint64_t offset_, size_t count_) const
+    {
+        if (offset_ % alignof(T) != 0 || offset_ > size || count_ > (size - offset_) / sizeof(T))
+        {
+            throw std::runtime_error("catalogue image is corrupted"s);
+        }
+        return reinterpret_cast<const T*>(data + offset_);
+    }
+
+    CatalogueView::CatalogueView(const char* data_, size_t size_) : data(data_), size(size_)
+    {
+        if (reinterpret_cast<uintptr_t>(data_) % IMAGE_ALIGNMENT != 0)
+        {
+            throw std::invalid_argument("catalogue image is not aligned"s);
+        }
+
+        header = GetSection<image::Header>(0, 1);
+        stops = GetSection<image::StopRecord>(header->stops_offset, header->stop_count);
+        buses = GetSection<image::BusRecord>(header->buses_offset, header->bus_count);
+        bus_stops = GetSection<StopIndex>(header->bus_stops_offset, header->bus_stop_count);
+        stop_buses = GetSection<BusIndex>(header->stop_buses_offset, header->stop_bus_count);
+        distances = GetSection<image::DistanceRecord>(header->distances_offset, header->distance_count);
+        names = GetSection<char>(header->names_offset, header->names_size);
+
+        const uint32_t* stop_seeds = GetSection<uint32_t>(header->stop_seeds_offset, header->stop_seed_count);
+        const uint32_t* stop_slots = GetSection<uint32_t>(header->stop_slots_offset, header->stop_slot_count);
+        const uint32_t* bus_seeds = GetSection<uint32_t>(header->bus_seeds_offset, header->bus_seed_count);
+        const uint32_t* bus_slots = GetSection<uint32_t>(header->bus_slots_offset, header->bus_slot_count);
+
+        auto check = [](bool valid_)
+            {
+                if (!valid_)
+                {
+                    throw std::runtime_error("catalogue image is corrupted"s);
+                }
+            };
+
+        auto check_name = [&check, this](uint32_t offset_, uint32_t size_)
+            {
+                check(offset_ <= header->names_size && size_ <= header->names_size - offset_);
+            };
+
+        for (const image::StopRecord& stop : ranges::Range{ stops, stops + header->stop_count })
+        {
+            check_name(stop.name_offset, stop.name_size);
+            check(stop.buses_begin <= stop.buses_end && stop.buses_end <= header->stop_bus_count);
+            check(stop.distances_begin <= stop.distances_end && stop.distances_end <= header->distance_count);
+        }
+        for (const image::BusRecord& bus : ranges::Range{ buses, buses + header->bus_count })
+        {
+            check_name(bus.name_offset, bus.name_size);
+            check(bus.stops_begin <= bus.stops_end && bus.stops_end <= header->bus_stop_count);
+        }
+
+        check(std::all_of(bus_stops, bus_stops + header->bus_stop_count, [this](StopIndex stop_) { return stop_ < header->stop_count; }));
+        check(std::all_of(stop_buses, stop_buses + header->stop_bus_count, [this](BusIndex bus_) { return bus_ < header->bus_count; }));
+        check(std::all_of(distances, distances + header->distance_count, [this](const image::DistanceRecord& distance_) { return distance_.to < header->stop_count; }));
+        check(std::all_of(stop_slots, stop_slots + header->stop_slot_count, [this](uint32_t slot_) { return slot_ == perfect_hash::EMPTY_SLOT || slot_ < header->stop_count; }));
+        check(std::all_of(bus_slots, bus_slots + header->bus_slot_count, [this](uint32_t slot_) { return slot_ == perfect_hash::EMPTY_SLOT || slot_ < header->bus_count; }));
+
+        stop_index = perfect_hash::TableView(stop_seeds, header->stop_seed_count, stop_slots, header->stop_slot_count);
+        bus_index = perfect_hash::TableView(bus_seeds, header->bus_seed_count, bus_slots, header->bus_slot_count);
+    }
+
+    size_t CatalogueView::GetStopCount() const
+    {
+        return header->stop_count;
+    }
+
+    size_t CatalogueView::GetBusCount() const
+    {
+        return header->bus_count;
+    }
+
+    std::string_view CatalogueView::GetName(uint32_t offset_, uint32_t size_) const
+    {
+        return std::string_view(names + offset_, size_);
+    }
+
+    StopView CatalogueView::GetStop(StopIndex index_) const
+    {
+        const image::StopRecord& record = stops[index_];
+
+        return StopView{ index_, GetName(record.name_offset, record.name_size), record.latitude, record.longitude };
+    }
+
+    BusView CatalogueView::GetBus(BusIndex index_) const
+    {
+        const image::BusRecord& record = buses[index_];
+
+        return BusView{ index_, GetName(record.name_offset, record.name_size), record.is_roundtrip != 0, static_cast<size_t>(record.route_length), { bus_stops + record.stops_begin, bus_stops + record.stops_end } };
+    }
+
+    std::string_view CatalogueView::GetBusName(BusIndex index_) const
+    {
+        const image::BusRecord& record = buses[index_];
+
+        return GetName(record.name_offset, record.name_size);
+    }
+
+    std::optional<StopView> CatalogueView::GetStop(std::string_view stop_name_) const
+    {
+        const uint32_t index = stop_index.Find(stop_name_);
+
+        if (index == perfect_hash::EMPTY_SLOT)
+        {
+            return std::nullopt;
+        }
+
+        const StopView stop = GetStop(index);
+
+        if (stop.name != stop_name_)
+        {
+            return std::nullopt;
+        }
+        return stop;
+    }
+
+    std::optional<BusView> CatalogueView::GetBus(std::string_view bus_name_) const
+    {
+        const uint32_t index = bus_index.Find(bus_name_);
+
+        if (index == perfect_hash::EMPTY_SLOT)
+        {
+            return std::nullopt;
+        }
+
+        const BusView bus = GetBus(index);
+
+        if (bus.name != bus_name_)
+        {
+            return std::nullopt;
+        }
+        return bus;
+    }
+
+    ranges::Range<const image::DistanceRecord*> CatalogueView::GetStopDistances(StopIndex stop_) const
+    {
+        const image::StopRecord& record = stops[stop_];
+
+        return ranges::Range<const image::DistanceRecord*>{ distances + record.distances_begin, distances + record.distances_end };
+    }
+
+    std::optional<size_t> CatalogueView::FindDistance(StopIndex start_, StopIndex finish_) const
+    {
+        const auto row = GetStopDistances(start_);
+        const image::DistanceRecord* last = row.end();
+
+        const image::DistanceRecord* it = std::lower_bound(row.begin(), last, finish_, [](const image::DistanceRecord& distance_, StopIndex stop_)
+            {
+                return distance_.to < stop_;
+            });
+
+        if (it == last || it->to != finish_)
+        {
+            return std::nullopt;
+        }
+        return static_cast<size_t>(it->distance);
+    }
+
+    size_t CatalogueView::GetDistanceStop(StopIndex start_, StopIndex finish_) const
+    {
+        if (const auto distance = FindDistance(start_, finish_))
+        {
+            return *distance;
+        }
+        else if (const auto reverse_distance = FindDistance(finish_, start_))
+        {
+            return *reverse_distance;
+        }
+        else
+        {
+            return 0;
+        }
+    }
+
+    ranges::Range<const BusIndex*> CatalogueView::StopGetUniqBuses(StopIndex stop_) const
+    {
+        const image::StopRecord& record = stops[stop_];
+
+        return ranges::Range<const BusIndex*>{ stop_buses + record.buses_begin, stop_buses + record.buses_end };
+    }
+
+}//end namespace transport
\ No newline at end of file
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "transport_catalogue.h"
+#include "perfect_hash.h"
+#include "ranges.h"
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace transport
+{
+    // Stops and buses keep their catalogue ids in the image.
+    using StopIndex = StopId;
+    using BusIndex = BusId;
+
+    // Flat catalogue image, meant to be used in place from a memory-mapped file. Every section is an
+    // array of fixed-size records at an 8-byte aligned offset from the start of the image; names are
+    // interned once into a shared character block and referred to by offset and size.
+    namespace image
+    {
+        struct Header
+        {
+            uint32_t stop_count = 0;
+            uint32_t bus_count = 0;
+            uint32_t bus_stop_count = 0;
+            uint32_t stop_bus_count = 0;
+            uint32_t distance_count = 0;
+            uint32_t stop_seed_count = 0;
+            uint32_t stop_slot_count = 0;
+            uint32_t bus_seed_count = 0;
+            uint32_t bus_slot_count = 0;
+            uint32_t names_size = 0;
+
+            uint64_t stops_offset = 0;
+            uint64_t buses_offset = 0;
+            uint64_t bus_stops_offset = 0;
+            uint64_t stop_buses_offset = 0;
+            uint64_t distances_offset = 0;
+            uint64_t stop_seeds_offset = 0;
+            uint64_t stop_slots_offset = 0;
+            uint64_t bus_seeds_offset = 0;
+            uint64_t bus_slots_offset = 0;
+            uint64_t names_offset = 0;
+        };
+
+        // buses_* index the stop's unique buses, sorted by name; distances_* index its outgoing
+        // road distances, sorted by target stop.
+        struct StopRecord
+        {
+            double latitude = 0.0;
+            double longitude = 0.0;
+            uint32_t name_offset = 0;
+            uint32_t name_size = 0;
+            uint32_t buses_begin = 0;
+            uint32_t buses_end = 0;
+            uint32_t distances_begin = 0;
+            uint32_t distances_end = 0;
+        };
+
+        // stops_* index the full stop sequence of the route, there and back for a non-roundtrip bus.
+        struct BusRecord
+        {
+            uint64_t route_length = 0;
+            uint32_t name_offset = 0;
+            uint32_t name_size = 0;
+            uint32_t stops_begin = 0;
+            uint32_t stops_end = 0;
+            uint32_t is_roundtrip = 0;
+            uint32_t reserved = 0;
+        };
+
+        struct DistanceRecord
+        {
+            StopIndex to = 0;
+            int32_t distance = 0;
+        };
+
+    }//end namespace image
+
+    struct StopView
+    {
+        StopIndex index = 0;
+        std::string_view name;
+        double latitude = 0.0;
+        double longitude = 0.0;
+    };
+
+    struct BusView
+    {
+        BusIndex index = 0;
+        std::string_view name;
+        bool is_roundtrip = false;
+        size_t route_length = 0;
+        ranges::Range<const StopIndex*> stops{ nullptr, nullptr };
+    };
+
+    // Builds the image of a catalogue; stops and buses are numbered in the order they were added.
+    std::vector<char> MakeCatalogueImage(const TransportCatalogue& catalogue_);
+
+    // Read-only catalogue over an image it does not own. Construction checks that every offset and
+    // range stays inside the image and allocates nothing, so opening a mapped file is immediate.
+    class CatalogueView
+    {
+    public:
+
+        CatalogueView(const char* data_, size_t size_);
+
+        size_t GetStopCount() const;
+        size_t GetBusCount() const;
+
+        StopView GetStop(StopIndex index_) const;
+        BusView GetBus(BusIndex index_) const;
+        std::string_view GetBusName(BusIndex index_) const;
+
+        std::optional<StopView> GetStop(std::string_view stop_name_) const;
+        std::optional<BusView> GetBus(std::string_view bus_name_) const;
+
+        // Same fallback as TransportCatalogue: the reverse distance is used when the direct one is not set.
+        size_t GetDistanceStop(StopIndex start_, StopIndex finish_) const;
+        ranges::Range<const BusIndex*> StopGetUniqBuses(StopIndex stop_) const;
+
+        // Road distances set from stop_, exactly as they were given, sorted by target stop.
+        ranges::Range<const image::DistanceRecord*> GetStopDistances(StopIndex stop_) const;
+
+    private:
+
+        const char* data;
+        size_t size;
+
+        const image::Header* header;
+        const image::StopRecord* stops;
+        const image::BusRecord* buses;
+        const StopIndex* bus_stops;
+        const BusIndex* stop_buses;
+        const image::DistanceRecord* distances;
+        const char* names;
+
+        perfect_hash::TableView stop_index;
+        perfect_hash::TableView bus_index;
+
+        template <typename T>
+        const T* GetSection(uint64_t offset_, size_t count_) const;
+
+        std::string_view GetName(uint32_t offset_, uint32_t size_) const;
+        std::optional<size_t> FindDistance(StopIndex start_, StopIndex finish_) const;
+    };
+
+}//end namespace transport
\ No newline at end of file
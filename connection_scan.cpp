@@ -0,0 +1,120 @@
+#include "connection_scan.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace router
+{
+    ConnectionScan::ConnectionScan(TimetableData data_, size_t stop_count_) : data(std::move(data_)), stop_count(stop_count_)
+    {
+        using namespace std::string_literals;
+
+        std::vector<Connection>& connections = data.connections;
+
+        if (connections.size() >= NO_CONNECTION)
+        {
+            throw std::length_error("too many connections in timetable"s);
+        }
+
+        for (const Connection& connection : connections)
+        {
+            if (connection.from >= stop_count || connection.to >= stop_count || connection.trip >= data.trip_buses.size() || !(connection.departure <= connection.arrival))
+            {
+                throw std::invalid_argument("timetable connection is invalid"s);
+            }
+        }
+
+        // A zero-time ride comes before the rides leaving at the moment it arrives; a stable sort keeps
+        // the rides of one trip in order even when they all take no time.
+        const auto is_earlier = [](const Connection& lhs_, const Connection& rhs_)
+            {
+                return lhs_.departure < rhs_.departure || (lhs_.departure == rhs_.departure && lhs_.arrival < rhs_.arrival);
+            };
+
+        if (!std::is_sorted(connections.begin(), connections.end(), is_earlier))
+        {
+            std::stable_sort(connections.begin(), connections.end(), is_earlier);
+        }
+    }
+
+    const ConnectionScan::TimetableData& ConnectionScan::GetTimetableData() const
+    {
+        return data;
+    }
+
+    // A trip is boarded at the first of its connections to leave a reached stop, and then every
+    // later connection of it improves the stops it reaches. The scan stops at the first connection
+    // to leave no earlier than the arrival at to_, since none after it can arrive sooner.
+    std::optional<ConnectionScan::Journey> ConnectionScan::FindEarliestArrival(StopId from_, StopId to_, double departure_) const
+    {
+        if (from_ >= stop_count || to_ >= stop_count)
+        {
+            return std::nullopt;
+        }
+        if (from_ == to_)
+        {
+            return Journey{ departure_, {} };
+        }
+
+        const std::vector<Connection>& connections = data.connections;
+        const auto lease = scan_pool.Acquire([this]() { return ScanData(stop_count, data.trip_buses.size()); });
+        ScanData& scan = *lease;
+
+        scan.NextStamp();
+        scan.Reach(from_, departure_, NO_CONNECTION, NO_CONNECTION);
+
+        const auto first = std::lower_bound(connections.begin(), connections.end(), departure_, [](const Connection& connection_, double time_)
+            {
+                return connection_.departure < time_;
+            });
+
+        for (CompactIndex i = static_cast<CompactIndex>(first - connections.begin()); i < connections.size(); ++i)
+        {
+            const Connection& connection = connections[i];
+
+            if (scan.GetArrival(to_) <= connection.departure)
+            {
+                break;
+            }
+
+            if (scan.trip_stamps[connection.trip] != scan.stamp)
+            {
+                if (!(scan.GetArrival(connection.from) <= connection.departure))
+                {
+                    continue;
+                }
+                scan.trip_stamps[connection.trip] = scan.stamp;
+                scan.trip_boardings[connection.trip] = i;
+            }
+
+            if (connection.arrival < scan.GetArrival(connection.to))
+            {
+                scan.Reach(connection.to, connection.arrival, scan.trip_boardings[connection.trip], i);
+            }
+        }
+
+        if (scan.stop_stamps[to_] != scan.stamp)
+        {
+            return std::nullopt;
+        }
+
+        // The stop a trip was boarded at gains no earlier arrival later on: that would take a connection
+        // scanned after the boarding one to arrive before it leaves. So the legs chain back to from_.
+        Journey journey{ scan.arrivals[to_], {} };
+
+        for (StopId stop = to_; stop != from_; )
+        {
+            const Connection& boarding = connections[scan.boardings[stop]];
+            const Connection& alighting = connections[scan.alightings[stop]];
+
+            journey.legs.push_back({ boarding.from, stop, boarding.departure, alighting.arrival, data.trip_buses[alighting.trip], static_cast<size_t>(alighting.ride - boarding.ride + 1) });
+            stop = boarding.from;
+        }
+
+        std::reverse(journey.legs.begin(), journey.legs.end());
+
+        return journey;
+    }
+
+}//end namespace router
\ No newline at end of file
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "domain.h"
+#include "graph.h"
+#include "scratch_pool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <vector>
+
+namespace router
+{
+    using graph::CompactIndex;
+
+    // Timetabled bus trips cut into connections, each one ride of one trip from a stop to the next,
+    // all held in a single array sorted by departure. The earliest arrival is found by the Connection
+    // Scan Algorithm: one pass over the array from the departure time on, with no graph and no queue.
+    // Changing buses takes no time beyond waiting for the next departure.
+    class ConnectionScan
+    {
+    public:
+
+        // Times are in minutes since midnight; ride is the index of the ride within its trip.
+        struct Connection
+        {
+            double departure = 0;
+            double arrival = 0;
+            StopId from = 0;
+            StopId to = 0;
+            uint32_t trip = 0;
+            uint32_t ride = 0;
+        };
+
+        // Everything a scan needs; a saved one restores the timetable without building it anew.
+        struct TimetableData
+        {
+            std::vector<Connection> connections;
+            std::vector<BusId> trip_buses;
+        };
+
+        // One bus ride of a journey: span_count stops on one trip, boarded at departure.
+        struct Leg
+        {
+            StopId from = 0;
+            StopId to = 0;
+            double departure = 0;
+            double arrival = 0;
+            BusId bus = 0;
+            size_t span_count = 0;
+        };
+
+        struct Journey
+        {
+            double arrival = 0;
+            std::vector<Leg> legs;
+        };
+
+        // Sorts the connections unless they are sorted already. Every stop must be below stop_count_ and
+        // every trip must have its bus in trip_buses.
+        ConnectionScan(TimetableData data_, size_t stop_count_);
+
+        const TimetableData& GetTimetableData() const;
+
+        // Safe to call from several threads at once. Empty if to_ cannot be reached.
+        std::optional<Journey> FindEarliestArrival(StopId from_, StopId to_, double departure_) const;
+
+    private:
+
+        static constexpr CompactIndex NO_CONNECTION = std::numeric_limits<CompactIndex>::max();
+
+        // Per stop, the earliest arrival and the connections it was boarded and alighted at; per trip,
+        // the connection it was boarded at. Valid only under the current stamp, as in graph::Router.
+        struct ScanData
+        {
+            std::vector<double> arrivals;
+            std::vector<CompactIndex> boardings;
+            std::vector<CompactIndex> alightings;
+            std::vector<uint32_t> stop_stamps;
+            std::vector<CompactIndex> trip_boardings;
+            std::vector<uint32_t> trip_stamps;
+            uint32_t stamp = 0;
+
+            ScanData(size_t stop_count_, size_t trip_count_) : arrivals(stop_count_), boardings(stop_count_), alightings(stop_count_), stop_stamps(stop_count_, 0), trip_boardings(trip_count_), trip_stamps(trip_count_, 0) {}
+
+            void NextStamp()
+            {
+                if (++stamp == 0)
+                {
+                    std::fill(stop_stamps.begin(), stop_stamps.end(), 0);
+                    std::fill(trip_stamps.begin(), trip_stamps.end(), 0);
+                    stamp = 1;
+                }
+            }
+
+            double GetArrival(StopId stop_) const
+            {
+                return stop_stamps[stop_] == stamp ? arrivals[stop_] : std::numeric_limits<double>::infinity();
+            }
+
+            void Reach(StopId stop_, double arrival_, CompactIndex boarding_, CompactIndex alighting_)
+            {
+                stop_stamps[stop_] = stamp;
+                arrivals[stop_] = arrival_;
+                boardings[stop_] = boarding_;
+                alightings[stop_] = alighting_;
+            }
+        };
+
+        TimetableData data;
+        size_t stop_count = 0;
+
+        mutable graph::ScratchPool<ScanData> scan_pool;
+    };
+
+}//end namespace router
\ No newline at end of file
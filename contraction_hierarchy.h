@@ -0,0 +1,899 @@
+#pragma once
+
+#include "graph.h"
+#include "scratch_pool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph
+{
+    // Contraction hierarchy over a frozen DirectedWeightedGraph.
+    // Vertices are contracted one by one in order of importance, inserting shortcut edges wherever
+    // the contracted vertex lies on the only shortest path between two remaining neighbours.
+    // A query then runs two Dijkstra searches that only climb to more important vertices:
+    // forward from the source and backward from the target. Shortcuts are unpacked back into the
+    // original edge ids, so callers see the same routes as with a plain search.
+    template <typename Weight>
+    class ContractionHierarchy
+    {
+        using Graph = DirectedWeightedGraph<Weight>;
+
+    private:
+
+        static constexpr size_t NONE = std::numeric_limits<size_t>::max();
+
+    public:
+
+        // Either an original edge (edge_id is set) or a shortcut made of two consecutive hierarchy edges.
+        struct HierarchyEdge
+        {
+            VertexId from = 0;
+            VertexId to = 0;
+            Weight weight = 0;
+            EdgeId edge_id = NONE;
+            size_t first = NONE;
+            size_t second = NONE;
+        };
+
+        // Upward edges of one search direction in compressed form: the edges of vertex v occupy
+        // [offsets[v], offsets[v + 1]) in the targets, weights and hierarchy_edge_ids arrays.
+        struct UpwardGraph
+        {
+            std::vector<size_t> offsets;
+            std::vector<VertexId> targets;
+            std::vector<Weight> weights;
+            std::vector<size_t> hierarchy_edge_ids;
+        };
+
+        // Everything a query needs, so that a hierarchy can be restored without contracting the graph again.
+        struct HierarchyData
+        {
+            std::vector<HierarchyEdge> hierarchy_edges;
+            UpwardGraph forward_graph;
+            UpwardGraph backward_graph;
+            size_t shortcut_count = 0;
+        };
+
+        explicit ContractionHierarchy(const Graph& graph_);
+        ContractionHierarchy(const Graph& graph_, HierarchyData data_);
+
+        struct RouteInfo
+        {
+            Weight weight;
+            std::vector<EdgeId> edges;
+        };
+
+        size_t GetShortcutCount() const;
+        HierarchyData GetHierarchyData() const;
+
+        // Safe to call from several threads at once: each running query takes its own search sides.
+        std::optional<RouteInfo> BuildRoute(VertexId from_, VertexId to_) const;
+        std::optional<TerminalRouteInfo<Weight>> BuildRoute(const std::vector<Terminal<Weight>>& sources_, const std::vector<Terminal<Weight>>& targets_) const;
+
+    private:
+
+        static constexpr size_t WITNESS_SETTLED_LIMIT = 500;
+        static constexpr size_t SIMULATION_SETTLED_LIMIT = 50;
+
+        // Weights of the terms of a vertex priority, see ComputePriority.
+        static constexpr int PRIORITY_EDGE_FACTOR = 2;
+        static constexpr int PRIORITY_HOP_FACTOR = 1;
+        static constexpr int PRIORITY_NEIGHBOUR_FACTOR = 1;
+        static constexpr int PRIORITY_LEVEL_FACTOR = 1;
+        static constexpr Weight ZERO_WEIGHT{};
+
+        struct QueueItem
+        {
+            Weight weight;
+            VertexId vertex;
+
+            bool operator>(const QueueItem& other_) const
+            {
+                return weight > other_.weight;
+            }
+        };
+
+        struct SearchSide
+        {
+            std::vector<Weight> weights;
+            std::vector<size_t> prev_edges;
+            std::vector<uint32_t> stamps;
+            std::vector<QueueItem> queue;
+        };
+
+        // An incidence list entry: the vertex at the other end of a hierarchy edge, its weight and its
+        // index, kept together so that witness searches never look the edge itself up.
+        struct Arc
+        {
+            VertexId vertex;
+            Weight weight;
+            size_t edge_index;
+        };
+
+        struct Preprocessing
+        {
+            std::vector<std::vector<Arc>> out_edges;
+            std::vector<std::vector<Arc>> in_edges;
+            std::vector<bool> contracted;
+            std::vector<int> contracted_neighbours;
+
+            // Number of original edges every hierarchy edge stands for, and the level of every vertex:
+            // one above the highest level among its contracted neighbours.
+            std::vector<int> edge_hops;
+            std::vector<int> levels;
+
+            SearchSide witness;
+            uint32_t witness_stamp = 0;
+
+            // Targets the current witness search still has to find a witness for, marked with witness_stamp,
+            // and the weight of the path through the contracted vertex that a witness must not exceed.
+            std::vector<uint32_t> target_stamps;
+            std::vector<Weight> target_weights;
+            size_t targets_left = 0;
+        };
+
+        const Graph& graph;
+
+        std::vector<HierarchyEdge> hierarchy_edges;
+        std::vector<size_t> ranks;
+        size_t shortcut_count = 0;
+
+        UpwardGraph forward_graph;
+        UpwardGraph backward_graph;
+
+        // Both sides of one query; a vertex is reached by the current query while its stamp equals stamp.
+        struct QuerySearch
+        {
+            SearchSide forward;
+            SearchSide backward;
+            uint32_t stamp = 0;
+        };
+
+        mutable ScratchPool<QuerySearch> search_pool;
+
+        using TerminalRange = ranges::Range<const Terminal<Weight>*>;
+
+        void AddHierarchyEdge(Preprocessing& data_, HierarchyEdge edge_, int hops_)
+        {
+            for (Arc& out_arc : data_.out_edges[edge_.from])
+            {
+                if (out_arc.vertex == edge_.to)
+                {
+                    if (edge_.weight < out_arc.weight)
+                    {
+                        hierarchy_edges[out_arc.edge_index] = edge_;
+                        data_.edge_hops[out_arc.edge_index] = hops_;
+                        out_arc.weight = edge_.weight;
+
+                        for (Arc& in_arc : data_.in_edges[edge_.to])
+                        {
+                            if (in_arc.edge_index == out_arc.edge_index)
+                            {
+                                in_arc.weight = edge_.weight;
+                                break;
+                            }
+                        }
+                    }
+                    return;
+                }
+            }
+
+            const size_t edge_index = hierarchy_edges.size();
+
+            hierarchy_edges.push_back(edge_);
+            data_.edge_hops.push_back(hops_);
+            data_.out_edges[edge_.from].push_back({ edge_.to, edge_.weight, edge_index });
+            data_.in_edges[edge_.to].push_back({ edge_.from, edge_.weight, edge_index });
+        }
+
+        static void NextStamp(SearchSide& side_, uint32_t& stamp_)
+        {
+            if (++stamp_ == 0)
+            {
+                std::fill(side_.stamps.begin(), side_.stamps.end(), 0);
+                stamp_ = 1;
+            }
+        }
+
+        static void ResizeSearchSide(SearchSide& side_, size_t vertex_count_)
+        {
+            side_.weights.resize(vertex_count_);
+            side_.prev_edges.resize(vertex_count_);
+            side_.stamps.assign(vertex_count_, 0);
+        }
+
+        QuerySearch MakeQuerySearch() const
+        {
+            QuerySearch search;
+            ResizeSearchSide(search.forward, graph.GetVertexCount());
+            ResizeSearchSide(search.backward, graph.GetVertexCount());
+            return search;
+        }
+
+        // Bounded Dijkstra from source_ over not yet contracted vertices along edges_ (out_edges, or in_edges
+        // for a search against edge direction), skipping via_. A target is done once it is settled or reached
+        // within its weight, since a tentative weight is already that of a path; the search stops early
+        // once every marked target is done.
+        void RunWitnessSearch(Preprocessing& data_, const std::vector<std::vector<Arc>>& edges_, VertexId source_, VertexId via_, Weight max_weight_, size_t settled_limit_)
+        {
+            SearchSide& side = data_.witness;
+            const uint32_t stamp = data_.witness_stamp;
+
+            side.queue.clear();
+            side.weights[source_] = ZERO_WEIGHT;
+            side.stamps[source_] = stamp;
+            side.queue.push_back({ ZERO_WEIGHT, source_ });
+
+            size_t settled = 0;
+
+            while (!side.queue.empty() && settled < settled_limit_ && data_.targets_left > 0)
+            {
+                std::pop_heap(side.queue.begin(), side.queue.end(), std::greater<>{});
+                const QueueItem item = side.queue.back();
+                side.queue.pop_back();
+
+                if (side.weights[item.vertex] < item.weight)
+                {
+                    continue;
+                }
+                if (item.weight > max_weight_)
+                {
+                    break;
+                }
+                if (data_.target_stamps[item.vertex] == stamp)
+                {
+                    data_.target_stamps[item.vertex] = 0;
+                    --data_.targets_left;
+                }
+                ++settled;
+
+                for (const Arc& arc : edges_[item.vertex])
+                {
+                    if (arc.vertex == via_)
+                    {
+                        continue;
+                    }
+
+                    const Weight candidate_weight = item.weight + arc.weight;
+
+                    if (side.stamps[arc.vertex] != stamp || candidate_weight < side.weights[arc.vertex])
+                    {
+                        side.stamps[arc.vertex] = stamp;
+                        side.weights[arc.vertex] = candidate_weight;
+
+                        if (data_.target_stamps[arc.vertex] == stamp && !(data_.target_weights[arc.vertex] < candidate_weight))
+                        {
+                            data_.target_stamps[arc.vertex] = 0;
+                            --data_.targets_left;
+                        }
+
+                        side.queue.push_back({ candidate_weight, arc.vertex });
+                        std::push_heap(side.queue.begin(), side.queue.end(), std::greater<>{});
+                    }
+                }
+            }
+        }
+
+        // Shortcuts contracting a vertex requires, and the original edges they stand for in all.
+        struct ContractionCost
+        {
+            int shortcuts = 0;
+            int shortcut_hops = 0;
+        };
+
+        // Counts the shortcuts contracting vertex_ requires; adds them unless simulate_ is set.
+        // Witness searches start from the neighbours on the side of vertex_ with fewer of them, against
+        // edge direction when that is the out side, so a vertex many buses ride into but few ride out of
+        // needs one search per edge out rather than per edge in.
+        ContractionCost ContractVertex(Preprocessing& data_, VertexId vertex_, bool simulate_)
+        {
+            ContractionCost cost;
+
+            // Shortcuts added below extend the incidence lists of the neighbours, never of vertex_ itself,
+            // so its own lists can be walked while they are added.
+            const bool is_backward = data_.out_edges[vertex_].size() < data_.in_edges[vertex_].size();
+            const std::vector<Arc>& near_arcs = is_backward ? data_.out_edges[vertex_] : data_.in_edges[vertex_];
+            const std::vector<Arc>& far_arcs = is_backward ? data_.in_edges[vertex_] : data_.out_edges[vertex_];
+            const std::vector<std::vector<Arc>>& search_edges = is_backward ? data_.in_edges : data_.out_edges;
+            const std::vector<std::vector<Arc>>& far_entries = is_backward ? data_.out_edges : data_.in_edges;
+
+            for (const Arc& near_arc : near_arcs)
+            {
+                const VertexId start = near_arc.vertex;
+
+                if (data_.contracted[start] || start == vertex_)
+                {
+                    continue;
+                }
+
+                NextStamp(data_.witness, data_.witness_stamp);
+                data_.targets_left = 0;
+
+                if (data_.witness_stamp == 1)
+                {
+                    std::fill(data_.target_stamps.begin(), data_.target_stamps.end(), 0);
+                }
+
+                Weight max_weight = ZERO_WEIGHT;
+
+                for (const Arc& far_arc : far_arcs)
+                {
+                    const VertexId target = far_arc.vertex;
+
+                    // A target joined only through vertex_ cannot have a witness, so it is not worth searching for.
+                    if (!data_.contracted[target] && target != start && target != vertex_ && far_entries[target].size() > 1)
+                    {
+                        max_weight = std::max(max_weight, near_arc.weight + far_arc.weight);
+
+                        if (data_.target_stamps[target] != data_.witness_stamp)
+                        {
+                            data_.target_stamps[target] = data_.witness_stamp;
+                            data_.target_weights[target] = near_arc.weight + far_arc.weight;
+                            ++data_.targets_left;
+                        }
+                    }
+                }
+
+                RunWitnessSearch(data_, search_edges, start, vertex_, max_weight, simulate_ ? SIMULATION_SETTLED_LIMIT : WITNESS_SETTLED_LIMIT);
+
+                for (const Arc& far_arc : far_arcs)
+                {
+                    const VertexId target = far_arc.vertex;
+                    const Weight via_weight = near_arc.weight + far_arc.weight;
+
+                    if (data_.contracted[target] || target == start || target == vertex_)
+                    {
+                        continue;
+                    }
+                    if (data_.witness.stamps[target] == data_.witness_stamp && data_.witness.weights[target] <= via_weight)
+                    {
+                        continue;
+                    }
+
+                    const Arc& in_arc = is_backward ? far_arc : near_arc;
+                    const Arc& out_arc = is_backward ? near_arc : far_arc;
+                    const int hops = data_.edge_hops[in_arc.edge_index] + data_.edge_hops[out_arc.edge_index];
+
+                    ++cost.shortcuts;
+                    cost.shortcut_hops += hops;
+
+                    if (!simulate_)
+                    {
+                        AddHierarchyEdge(data_, HierarchyEdge{ in_arc.vertex, out_arc.vertex, via_weight, NONE, in_arc.edge_index, out_arc.edge_index }, hops);
+                        ++shortcut_count;
+                    }
+                }
+            }
+
+            return cost;
+        }
+
+        // Drops the edges of a contracted vertex from its neighbours' incidence lists,
+        // which keeps witness searches and duplicate checks from scanning dead edges.
+        void DetachVertex(Preprocessing& data_, VertexId vertex_)
+        {
+            const int level = data_.levels[vertex_] + 1;
+
+            for (const Arc& in_arc : data_.in_edges[vertex_])
+            {
+                auto& source_edges = data_.out_edges[in_arc.vertex];
+
+                ++data_.contracted_neighbours[in_arc.vertex];
+                data_.levels[in_arc.vertex] = std::max(data_.levels[in_arc.vertex], level);
+                source_edges.erase(std::remove_if(source_edges.begin(), source_edges.end(), [&in_arc](const Arc& arc_) { return arc_.edge_index == in_arc.edge_index; }), source_edges.end());
+            }
+            for (const Arc& out_arc : data_.out_edges[vertex_])
+            {
+                auto& target_edges = data_.in_edges[out_arc.vertex];
+
+                ++data_.contracted_neighbours[out_arc.vertex];
+                data_.levels[out_arc.vertex] = std::max(data_.levels[out_arc.vertex], level);
+                target_edges.erase(std::remove_if(target_edges.begin(), target_edges.end(), [&out_arc](const Arc& arc_) { return arc_.edge_index == out_arc.edge_index; }), target_edges.end());
+            }
+        }
+
+        // Edge difference and hop difference of contracting vertex_, its contracted neighbours and its level.
+        // Hops keep shortcuts from growing long before their ends are contracted, and the level keeps
+        // the hierarchy shallow, which bounds both the later witness searches and the query search space.
+        int ComputePriority(Preprocessing& data_, VertexId vertex_)
+        {
+            int degree = 0;
+            int removed_hops = 0;
+
+            // Incidence lists hold no contracted vertices: DetachVertex drops them.
+            for (const Arc& in_arc : data_.in_edges[vertex_])
+            {
+                ++degree;
+                removed_hops += data_.edge_hops[in_arc.edge_index];
+            }
+            for (const Arc& out_arc : data_.out_edges[vertex_])
+            {
+                ++degree;
+                removed_hops += data_.edge_hops[out_arc.edge_index];
+            }
+
+            const ContractionCost cost = ContractVertex(data_, vertex_, true);
+
+            return PRIORITY_EDGE_FACTOR * (cost.shortcuts - degree) + PRIORITY_HOP_FACTOR * (cost.shortcut_hops - removed_hops) + PRIORITY_NEIGHBOUR_FACTOR * data_.contracted_neighbours[vertex_] + PRIORITY_LEVEL_FACTOR * data_.levels[vertex_];
+        }
+
+        void ContractAll(Preprocessing& data_)
+        {
+            const size_t vertex_count = graph.GetVertexCount();
+
+            using PriorityItem = std::pair<int, VertexId>;
+            std::vector<PriorityItem> queue;
+
+            for (VertexId vertex = 0; vertex < vertex_count; ++vertex)
+            {
+                queue.push_back({ ComputePriority(data_, vertex), vertex });
+            }
+            std::make_heap(queue.begin(), queue.end(), std::greater<>{});
+
+            size_t rank = 0;
+
+            while (!queue.empty())
+            {
+                std::pop_heap(queue.begin(), queue.end(), std::greater<>{});
+                const VertexId vertex = queue.back().second;
+                queue.pop_back();
+
+                // Lazy update: priorities go stale as neighbours get contracted.
+                const int priority = ComputePriority(data_, vertex);
+
+                if (!queue.empty() && priority > queue.front().first)
+                {
+                    queue.push_back({ priority, vertex });
+                    std::push_heap(queue.begin(), queue.end(), std::greater<>{});
+                    continue;
+                }
+
+                ContractVertex(data_, vertex, false);
+                data_.contracted[vertex] = true;
+                ranks[vertex] = rank++;
+
+                DetachVertex(data_, vertex);
+            }
+        }
+
+        void BuildUpwardGraphs()
+        {
+            const size_t vertex_count = graph.GetVertexCount();
+
+            forward_graph.offsets.assign(vertex_count + 1, 0);
+            backward_graph.offsets.assign(vertex_count + 1, 0);
+
+            for (const HierarchyEdge& edge : hierarchy_edges)
+            {
+                if (ranks[edge.from] < ranks[edge.to])
+                {
+                    ++forward_graph.offsets[edge.from + 1];
+                }
+                else
+                {
+                    ++backward_graph.offsets[edge.to + 1];
+                }
+            }
+
+            for (VertexId vertex = 0; vertex < vertex_count; ++vertex)
+            {
+                forward_graph.offsets[vertex + 1] += forward_graph.offsets[vertex];
+                backward_graph.offsets[vertex + 1] += backward_graph.offsets[vertex];
+            }
+
+            for (UpwardGraph* upward_graph : { &forward_graph, &backward_graph })
+            {
+                upward_graph->targets.resize(upward_graph->offsets.back());
+                upward_graph->weights.resize(upward_graph->offsets.back());
+                upward_graph->hierarchy_edge_ids.resize(upward_graph->offsets.back());
+            }
+
+            std::vector<size_t> forward_fill(forward_graph.offsets.begin(), std::prev(forward_graph.offsets.end()));
+            std::vector<size_t> backward_fill(backward_graph.offsets.begin(), std::prev(backward_graph.offsets.end()));
+
+            for (size_t edge_index = 0; edge_index < hierarchy_edges.size(); ++edge_index)
+            {
+                const HierarchyEdge& edge = hierarchy_edges[edge_index];
+
+                if (ranks[edge.from] < ranks[edge.to])
+                {
+                    const size_t slot = forward_fill[edge.from]++;
+                    forward_graph.targets[slot] = edge.to;
+                    forward_graph.weights[slot] = edge.weight;
+                    forward_graph.hierarchy_edge_ids[slot] = edge_index;
+                }
+                else
+                {
+                    const size_t slot = backward_fill[edge.to]++;
+                    backward_graph.targets[slot] = edge.from;
+                    backward_graph.weights[slot] = edge.weight;
+                    backward_graph.hierarchy_edge_ids[slot] = edge_index;
+                }
+            }
+        }
+
+        // A restored hierarchy is trusted by queries and by unpacking, so every index is checked here:
+        // upward slots must point at hierarchy edges that join their vertex and target, and every
+        // shortcut must unpack, through consecutive edges and without coming round in a circle, into
+        // edges of the graph.
+        bool IsRestoredDataValid() const
+        {
+            const size_t vertex_count = graph.GetVertexCount();
+            const size_t edge_count = hierarchy_edges.size();
+
+            for (const HierarchyEdge& edge : hierarchy_edges)
+            {
+                if (edge.from >= vertex_count || edge.to >= vertex_count)
+                {
+                    return false;
+                }
+                if (edge.edge_id != NONE)
+                {
+                    if (edge.edge_id >= graph.GetEdgeCount() || graph.GetEdge(edge.edge_id).from != edge.from || graph.GetEdge(edge.edge_id).to != edge.to)
+                    {
+                        return false;
+                    }
+                }
+                else if (edge.first >= edge_count || edge.second >= edge_count || hierarchy_edges[edge.first].from != edge.from || hierarchy_edges[edge.first].to != hierarchy_edges[edge.second].from || hierarchy_edges[edge.second].to != edge.to)
+                {
+                    return false;
+                }
+            }
+
+            // 0 not unpacked yet, 1 being unpacked, 2 known to unpack into graph edges.
+            std::vector<uint8_t> states(edge_count, 0);
+            std::vector<size_t> stack;
+
+            for (size_t root = 0; root < edge_count; ++root)
+            {
+                if (states[root] == 0)
+                {
+                    stack.push_back(root);
+                }
+                while (!stack.empty())
+                {
+                    const size_t edge_index = stack.back();
+                    const HierarchyEdge& edge = hierarchy_edges[edge_index];
+
+                    if (states[edge_index] == 0)
+                    {
+                        states[edge_index] = 1;
+
+                        if (edge.edge_id == NONE)
+                        {
+                            for (const size_t part : { edge.first, edge.second })
+                            {
+                                if (states[part] == 1)
+                                {
+                                    return false;
+                                }
+                                if (states[part] == 0)
+                                {
+                                    stack.push_back(part);
+                                }
+                            }
+                        }
+                    }
+                    else
+                    {
+                        states[edge_index] = 2;
+                        stack.pop_back();
+                    }
+                }
+            }
+
+            for (const bool forward : { true, false })
+            {
+                const UpwardGraph& upward_graph = forward ? forward_graph : backward_graph;
+                const size_t slot_count = upward_graph.targets.size();
+
+                if (upward_graph.offsets.size() != vertex_count + 1 || upward_graph.offsets.front() != 0 || upward_graph.offsets.back() != slot_count || !std::is_sorted(upward_graph.offsets.begin(), upward_graph.offsets.end()) || upward_graph.weights.size() != slot_count || upward_graph.hierarchy_edge_ids.size() != slot_count)
+                {
+                    return false;
+                }
+
+                for (VertexId vertex = 0; vertex < vertex_count; ++vertex)
+                {
+                    for (size_t slot = upward_graph.offsets[vertex]; slot < upward_graph.offsets[vertex + 1]; ++slot)
+                    {
+                        const size_t edge_index = upward_graph.hierarchy_edge_ids[slot];
+
+                        if (edge_index >= edge_count)
+                        {
+                            return false;
+                        }
+
+                        const HierarchyEdge& edge = hierarchy_edges[edge_index];
+                        const VertexId near_end = forward ? edge.from : edge.to;
+                        const VertexId far_end = forward ? edge.to : edge.from;
+
+                        if (near_end != vertex || far_end != upward_graph.targets[slot])
+                        {
+                            return false;
+                        }
+                    }
+                }
+            }
+            return true;
+        }
+
+        // Stall-on-demand: a vertex reached more cheaply through a more important neighbour
+        // cannot lie on a shortest upward path, so its edges need not be relaxed.
+        bool IsStalled(const SearchSide& side_, uint32_t stamp_, const UpwardGraph& opposite_graph_, const QueueItem& item_) const
+        {
+            for (size_t slot = opposite_graph_.offsets[item_.vertex]; slot < opposite_graph_.offsets[item_.vertex + 1]; ++slot)
+            {
+                const VertexId neighbour = opposite_graph_.targets[slot];
+
+                if (side_.stamps[neighbour] == stamp_ && side_.weights[neighbour] + opposite_graph_.weights[slot] < item_.weight)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Settles one vertex of side_ and relaxes its upward edges. Returns false once the side is exhausted
+        // or cannot improve on best_weight_.
+        bool SearchStep(SearchSide& side_, const SearchSide& other_side_, uint32_t stamp_, const UpwardGraph& upward_graph_, const UpwardGraph& opposite_graph_, std::optional<Weight>& best_weight_, VertexId& meeting_vertex_) const
+        {
+            while (!side_.queue.empty())
+            {
+                std::pop_heap(side_.queue.begin(), side_.queue.end(), std::greater<>{});
+                const QueueItem item = side_.queue.back();
+                side_.queue.pop_back();
+
+                if (side_.weights[item.vertex] < item.weight)
+                {
+                    continue;
+                }
+                if (best_weight_ && !(item.weight < *best_weight_))
+                {
+                    side_.queue.clear();
+                    return false;
+                }
+
+                if (other_side_.stamps[item.vertex] == stamp_)
+                {
+                    const Weight through_weight = item.weight + other_side_.weights[item.vertex];
+
+                    if (!best_weight_ || through_weight < *best_weight_)
+                    {
+                        best_weight_ = through_weight;
+                        meeting_vertex_ = item.vertex;
+                    }
+                }
+
+                if (IsStalled(side_, stamp_, opposite_graph_, item))
+                {
+                    return true;
+                }
+
+                for (size_t slot = upward_graph_.offsets[item.vertex]; slot < upward_graph_.offsets[item.vertex + 1]; ++slot)
+                {
+                    const VertexId target = upward_graph_.targets[slot];
+                    const Weight candidate_weight = item.weight + upward_graph_.weights[slot];
+
+                    if (side_.stamps[target] != stamp_ || candidate_weight < side_.weights[target])
+                    {
+                        side_.stamps[target] = stamp_;
+                        side_.weights[target] = candidate_weight;
+                        side_.prev_edges[target] = upward_graph_.hierarchy_edge_ids[slot];
+
+                        side_.queue.push_back({ candidate_weight, target });
+                        std::push_heap(side_.queue.begin(), side_.queue.end(), std::greater<>{});
+                    }
+                }
+                return true;
+            }
+            return false;
+        }
+
+        void UnpackHierarchyEdge(size_t edge_index_, std::vector<EdgeId>& edges_) const
+        {
+            std::vector<size_t> stack{ edge_index_ };
+
+            while (!stack.empty())
+            {
+                const HierarchyEdge& edge = hierarchy_edges[stack.back()];
+                stack.pop_back();
+
+                if (edge.edge_id != NONE)
+                {
+                    edges_.push_back(edge.edge_id);
+                }
+                else
+                {
+                    stack.push_back(edge.second);
+                    stack.push_back(edge.first);
+                }
+            }
+        }
+
+        std::optional<TerminalRouteInfo<Weight>> RunQuery(TerminalRange sources_, TerminalRange targets_) const;
+    };
+
+    template <typename Weight>
+    ContractionHierarchy<Weight>::ContractionHierarchy(const Graph& graph_) : graph(graph_), ranks(graph_.GetVertexCount())
+    {
+        const size_t vertex_count = graph_.GetVertexCount();
+
+        Preprocessing data;
+        data.out_edges.resize(vertex_count);
+        data.in_edges.resize(vertex_count);
+        data.contracted.assign(vertex_count, false);
+        data.contracted_neighbours.assign(vertex_count, 0);
+        data.levels.assign(vertex_count, 0);
+        data.target_stamps.assign(vertex_count, 0);
+        data.target_weights.resize(vertex_count);
+        ResizeSearchSide(data.witness, vertex_count);
+
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex)
+        {
+            const CompactIndex* target = graph_.GetIncidentTargets(vertex).begin();
+            const Weight* weight = graph_.GetIncidentWeights(vertex).begin();
+
+            for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex))
+            {
+                const VertexId to = *target++;
+                const Weight edge_weight = *weight++;
+
+                if (vertex != to)
+                {
+                    AddHierarchyEdge(data, HierarchyEdge{ vertex, to, edge_weight, edge_id, NONE, NONE }, 1);
+                }
+            }
+        }
+
+        ContractAll(data);
+        BuildUpwardGraphs();
+    }
+
+    template <typename Weight>
+    ContractionHierarchy<Weight>::ContractionHierarchy(const Graph& graph_, HierarchyData data_) : graph(graph_), hierarchy_edges(std::move(data_.hierarchy_edges)), shortcut_count(data_.shortcut_count), forward_graph(std::move(data_.forward_graph)), backward_graph(std::move(data_.backward_graph))
+    {
+        using namespace std::string_literals;
+
+        if (!IsRestoredDataValid())
+        {
+            throw std::invalid_argument("hierarchy does not match the graph"s);
+        }
+    }
+
+    template <typename Weight>
+    size_t ContractionHierarchy<Weight>::GetShortcutCount() const
+    {
+        return shortcut_count;
+    }
+
+    template <typename Weight>
+    typename ContractionHierarchy<Weight>::HierarchyData ContractionHierarchy<Weight>::GetHierarchyData() const
+    {
+        return HierarchyData{ hierarchy_edges, forward_graph, backward_graph, shortcut_count };
+    }
+
+    template <typename Weight>
+    std::optional<typename ContractionHierarchy<Weight>::RouteInfo> ContractionHierarchy<Weight>::BuildRoute(VertexId from_, VertexId to_) const
+    {
+        const Terminal<Weight> source{ from_, ZERO_WEIGHT };
+        const Terminal<Weight> target{ to_, ZERO_WEIGHT };
+
+        auto route = RunQuery({ &source, &source + 1 }, { &target, &target + 1 });
+
+        if (!route)
+        {
+            return std::nullopt;
+        }
+        return RouteInfo{ route->weight, std::move(route->edges) };
+    }
+
+    template <typename Weight>
+    std::optional<TerminalRouteInfo<Weight>> ContractionHierarchy<Weight>::BuildRoute(const std::vector<Terminal<Weight>>& sources_, const std::vector<Terminal<Weight>>& targets_) const
+    {
+        if (sources_.empty() || targets_.empty())
+        {
+            return std::nullopt;
+        }
+        return RunQuery({ sources_.data(), sources_.data() + sources_.size() }, { targets_.data(), targets_.data() + targets_.size() });
+    }
+
+    // Each side starts from all of its terminals at once, at their weights, as if from one more vertex
+    // below all others joined to them by edges of those weights.
+    template <typename Weight>
+    std::optional<TerminalRouteInfo<Weight>> ContractionHierarchy<Weight>::RunQuery(TerminalRange sources_, TerminalRange targets_) const
+    {
+        const auto lease = search_pool.Acquire([this]() { return MakeQuerySearch(); });
+        SearchSide& forward_search = lease->forward;
+        SearchSide& backward_search = lease->backward;
+
+        if (++lease->stamp == 0)
+        {
+            std::fill(forward_search.stamps.begin(), forward_search.stamps.end(), 0);
+            std::fill(backward_search.stamps.begin(), backward_search.stamps.end(), 0);
+            lease->stamp = 1;
+        }
+
+        const uint32_t stamp = lease->stamp;
+
+        for (auto [side, terminals] : { std::pair{ &forward_search, sources_ }, std::pair{ &backward_search, targets_ } })
+        {
+            side->queue.clear();
+
+            for (const Terminal<Weight>& terminal : terminals)
+            {
+                if (side->stamps[terminal.vertex] != stamp || terminal.weight < side->weights[terminal.vertex])
+                {
+                    side->weights[terminal.vertex] = terminal.weight;
+                    side->prev_edges[terminal.vertex] = NONE;
+                    side->stamps[terminal.vertex] = stamp;
+                    side->queue.push_back({ terminal.weight, terminal.vertex });
+                }
+            }
+            std::make_heap(side->queue.begin(), side->queue.end(), std::greater<>{});
+        }
+
+        std::optional<Weight> best_weight;
+        VertexId meeting_vertex = sources_.begin()->vertex;
+
+        bool forward_active = true;
+        bool backward_active = true;
+
+        while (forward_active || backward_active)
+        {
+            if (forward_active)
+            {
+                forward_active = SearchStep(forward_search, backward_search, stamp, forward_graph, backward_graph, best_weight, meeting_vertex);
+            }
+            if (backward_active)
+            {
+                backward_active = SearchStep(backward_search, forward_search, stamp, backward_graph, forward_graph, best_weight, meeting_vertex);
+            }
+        }
+
+        if (!best_weight)
+        {
+            return std::nullopt;
+        }
+
+        std::vector<size_t> forward_path;
+        VertexId from = meeting_vertex;
+
+        for (size_t edge_index = forward_search.prev_edges[meeting_vertex]; edge_index != NONE; edge_index = forward_search.prev_edges[from])
+        {
+            forward_path.push_back(edge_index);
+            from = hierarchy_edges[edge_index].from;
+        }
+
+        std::vector<EdgeId> edges;
+        VertexId to = meeting_vertex;
+
+        for (auto it = forward_path.rbegin(); it != forward_path.rend(); ++it)
+        {
+            UnpackHierarchyEdge(*it, edges);
+        }
+        for (size_t edge_index = backward_search.prev_edges[meeting_vertex]; edge_index != NONE; edge_index = backward_search.prev_edges[to])
+        {
+            UnpackHierarchyEdge(edge_index, edges);
+            to = hierarchy_edges[edge_index].to;
+        }
+
+        // Summed edge by edge in path order, exactly as a plain Dijkstra would accumulate it.
+        Weight weight = forward_search.weights[from];
+
+        for (const EdgeId edge_id : edges)
+        {
+            weight += graph.GetEdge(edge_id).weight;
+        }
+        weight += backward_search.weights[to];
+
+        return TerminalRouteInfo<Weight>{ weight, from, to, std::move(edges) };
+    }
+
+}//end namespace graph
\ No newline at end of file
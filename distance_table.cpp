@@ -0,0 +1,94 @@
+#include "distance_table.h"
+
+namespace transport
+{
+    uint64_t DistanceTable::MakeKey(StopId from_, StopId to_)
+    {
+        return (static_cast<uint64_t>(from_) << 32) | to_;
+    }
+
+    // Fibonacci hashing: the top bits of the key times 2^64 / phi pick the slot, which spreads
+    // neighbouring stop ids well apart. Returns the slot of key_, or the empty one it would take.
+    size_t DistanceTable::FindSlot(uint64_t key_) const
+    {
+        const size_t mask = entries.size() - 1;
+        size_t slot = static_cast<size_t>((key_ * 0x9e3779b97f4a7c15ull) >> shift);
+
+        while (entries[slot].state != EntryState::EMPTY && entries[slot].key != key_)
+        {
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+    // Keeps the table at most half full, so probe runs stay short.
+    void DistanceTable::Reserve(size_t count_)
+    {
+        if (count_ * 2 <= entries.size())
+        {
+            return;
+        }
+
+        size_t capacity = entries.empty() ? MIN_CAPACITY : entries.size();
+        int new_shift = 64;
+
+        while (count_ * 2 > capacity)
+        {
+            capacity *= 2;
+        }
+        for (size_t size = capacity; size > 1; size /= 2)
+        {
+            --new_shift;
+        }
+
+        std::vector<Entry> old_entries(capacity);
+        old_entries.swap(entries);
+        shift = new_shift;
+
+        for (const Entry& entry : old_entries)
+        {
+            if (entry.state != EntryState::EMPTY)
+            {
+                entries[FindSlot(entry.key)] = entry;
+            }
+        }
+    }
+
+    void DistanceTable::Set(StopId from_, StopId to_, int distance_)
+    {
+        Reserve(used_count + 2);
+
+        Entry& entry = entries[FindSlot(MakeKey(from_, to_))];
+
+        if (entry.state == EntryState::GIVEN)
+        {
+            return;
+        }
+        if (entry.state == EntryState::EMPTY)
+        {
+            ++used_count;
+        }
+        entry = Entry{ MakeKey(from_, to_), distance_, EntryState::GIVEN };
+
+        Entry& reverse_entry = entries[FindSlot(MakeKey(to_, from_))];
+
+        if (reverse_entry.state == EntryState::EMPTY)
+        {
+            reverse_entry = Entry{ MakeKey(to_, from_), distance_, EntryState::REVERSE };
+            ++used_count;
+        }
+    }
+
+    int DistanceTable::Get(StopId from_, StopId to_) const
+    {
+        if (entries.empty())
+        {
+            return 0;
+        }
+
+        const Entry& entry = entries[FindSlot(MakeKey(from_, to_))];
+
+        return entry.state == EntryState::EMPTY ? 0 : entry.distance;
+    }
+
+}//end namespace transport
\ No newline at end of file
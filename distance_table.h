@@ -0,0 +1,59 @@
+#pragma once
+
+#include "domain.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace transport
+{
+    // Road distances between stops, keyed by pairs of stop ids, in a single open-addressing array
+    // with linear probing. A distance given from one stop to another also answers the way back
+    // until that one is given too, so a lookup is one probe run with no fallback to the reverse pair.
+    class DistanceTable
+    {
+    public:
+
+        enum class EntryState : uint8_t { EMPTY, REVERSE, GIVEN, };
+
+        struct Entry
+        {
+            uint64_t key = 0;
+            int distance = 0;
+            EntryState state = EntryState::EMPTY;
+        };
+
+        // The first distance given for a pair stays, later ones for the same pair are ignored.
+        void Set(StopId from_, StopId to_, int distance_);
+
+        // The distance given from from_ to to_, else the one given from to_ to from_, else 0.
+        int Get(StopId from_, StopId to_) const;
+
+        // Calls action_(from, to, distance) for every distance exactly as it was given, in no particular order.
+        template <typename Action>
+        void ForEachGiven(Action action_) const
+        {
+            for (const Entry& entry : entries)
+            {
+                if (entry.state == EntryState::GIVEN)
+                {
+                    action_(static_cast<StopId>(entry.key >> 32), static_cast<StopId>(entry.key), entry.distance);
+                }
+            }
+        }
+
+    private:
+
+        static constexpr size_t MIN_CAPACITY = 16;
+
+        std::vector<Entry> entries;
+        size_t used_count = 0;
+        int shift = 64;
+
+        static uint64_t MakeKey(StopId from_, StopId to_);
+
+        size_t FindSlot(uint64_t key_) const;
+        void Reserve(size_t count_);
+    };
+
+}//end namespace transport
\ No newline at end of file
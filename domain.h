@@ -2,8 +2,12 @@
 
 #include "geo.h"
 #include "graph.h"
+#include "router.h"
+#include "ranges.h"
 
 #include <algorithm>
+#include <cstdint>
+#include <optional>
 #include <vector>
 #include <string>
 #include <variant>
@@ -17,23 +21,48 @@ struct StatRequest
 
     std::string from;
     std::string to;
+
+    // Route: set where an end is given by coordinates instead of a stop name.
+    std::optional<geo::Coordinates> from_coordinates;
+    std::optional<geo::Coordinates> to_coordinates;
+
+    // NearestStops: the count stops closest to coordinates.
+    geo::Coordinates coordinates;
+    int count = 0;
+
+    // EarliestArrival: from and to name stops, and the rider is at from at departure_time, in minutes since midnight.
+    double departure_time = 0;
+
+    // StopsInBox: the stops with latitude and longitude within those of box_min and box_max.
+    geo::Coordinates box_min;
+    geo::Coordinates box_max;
 };
 
-struct Bus;
+// Stops and buses are numbered densely by the catalogue in the order they are added.
+using StopId = uint32_t;
+using BusId = uint32_t;
+
+// Names, coordinates, routes and the buses through each stop are kept by the catalogue in flat arrays
+// indexed by these ids, not in the structs, so walking them does not chase pointers from one struct to the next.
 struct Stop
 {
-    std::string name;
-    double latitude = 0.0;
-    double longitude = 0.0;
-    std::vector<Bus*> buses;
+    StopId id = 0;
 };
 
 struct Bus
 {
-    std::string name;
     bool is_roundtrip = false;
+
+    // Minutes since midnight at which trips leave the first stop, sorted; the router turns them into
+    // its timetable as it is built, and a saved base keeps that timetable instead of these.
+    std::vector<double> departures;
+
+    // Filled in by the catalogue as the bus is added, so bus queries do not walk the route.
     size_t route_length = 0;
-    std::vector<Stop*> stops;
+    size_t unique_stops = 0;
+    double geo_length = 0.0;
+
+    BusId id = 0;
 };
 
 struct Distance
@@ -43,16 +72,6 @@ struct Distance
     int distance = 0;
 };
 
-struct StopDistancesHasher
-{
-    size_t operator()(const std::pair<const Stop*, const Stop*>& points_) const
-    {
-        size_t hash_first = std::hash<const void*>{}(points_.first);
-        size_t hash_second = std::hash<const void*>{}(points_.second);
-        return hash_first ^ (hash_second + 0x9e3779b9 + (hash_first << 6) + (hash_first >> 2));
-    }
-};
-
 struct BusQueryResult
 {
     std::string_view name;
@@ -63,11 +82,31 @@ struct BusQueryResult
     double curvature = 0.0;
 };
 
+// bus_ids are the buses through the stop, one per name and sorted by name: ids of the catalogue,
+// or indices of the catalogue view, the query ran on.
 struct StopQueryResult
 {
     std::string_view name;
     bool not_found = false;
-    std::vector <std::string> buses_name;
+    ranges::Range<const BusId*> bus_ids{ nullptr, nullptr };
+};
+
+struct NearbyStop
+{
+    std::string_view name;
+    double distance = 0.0;
+};
+
+// Nearest first; every name is a stop name, so any of them can be the end of a Route request.
+struct NearestStopsResult
+{
+    std::vector<NearbyStop> stops;
+};
+
+// Sorted by name.
+struct StopsInBoxResult
+{
+    std::vector<std::string_view> stops;
 };
 
 struct BusEdge
@@ -83,20 +122,59 @@ struct StopEdge
     double time = 0;
 };
 
+// Pieces of a bus trip in the ride-chain graph model, folded back into one BusEdge when a route is reported.
+struct BoardEdge
+{
+    std::string_view bus_name;
+};
+
+struct RideEdge
+{
+    double time = 0;
+};
+
+struct AlightEdge {};
+
+// Walk of a route between coordinates, to its first stop, from its last one, or all the way.
+struct WalkEdge
+{
+    double distance = 0;
+    double time = 0;
+};
+
+using RouterEdge = std::variant<StopEdge, BusEdge, BoardEdge, RideEdge, AlightEdge>;
+
 struct StopVertexPair
 {
     graph::VertexId bus_wait_start;
     graph::VertexId bus_wait_end;
 };
 
+// PAIRWISE adds a bus edge for every ordered pair of stops on a route; RIDE_CHAIN gives every
+// stop position of a route its own vertex, linked by ride edges, so the graph grows linearly.
+// PAIRWISE stays the default: a ride-chain time is summed ride by ride rather than over the
+// whole span at once, so it may differ in the last digits and pick another of two equal routes.
+enum class BusGraphModel { PAIRWISE, RIDE_CHAIN, };
+
 struct RoutingSettings
 {
     double bus_wait_time = 0;
     double bus_velocity = 0;
+    graph::RouterMode router_mode = graph::RouterMode::ON_DEMAND;
+    BusGraphModel bus_graph_model = BusGraphModel::PAIRWISE;
+
+    // Walks on routes between coordinates: km/h, and meters in a straight line per walk.
+    double walking_velocity = 5;
+    double max_walking_distance = 1000;
+};
+
+struct SerializationSettings
+{
+    std::string file;
 };
 
 struct RouteInfo
 {
     double total_time = 0.;
-    std::vector<std::variant<StopEdge, BusEdge>> edges;
+    std::vector<std::variant<StopEdge, BusEdge, WalkEdge>> edges;
 };
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <cmath>
 #include <stdexcept>
 
@@ -47,4 +48,20 @@ namespace geo
         return acos(sin(from.latitude * dr) * sin(to.latitude * dr) + cos(from.latitude * dr) * cos(to.latitude * dr) * cos(abs(from.longitude - to.longitude) * dr)) * earth_rd;
     }
 
+    // Great-circle distance by the haversine formula, which stays accurate at short range. Used where
+    // stops are ranked by distance; ComputeDistance is kept as it is, since the curvature reported for
+    // buses is defined by it, whole-degree longitude differences included.
+    inline double ComputeHaversineDistance(Coordinates from, Coordinates to)
+    {
+        static const double Pi = 3.1415926535;
+        static const double dr = Pi / 180.;
+        static const int earth_rd = 6371000;
+
+        const double latitude_sin = std::sin((to.latitude - from.latitude) * dr / 2);
+        const double longitude_sin = std::sin((to.longitude - from.longitude) * dr / 2);
+        const double chord = latitude_sin * latitude_sin + std::cos(from.latitude * dr) * std::cos(to.latitude * dr) * longitude_sin * longitude_sin;
+
+        return 2 * std::asin(std::sqrt(std::min(1.0, chord))) * earth_rd;
+    }
+
 } // namespace geo
\ No newline at end of file
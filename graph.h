@@ -2,7 +2,13 @@
 
 #include "ranges.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <cstdlib>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 
 namespace graph
@@ -10,6 +16,9 @@ namespace graph
     using VertexId = size_t;
     using EdgeId = size_t;
 
+    // Width of the vertex and edge indices the graph stores internally, which caps a graph at 2^32 - 1 edges.
+    using CompactIndex = uint32_t;
+
     template <typename Weight>
     struct Edge
     {
@@ -18,68 +27,279 @@ namespace graph
         Weight weight = 0;
     };
 
+    // A vertex that a route between two sets of vertices may start or end at, with the weight already
+    // spent reaching it (a source) or still to spend after it (a target).
+    template <typename Weight>
+    struct Terminal
+    {
+        VertexId vertex = 0;
+        Weight weight = 0;
+    };
+
+    // Route between two sets of vertices, from the vertex of one source to that of one target; its
+    // weight counts the weights of both terminals.
+    template <typename Weight>
+    struct TerminalRouteInfo
+    {
+        Weight weight = 0;
+        VertexId from = 0;
+        VertexId to = 0;
+        std::vector<EdgeId> edges;
+    };
+
+    // Compressed sparse row arrays of a frozen graph.
+    template <typename Weight>
+    struct CsrArrays
+    {
+        std::vector<CompactIndex> offsets;
+        std::vector<CompactIndex> targets;
+        std::vector<Weight> weights;
+        std::vector<CompactIndex> edge_ids;
+        std::vector<CompactIndex> edge_slots;
+    };
+
+    // The graph is filled through AddEdge and then frozen into compressed sparse row form:
+    // the outgoing edges of vertex v occupy the slots [offsets[v], offsets[v + 1]), and the
+    // target, weight and id of every slot live in separate contiguous arrays. A frozen graph
+    // is read-only; edge ids stay the same as before freezing. The source of every slot is
+    // derived from the offsets on freezing, so that GetEdge is a few array reads.
     template <typename Weight>
     class DirectedWeightedGraph
     {
     private:
 
-        using IncidenceList = std::vector<EdgeId>;
-        using IncidentEdgesRange = ranges::Range<typename IncidenceList::const_iterator>;
+        using IncidenceList = std::vector<CompactIndex>;
+        using IncidentEdgesRange = ranges::Range<const CompactIndex*>;
 
     public:
 
         DirectedWeightedGraph() = default;
         explicit DirectedWeightedGraph(size_t vertex_count_);
+        // Restores a frozen graph from arrays taken earlier with GetCsrArrays.
+        explicit DirectedWeightedGraph(CsrArrays<Weight> csr_arrays_);
         EdgeId AddEdge(const Edge<Weight>& edge_);
 
+        void Freeze();
+        bool IsFrozen() const;
+
         size_t GetVertexCount() const;
         size_t GetEdgeCount() const;
-        const Edge<Weight>& GetEdge(EdgeId edge_id_) const;
+        Edge<Weight> GetEdge(EdgeId edge_id_) const;
         IncidentEdgesRange GetIncidentEdges(VertexId vertex_) const;
 
+        // Available on a frozen graph only; parallel to GetIncidentEdges.
+        ranges::Range<const CompactIndex*> GetIncidentTargets(VertexId vertex_) const;
+        ranges::Range<const Weight*> GetIncidentWeights(VertexId vertex_) const;
+        const CsrArrays<Weight>& GetCsrArrays() const;
+
     private:
 
         std::vector<Edge<Weight>> edges;
         std::vector<IncidenceList> incidence_lists;
+
+        bool frozen = false;
+        CsrArrays<Weight> csr;
+        std::vector<CompactIndex> sources;
+
+        void FillSources();
+        void CheckFrozen() const;
     };
 
     template <typename Weight>
     DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count_) : incidence_lists(vertex_count_) {}
 
+    template <typename Weight>
+    DirectedWeightedGraph<Weight>::DirectedWeightedGraph(CsrArrays<Weight> csr_arrays_) : frozen(true), csr(std::move(csr_arrays_))
+    {
+        using namespace std::string_literals;
+
+        const size_t edge_count = csr.edge_slots.size();
+
+        if (csr.offsets.empty() || csr.offsets.front() != 0 || csr.offsets.back() != edge_count || csr.targets.size() != edge_count || csr.weights.size() != edge_count || csr.edge_ids.size() != edge_count)
+        {
+            throw std::invalid_argument("inconsistent graph arrays"s);
+        }
+
+        // Arrays that come from outside are trusted no further than this: offsets never decrease,
+        // targets are vertices, and edge ids and slots map one to one onto each other.
+        const size_t vertex_count = csr.offsets.size() - 1;
+
+        if (!std::is_sorted(csr.offsets.begin(), csr.offsets.end()))
+        {
+            throw std::invalid_argument("inconsistent graph arrays"s);
+        }
+
+        for (size_t slot = 0; slot < edge_count; ++slot)
+        {
+            const CompactIndex edge_id = csr.edge_ids[slot];
+
+            if (csr.targets[slot] >= vertex_count || edge_id >= edge_count || csr.edge_slots[edge_id] != slot)
+            {
+                throw std::invalid_argument("inconsistent graph arrays"s);
+            }
+        }
+
+        FillSources();
+    }
+
     template <typename Weight>
     EdgeId DirectedWeightedGraph<Weight>::AddEdge(const Edge<Weight>& edge_)
     {
+        using namespace std::string_literals;
+
+        if (frozen)
+        {
+            throw std::logic_error("unable to add an edge to a frozen graph"s);
+        }
+        if (edges.size() == std::numeric_limits<CompactIndex>::max())
+        {
+            throw std::length_error("too many edges in graph"s);
+        }
+
         edges.push_back(edge_);
 
         const EdgeId id = edges.size() - 1;
 
-        incidence_lists.at(edge_.from).push_back(id);
+        incidence_lists.at(edge_.from).push_back(static_cast<CompactIndex>(id));
 
         return id;
     }
 
+    template <typename Weight>
+    void DirectedWeightedGraph<Weight>::Freeze()
+    {
+        if (frozen)
+        {
+            return;
+        }
+
+        const size_t vertex_count = incidence_lists.size();
+        const size_t edge_count = edges.size();
+
+        csr.offsets.assign(vertex_count + 1, 0);
+
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex)
+        {
+            csr.offsets[vertex + 1] = csr.offsets[vertex] + static_cast<CompactIndex>(incidence_lists[vertex].size());
+        }
+
+        // Incidence lists hold edge ids in insertion order, so filling the slots in id order
+        // reproduces them exactly and they can be released before the slot arrays are allocated.
+        std::vector<IncidenceList>().swap(incidence_lists);
+
+        csr.targets.resize(edge_count);
+        csr.weights.resize(edge_count);
+        csr.edge_ids.resize(edge_count);
+        csr.edge_slots.resize(edge_count);
+
+        std::vector<CompactIndex> next_slots(csr.offsets.begin(), std::prev(csr.offsets.end()));
+
+        for (EdgeId edge_id = 0; edge_id < edge_count; ++edge_id)
+        {
+            const Edge<Weight>& edge = edges[edge_id];
+            const CompactIndex slot = next_slots[edge.from]++;
+
+            csr.targets[slot] = static_cast<CompactIndex>(edge.to);
+            csr.weights[slot] = edge.weight;
+            csr.edge_ids[slot] = static_cast<CompactIndex>(edge_id);
+            csr.edge_slots[edge_id] = slot;
+        }
+
+        std::vector<Edge<Weight>>().swap(edges);
+
+        FillSources();
+        frozen = true;
+    }
+
+    template <typename Weight>
+    bool DirectedWeightedGraph<Weight>::IsFrozen() const
+    {
+        return frozen;
+    }
+
     template <typename Weight>
     size_t DirectedWeightedGraph<Weight>::GetVertexCount() const
     {
-        return incidence_lists.size();
+        return frozen ? csr.offsets.size() - 1 : incidence_lists.size();
     }
 
     template <typename Weight>
     size_t DirectedWeightedGraph<Weight>::GetEdgeCount() const
     {
-        return edges.size();
+        return frozen ? csr.edge_slots.size() : edges.size();
     }
 
     template <typename Weight>
-    const Edge<Weight>& DirectedWeightedGraph<Weight>::GetEdge(EdgeId edge_id_) const
+    Edge<Weight> DirectedWeightedGraph<Weight>::GetEdge(EdgeId edge_id_) const
     {
-        return edges.at(edge_id_);
+        if (!frozen)
+        {
+            return edges.at(edge_id_);
+        }
+
+        const CompactIndex slot = csr.edge_slots.at(edge_id_);
+
+        return Edge<Weight>{ sources[slot], csr.targets[slot], csr.weights[slot] };
     }
 
     template <typename Weight>
     typename DirectedWeightedGraph<Weight>::IncidentEdgesRange DirectedWeightedGraph<Weight>::GetIncidentEdges(VertexId vertex_) const
     {
-        return ranges::AsRange(incidence_lists.at(vertex_));
+        if (!frozen)
+        {
+            const IncidenceList& incidence_list = incidence_lists.at(vertex_);
+            return IncidentEdgesRange{ incidence_list.data(), incidence_list.data() + incidence_list.size() };
+        }
+
+        return IncidentEdgesRange{ csr.edge_ids.data() + csr.offsets[vertex_], csr.edge_ids.data() + csr.offsets[vertex_ + 1] };
+    }
+
+    template <typename Weight>
+    ranges::Range<const CompactIndex*> DirectedWeightedGraph<Weight>::GetIncidentTargets(VertexId vertex_) const
+    {
+        CheckFrozen();
+
+        return ranges::Range<const CompactIndex*>{ csr.targets.data() + csr.offsets[vertex_], csr.targets.data() + csr.offsets[vertex_ + 1] };
+    }
+
+    template <typename Weight>
+    ranges::Range<const Weight*> DirectedWeightedGraph<Weight>::GetIncidentWeights(VertexId vertex_) const
+    {
+        CheckFrozen();
+
+        return ranges::Range<const Weight*>{ csr.weights.data() + csr.offsets[vertex_], csr.weights.data() + csr.offsets[vertex_ + 1] };
+    }
+
+    template <typename Weight>
+    const CsrArrays<Weight>& DirectedWeightedGraph<Weight>::GetCsrArrays() const
+    {
+        CheckFrozen();
+
+        return csr;
+    }
+
+    template <typename Weight>
+    void DirectedWeightedGraph<Weight>::FillSources()
+    {
+        const size_t vertex_count = csr.offsets.size() - 1;
+
+        sources.resize(csr.targets.size());
+
+        for (size_t vertex = 0; vertex < vertex_count; ++vertex)
+        {
+            std::fill(sources.begin() + csr.offsets[vertex], sources.begin() + csr.offsets[vertex + 1], static_cast<CompactIndex>(vertex));
+        }
+    }
+
+    template <typename Weight>
+    void DirectedWeightedGraph<Weight>::CheckFrozen() const
+    {
+        using namespace std::string_literals;
+
+        if (!frozen)
+        {
+            throw std::logic_error("graph is not frozen"s);
+        }
     }
 
 }//end namespace graph
\ No newline at end of file
@@ -1,303 +1,418 @@
 #include "json.h"
+#include "json_scan.h"
+#include "json_writer.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <iterator>
 
 namespace json
 {
     using namespace std::string_literals;
+    using namespace std::string_view_literals;
 
     namespace
     {
-        Node LoadNode(std::istream& input_);
-
-        std::string LoadLiteral(std::istream& input_)
+        static const size_t CHUNK_SIZE = 1 << 16;
+
+        // Recursive descent over a window of the input. It accepts exactly what the character-by-
+        // character stream parser did and reports the same errors; whitespace and plain runs inside
+        // strings are skipped by the vector scans of json_scan.
+        // Over a buffer held in memory the window is the whole buffer; over a stream it holds one chunk
+        // at a time, refilled when a scan reaches its end, so memory stays bounded by the longest token.
+        class BufferParser
         {
-            std::string str;
+        public:
 
-            while (std::isalpha(input_.peek()))
-            {
-                str.push_back(static_cast<char>(input_.get()));
-            }
-            return str;
-        }
+            BufferParser(std::string_view input_, Handler& handler_) : position(input_.data()), end(input_.data() + input_.size()), handler(handler_) {}
 
-        Node LoadArray(std::istream& input_)
-        {
-            std::vector<Node> array;
+            BufferParser(std::istream& input_, Handler& handler_) : input(&input_), position(nullptr), end(nullptr), handler(handler_) {}
 
-            for (char ch; input_ >> ch && ch != ']';)
+            void ParseNode()
             {
-                if (ch != ',')
+                char ch;
+
+                if (!ReadChar(ch))
                 {
-                    input_.putback(ch);
+                    throw ParsingError(""s);
+                }
+                else
+                {
+                    switch (ch)
+                    {
+                    case '[':
+                    {
+                        ParseArray();
+                        break;
+                    }
+                    case '{':
+                    {
+                        ParseDictionary();
+                        break;
+                    }
+                    case '"':
+                    {
+                        handler.OnString(LoadString());
+                        break;
+                    }
+                    case 't':  case 'f':
+                    {
+                        --position;
+                        ParseBool();
+                        break;
+                    }
+                    case 'n':
+                    {
+                        --position;
+                        ParseNull();
+                        break;
+                    }
+                    default:
+                    {
+                        --position;
+                        ParseNumber();
+                        break;
+                    }
+                    }
                 }
-                array.push_back(LoadNode(input_));
-            }
-            if (!input_)
-            {
-                throw ParsingError("unable to parse array"s);
             }
-            return Node(array);
-        }
 
-        Node LoadNull(std::istream& input_)
-        {
-            if (std::string literal = LoadLiteral(input_); literal == "null"s)
-            {
-                return Node(nullptr);
-            }
-            else
-            {
-                throw ParsingError("unable to parse '"s + literal + "' as null"s);
-            }
-        }
+        private:
 
-        Node LoadBool(std::istream& input_)
-        {
-            const std::string str = LoadLiteral(input_);
+            std::istream* input = nullptr;
+            std::string window;
 
-            if (str == "true"s)
-            {
-                return Node(true);
-            }
-            else if (str == "false"s)
-            {
-                return Node(false);
-            }
-            else
-            {
-                throw ParsingError("unable to parse '"s + str + "' as bool"s);
-            }
-        }
+            const char* position;
+            const char* end;
 
-        Node LoadNumber(std::istream& input_)
-        {
-            std::string number;
+            // Start of the number or literal being read, kept in the window when it is refilled.
+            const char* token = nullptr;
 
-            auto read_char = [&number, &input_]
+            // Strings with escapes, and all strings read from a stream, are assembled here.
+            std::string scratch;
+
+            Handler& handler;
+
+            // Moves the unread part of the window, from the current token on, to its front and reads the
+            // next chunk of the stream after it. False at the end of the stream or of an in-memory buffer.
+            bool Refill()
+            {
+                if (!input)
                 {
-                    number += static_cast<char>(input_.get());
+                    return false;
+                }
 
-                    if (!input_)
-                    {
-                        throw ParsingError("unable to read number"s);
-                    }
-                };
+                const char* keep = token ? token : position;
+                const size_t kept = end - keep;
 
-            auto read_digits = [&input_, read_char]
+                if (window.size() < kept + CHUNK_SIZE)
                 {
-                    if (!std::isdigit(input_.peek()))
-                    {
-                        throw ParsingError("digit expected"s);
-                    }
-                    else
-                    {
-                        while (std::isdigit(input_.peek()))
-                        {
-                            read_char();
-                        }
-                    }
-                };
+                    std::string grown(kept + CHUNK_SIZE, '\0');
+                    std::copy(keep, end, grown.data());
+                    window.swap(grown);
+                }
+                else if (kept > 0)
+                {
+                    std::memmove(window.data(), keep, kept);
+                }
 
-            if (input_.peek() == '-')
-            {
-                read_char();
-            }
-            if (input_.peek() == '0')
-            {
-                read_char();
+                position = window.data() + (position - keep);
+                token = token ? window.data() : nullptr;
+                end = window.data() + kept;
+
+                const std::streamsize count = input->rdbuf()->sgetn(window.data() + kept, CHUNK_SIZE);
+
+                if (count <= 0)
+                {
+                    input->setstate(std::ios::eofbit);
+                    return false;
+                }
+                end += count;
+                return true;
             }
-            else
+
+            // Same as input_ >> ch_: skips whitespace and takes the next character; ch_ is left
+            // untouched at the end of the input.
+            bool ReadChar(char& ch_)
             {
-                read_digits();
-            }
+                position = scan::SkipWhitespace(position, end);
 
-            bool is_int = true;
+                while (position == end)
+                {
+                    if (!Refill())
+                    {
+                        return false;
+                    }
+                    position = scan::SkipWhitespace(position, end);
+                }
+                ch_ = *position++;
+                return true;
+            }
 
-            if (input_.peek() == '.')
+            int Peek()
             {
-                read_char();
-                read_digits();
-                is_int = false;
+                if (position == end && !Refill())
+                {
+                    return std::char_traits<char>::eof();
+                }
+                return static_cast<unsigned char>(*position);
             }
-            if (int ch = input_.peek(); ch == 'e' || ch == 'E')
+
+            std::string_view LoadLiteral()
             {
-                read_char();
+                token = position;
 
-                if (ch = input_.peek(); ch == '+' || ch == '-')
+                while (std::isalpha(Peek()))
                 {
-                    read_char();
+                    ++position;
                 }
 
-                read_digits();
-                is_int = false;
+                const std::string_view literal(token, position - token);
+                token = nullptr;
+                return literal;
             }
-            try
+
+            void ParseArray()
             {
-                if (is_int)
+                handler.OnStartArray();
+
+                char ch;
+                bool is_read = false;
+
+                while ((is_read = ReadChar(ch)) && ch != ']')
                 {
-                    try
+                    if (ch != ',')
                     {
-                        return Node(std::stoi(number));
-
+                        --position;
                     }
-                    catch (...) {}
+                    ParseNode();
                 }
-                return Node(std::stod(number));
-
+                if (!is_read)
+                {
+                    throw ParsingError("unable to parse array"s);
+                }
+                handler.OnEndArray();
             }
-            catch (...)
+
+            void ParseNull()
             {
-                throw ParsingError("unable to convert "s + number + " to number"s);
+                if (const std::string_view literal = LoadLiteral(); literal == "null"sv)
+                {
+                    handler.OnNull();
+                }
+                else
+                {
+                    throw ParsingError("unable to parse '"s + std::string(literal) + "' as null"s);
+                }
             }
-        }
 
-        Node LoadString(std::istream& input_)
-        {
-            auto it = std::istreambuf_iterator<char>(input_);
-            auto end = std::istreambuf_iterator<char>();
-            std::string str;
+            void ParseBool()
+            {
+                const std::string_view str = LoadLiteral();
+
+                if (str == "true"sv)
+                {
+                    handler.OnBool(true);
+                }
+                else if (str == "false"sv)
+                {
+                    handler.OnBool(false);
+                }
+                else
+                {
+                    throw ParsingError("unable to parse '"s + std::string(str) + "' as bool"s);
+                }
+            }
 
-            while (true)
+            void ReadDigits()
             {
-                if (it == end)
+                if (!std::isdigit(Peek()))
                 {
-                    throw ParsingError("unable to parse string"s);
+                    throw ParsingError("digit expected"s);
                 }
+                while (std::isdigit(Peek()))
+                {
+                    ++position;
+                }
+            }
+
+            void ParseNumber()
+            {
+                token = position;
 
-                const char ch = *it;
-                if (ch == '"')
+                if (Peek() == '-')
                 {
-                    ++it;
-                    break;
+                    ++position;
                 }
-                else if (ch == '\\')
+                if (Peek() == '0')
                 {
-                    ++it;
-                    if (it == end)
-                    {
-                        throw ParsingError("unable to parse string"s);
-                    }
+                    ++position;
+                }
+                else
+                {
+                    ReadDigits();
+                }
 
-                    const char esc_ch = *(it);
+                bool is_int = true;
 
-                    switch (esc_ch)
+                if (Peek() == '.')
+                {
+                    ++position;
+                    ReadDigits();
+                    is_int = false;
+                }
+                if (int ch = Peek(); ch == 'e' || ch == 'E')
+                {
+                    ++position;
+
+                    if (ch = Peek(); ch == '+' || ch == '-')
                     {
-                    case 'n':
-                        str.push_back('\n');
-                        break;
-                    case 't':
-                        str.push_back('\t');
-                        break;
-                    case 'r':
-                        str.push_back('\r');
-                        break;
-                    case '"':
-                        str.push_back('"');
-                        break;
-                    case '\\':
-                        str.push_back('\\');
-                        break;
-                    default:
-                        throw ParsingError("invalid esc \\"s + esc_ch);
+                        ++position;
                     }
 
+                    ReadDigits();
+                    is_int = false;
                 }
-                else if (ch == '\n' || ch == '\r')
+
+                const char* begin = token;
+                token = nullptr;
+
+                // An int that does not fit is read as a double, as std::stoi failing over to std::stod did.
+                if (is_int)
                 {
-                    throw ParsingError("invalid line end"s);
+                    int value = 0;
+
+                    if (std::from_chars(begin, position, value).ec == std::errc())
+                    {
+                        handler.OnInt(value);
+                        return;
+                    }
                 }
-                else
+
+                double value = 0.0;
+
+                if (std::from_chars(begin, position, value).ec != std::errc())
                 {
-                    str.push_back(ch);
+                    throw ParsingError("unable to convert "s + std::string(begin, position) + " to number"s);
                 }
-                ++it;
+                handler.OnDouble(value);
             }
-            return Node(str);
-        }
-
-        Node LoadDictionary(std::istream& input_)
-        {
-            Dict dictionary;
 
-            for (char ch; input_ >> ch && ch != '}';)
+            // The string starting after the opening quote. Without escapes, a string of an in-memory
+            // buffer is passed on where it lies; otherwise it is assembled in scratch, which stays
+            // valid until the next string is read.
+            std::string_view LoadString()
             {
+                const char* begin = position;
+                const char* special = scan::FindStringSpecial(position, end);
 
-                if (ch == '"')
+                if (!input && special != end && *special == '"')
                 {
-                    std::string key = LoadString(input_).AsString();
+                    position = special + 1;
+                    return std::string_view(begin, special - begin);
+                }
 
-                    if (input_ >> ch && ch == ':')
+                scratch.clear();
+
+                while (true)
+                {
+                    scratch.append(position, special);
+                    position = special;
+
+                    if (position == end)
                     {
-                        if (dictionary.find(key) != dictionary.end())
+                        if (!Refill())
                         {
-                            throw ParsingError("duplicate key '"s + key + "'found"s);
+                            throw ParsingError("unable to parse string"s);
                         }
+                        special = scan::FindStringSpecial(position, end);
+                        continue;
+                    }
+
+                    const char ch = *position++;
 
-                        dictionary.emplace(std::move(key), LoadNode(input_));
+                    if (ch == '"')
+                    {
+                        break;
+                    }
+                    else if (ch == '\\')
+                    {
+                        if (position == end && !Refill())
+                        {
+                            throw ParsingError("unable to parse string"s);
+                        }
+
+                        const char esc_ch = *position++;
+
+                        switch (esc_ch)
+                        {
+                        case 'n':
+                            scratch.push_back('\n');
+                            break;
+                        case 't':
+                            scratch.push_back('\t');
+                            break;
+                        case 'r':
+                            scratch.push_back('\r');
+                            break;
+                        case '"':
+                            scratch.push_back('"');
+                            break;
+                        case '\\':
+                            scratch.push_back('\\');
+                            break;
+                        default:
+                            throw ParsingError("invalid esc \\"s + esc_ch);
+                        }
                     }
                     else
                     {
-                        throw ParsingError(": expected. but '"s + ch + "' found"s);
+                        throw ParsingError("invalid line end"s);
                     }
-
-                }
-                else if (ch != ',')
-                {
-                    throw ParsingError("',' expected. but '"s + ch + "' found"s);
+                    special = scan::FindStringSpecial(position, end);
                 }
+                return scratch;
             }
 
-            if (!input_)
+            void ParseDictionary()
             {
-                throw ParsingError("unable to parse dictionary"s);
-            }
-            else
-            {
-                return Node(dictionary);
-            }
-        }
+                handler.OnStartDict();
 
-        Node LoadNode(std::istream& input_)
-        {
-            char ch;
+                char ch;
+                bool is_read = false;
 
-            if (!(input_ >> ch))
-            {
-                throw ParsingError(""s);
-            }
-            else
-            {
-                switch (ch)
-                {
-                case '[':
-                {
-                    return LoadArray(input_);
-                }
-                case '{':
-                {
-                    return LoadDictionary(input_);
-                }
-                case '"':
-                {
-                    return LoadString(input_);
-                }
-                case 't':  case 'f':
+                while ((is_read = ReadChar(ch)) && ch != '}')
                 {
-                    input_.putback(ch);
-                    return LoadBool(input_);
-                }
-                case 'n':
-                {
-                    input_.putback(ch);
-                    return LoadNull(input_);
+
+                    if (ch == '"')
+                    {
+                        const std::string_view key = LoadString();
+
+                        if (ReadChar(ch) && ch == ':')
+                        {
+                            handler.OnKey(key);
+                            ParseNode();
+                        }
+                        else
+                        {
+                            throw ParsingError(": expected. but '"s + ch + "' found"s);
+                        }
+
+                    }
+                    else if (ch != ',')
+                    {
+                        throw ParsingError("',' expected. but '"s + ch + "' found"s);
+                    }
                 }
-                default:
+
+                if (!is_read)
                 {
-                    input_.putback(ch);
-                    return LoadNumber(input_);
-                }
+                    throw ParsingError("unable to parse dictionary"s);
                 }
+                handler.OnEndDict();
             }
-        }
+        };
 
     } // end namespace
 
@@ -423,162 +538,146 @@ namespace json
         return value;
     }
 
-    Document::Document(Node root) : root(std::move(root)) {}
+    Document::Document(Node root_) : Document(std::move(root_), nullptr) {}
+    Document::Document(Node root_, std::shared_ptr<Arena> arena_) : content(std::make_shared<Content>(Content{ std::move(arena_), std::move(root_) })) {}
+
     const Node& Document::GetRoot() const
     {
-        return root;
+        static const Node EMPTY_ROOT;
+        return content ? content->root : EMPTY_ROOT;
     }
 
-    Document Load(std::istream& input_)
+    TreeHandler::Frame::Frame(std::pmr::memory_resource* resource_) : dict(resource_) {}
+
+    TreeHandler::TreeHandler(std::pmr::memory_resource* resource_) : resource(resource_) {}
+
+    void TreeHandler::OnNull()
+    {
+        AddNode(Node(nullptr));
+    }
+    void TreeHandler::OnBool(bool value_)
+    {
+        AddNode(Node(value_));
+    }
+    void TreeHandler::OnInt(int value_)
+    {
+        AddNode(Node(value_));
+    }
+    void TreeHandler::OnDouble(double value_)
     {
-        return Document(LoadNode(input_));
+        AddNode(Node(value_));
+    }
+    void TreeHandler::OnString(std::string_view value_)
+    {
+        AddNode(Node(std::string(value_)));
     }
 
-    namespace
+    void TreeHandler::OnKey(std::string_view key_)
     {
-        struct PrintInfoContext
+        Frame& frame = frames[depth - 1];
+        frame.key.assign(key_);
+
+        if (frame.dict.find(frame.key) != frame.dict.end())
         {
-            std::ostream& out;
-            int indent_step = 4;
-            int indent = 0;
+            throw ParsingError("duplicate key '"s + frame.key + "'found"s);
+        }
+    }
 
-            void PrintIndent() const
-            {
-                for (int i = 0; i < indent; ++i)
-                {
-                    out.put(' ');
-                }
-            }
+    TreeHandler::Frame& TreeHandler::OpenFrame(bool is_dict_)
+    {
+        if (depth == frames.size())
+        {
+            frames.emplace_back(resource);
+        }
 
-            PrintInfoContext Indented() const
-            {
-                return { out, indent_step, indent_step + indent };
-            }
-        };
+        Frame& frame = frames[depth++];
+        frame.is_dict = is_dict_;
+        return frame;
+    }
 
-        void PrintNode(const Node& node_, const PrintInfoContext& context_);
+    void TreeHandler::OnStartArray()
+    {
+        OpenFrame(false);
+    }
 
-        void PrintString(const std::string& value_, std::ostream& out_)
-        {
-            out_.put('"');
+    void TreeHandler::OnEndArray()
+    {
+        std::vector<Node>& items = frames[--depth].items;
+        Array array(resource);
 
-            for (const char ch : value_)
-            {
-                switch (ch)
-                {
-                case '\r':
-                {
-                    out_ << R"(\r)";
-                    break;
-                }
-                case '\n':
-                {
-                    out_ << R"(\n)";
-                    break;
-                }
-                case '"':
-                {
-                    out_ << R"(\")";
-                    break;
-                }
-                case '\\':
-                {
-                    out_ << R"(\\)";
-                    break;
-                }
-                default:
-                {
-                    out_.put(ch);
-                    break;
-                }
-                }
-            }
-            out_.put('"');
-        }
+        array.reserve(items.size());
+        std::move(items.begin(), items.end(), std::back_inserter(array));
+        items.clear();
 
-        template <typename Value>
-        void PrintValue(const Value& value_, const PrintInfoContext& context_)
-        {
-            context_.out << value_;
-        }
+        AddNode(Node(std::move(array)));
+    }
+
+    void TreeHandler::OnStartDict()
+    {
+        OpenFrame(true);
+    }
+
+    void TreeHandler::OnEndDict()
+    {
+        Dict& frame_dict = frames[--depth].dict;
+        Dict dict(resource);
+
+        dict.swap(frame_dict);
+        AddNode(Node(std::move(dict)));
+    }
+
+    Node TreeHandler::Extract()
+    {
+        return std::move(root);
+    }
 
-        template <>
-        void PrintValue<std::string>(const std::string& value_, const PrintInfoContext& context_)
+    void TreeHandler::AddNode(Node node_)
+    {
+        if (depth == 0)
         {
-            PrintString(value_, context_.out);
+            root = std::move(node_);
         }
-
-        void PrintValue(const std::nullptr_t&, const PrintInfoContext& context_)
+        else if (Frame& frame = frames[depth - 1]; frame.is_dict)
         {
-            context_.out << "null"s;
+            frame.dict.emplace(std::move(frame.key), std::move(node_));
         }
-
-        void PrintValue(bool value_, const PrintInfoContext& context_)
+        else
         {
-            context_.out << std::boolalpha << value_;
+            frame.items.push_back(std::move(node_));
         }
+    }
 
-        [[maybe_unused]] void PrintValue(Array nodes_, const PrintInfoContext& context_)
-        {
-            std::ostream& out = context_.out;
-            out << "[\n"s;
-            bool first = true;
-            auto inner_context = context_.Indented();
+    void Parse(std::string_view input_, Handler& handler_)
+    {
+        BufferParser(input_, handler_).ParseNode();
+    }
 
-            for (const Node& node : nodes_)
-            {
-                if (first)
-                {
-                    first = false;
-                }
-                else
-                {
-                    out << ",\n"s;
-                }
-                inner_context.PrintIndent();
-                PrintNode(node, inner_context);
-            }
-            out.put('\n');
-            context_.PrintIndent();
-            out.put(']');
-        }
+    void Parse(std::istream& input_, Handler& handler_)
+    {
+        BufferParser(input_, handler_).ParseNode();
+    }
 
-        void PrintValue(Dict nodes_, const PrintInfoContext& context_)
-        {
-            std::ostream& out = context_.out;
-            out << "{\n"s;
-            bool first = true;
-            auto inner_context = context_.Indented();
+    Document Load(std::string_view input_)
+    {
+        auto arena = std::make_shared<Arena>();
+        TreeHandler handler(arena.get());
 
-            for (const auto& [key, node] : nodes_)
-            {
-                if (first)
-                {
-                    first = false;
-                }
-                else
-                {
-                    out << ",\n"s;
-                }
-                inner_context.PrintIndent();
-                PrintString(key, context_.out);
-                out << ": "s;
-                PrintNode(node, inner_context);
-            }
-            out.put('\n');
-            context_.PrintIndent();
-            out.put('}');
-        }
+        Parse(input_, handler);
+        return Document(handler.Extract(), std::move(arena));
+    }
 
-        void PrintNode(const Node& node_, const PrintInfoContext& context_)
-        {
-            std::visit([&context_](const auto& value) { PrintValue(value, context_); }, node_.GetValue());
-        }
-    } // end namespace
+    Document Load(std::istream& input_)
+    {
+        auto arena = std::make_shared<Arena>();
+        TreeHandler handler(arena.get());
+
+        Parse(input_, handler);
+        return Document(handler.Extract(), std::move(arena));
+    }
 
     void PrintDocument(const Document& document_, std::ostream& output_)
     {
-        PrintNode(document_.GetRoot(), PrintInfoContext{ output_ });
+        Writer(output_).Value(document_.GetRoot());
     }
 
 } // end namespace json
\ No newline at end of file
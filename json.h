@@ -2,7 +2,10 @@
 
 #include <iostream>
 #include <map>
+#include <memory>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <variant>
 #include <fstream>
@@ -13,8 +16,13 @@ namespace json
 
     class Node;
 
-    using Dict = std::map<std::string, Node>;
-    using Array = std::vector<Node>;
+    // Containers take a memory resource, so that a whole tree can be allocated from one arena.
+    // Default-constructed and copied containers use the default resource, i.e. the heap.
+    using Dict = std::pmr::map<std::string, Node>;
+    using Array = std::pmr::vector<Node>;
+
+    // Memory the containers of a document are allocated from, released all at once with the document.
+    using Arena = std::pmr::monotonic_buffer_resource;
 
     class ParsingError : public std::runtime_error
     {
@@ -23,12 +31,11 @@ namespace json
         using runtime_error::runtime_error;
     };
 
-    class Node final : private std::variant<std::nullptr_t, Array, Dict, bool, int, double, std::string>
+    class Node final
     {
     public:
 
-        using variant::variant;
-        using Value = variant;
+        using Value = std::variant<std::nullptr_t, Array, Dict, bool, int, double, std::string>;
 
         Node() = default;
         Node(std::nullptr_t);
@@ -71,6 +78,7 @@ namespace json
         return !(lhs_ == rhs_);
     }
 
+    // Immutable once built; copies share the tree.
     class Document
     {
     public:
@@ -78,11 +86,21 @@ namespace json
         Document() = default;
         explicit Document(Node root_);
 
+        // A document whose containers were allocated from arena_: the arena is kept alive by the
+        // document and its copies, and the tree is destroyed before it.
+        Document(Node root_, std::shared_ptr<Arena> arena_);
+
         const Node& GetRoot() const;
 
     private:
 
-        Node root;
+        struct Content
+        {
+            std::shared_ptr<Arena> arena;
+            Node root;
+        };
+
+        std::shared_ptr<const Content> content;
     };
 
     inline bool operator==(const Document& lhs_, const Document& rhs_)
@@ -94,6 +112,82 @@ namespace json
         return !(lhs_ == rhs_);
     }
 
+    // Receives the values of a document one by one, in the order Parse reads them. String values and
+    // keys are views into the parser's buffers, valid only until the call returns.
+    class Handler
+    {
+    public:
+
+        virtual ~Handler() = default;
+
+        virtual void OnNull() = 0;
+        virtual void OnBool(bool value_) = 0;
+        virtual void OnInt(int value_) = 0;
+        virtual void OnDouble(double value_) = 0;
+        virtual void OnString(std::string_view value_) = 0;
+
+        virtual void OnKey(std::string_view key_) = 0;
+
+        virtual void OnStartArray() = 0;
+        virtual void OnEndArray() = 0;
+        virtual void OnStartDict() = 0;
+        virtual void OnEndDict() = 0;
+    };
+
+    // Assembles the events of one value back into a Node; Load is Parse with this handler.
+    // Containers are allocated from resource_, which must outlive the extracted node.
+    class TreeHandler final : public Handler
+    {
+    public:
+
+        explicit TreeHandler(std::pmr::memory_resource* resource_ = std::pmr::get_default_resource());
+
+        void OnNull() override;
+        void OnBool(bool value_) override;
+        void OnInt(int value_) override;
+        void OnDouble(double value_) override;
+        void OnString(std::string_view value_) override;
+
+        void OnKey(std::string_view key_) override;
+
+        void OnStartArray() override;
+        void OnEndArray() override;
+        void OnStartDict() override;
+        void OnEndDict() override;
+
+        Node Extract();
+
+    private:
+
+        // Frames are kept for reuse once closed. An array collects its items in a scratch vector and is
+        // copied into the resource at its exact size, so growing it leaves nothing behind in an arena.
+        struct Frame
+        {
+            explicit Frame(std::pmr::memory_resource* resource_);
+
+            bool is_dict = false;
+            std::vector<Node> items;
+            Dict dict;
+            std::string key;
+        };
+
+        std::pmr::memory_resource* resource;
+        std::vector<Frame> frames;
+        size_t depth = 0;
+        Node root;
+
+        Frame& OpenFrame(bool is_dict_);
+
+        void AddNode(Node node_);
+    };
+
+    // Reads one value from input_ and reports it to handler_ without building a tree. The stream
+    // versions read the stream in chunks and may read past the end of the value.
+    // Load builds the tree in an arena owned by the returned document.
+    void Parse(std::string_view input_, Handler& handler_);
+    void Parse(std::istream& input_, Handler& handler_);
+
+    Document Load(std::string_view input_);
     Document Load(std::istream& input_);
     void PrintDocument(const Document& doc_, std::ostream& output_);
 
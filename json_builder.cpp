@@ -57,6 +57,10 @@ namespace json
 
     //----------------------------------------------- Builder ------------------------------------------------------------
 
+    Builder::Frame::Frame(bool is_dict_, std::pmr::memory_resource* resource_) : is_dict(is_dict_), array(resource_), dict(resource_) {}
+
+    Builder::Builder(std::pmr::memory_resource* resource_) : resource(resource_) {}
+
     Node Builder::MakeNode(const Node::Value& value_)
     {
         Node node;
@@ -83,12 +87,12 @@ namespace json
         }
         else if (std::holds_alternative<Array>(value_))
         {
-            Array arr = std::get<Array>(value_);
+            Array arr(std::get<Array>(value_), resource);
             node = Node(std::move(arr));
         }
         else if (std::holds_alternative<Dict>(value_))
         {
-            Dict dictionary = std::get<Dict>(value_);
+            Dict dictionary(std::get<Dict>(value_), resource);
             node = Node(std::move(dictionary));
         }
         else
@@ -98,7 +102,8 @@ namespace json
         return node;
     }
 
-    void Builder::AddNode(const Node& node_)
+    // Values are moved into the container on top of the stack, which is filled in place.
+    void Builder::AddNode(Node node_)
     {
         if (nodes_stack.empty())
         {
@@ -106,44 +111,24 @@ namespace json
             {
                 throw std::logic_error("root has been added"s);
             }
-            root = node_;
+            root = std::move(node_);
             return;
         }
-        else
-        {
-            if (!nodes_stack.back()->IsArray() && !nodes_stack.back()->IsString())
-            {
-                throw std::logic_error("unable to create node"s);
-            }
-
-            if (nodes_stack.back()->IsArray())
-            {
-                Array arr = nodes_stack.back()->AsArray();
-                arr.emplace_back(node_);
 
-                nodes_stack.pop_back();
-                std::unique_ptr<json::Node> arr_ptr = std::make_unique<Node>(arr);
-                nodes_stack.emplace_back(std::move(arr_ptr));
-
-                return;
-            }
+        Frame& frame = nodes_stack.back();
 
-            if (nodes_stack.back()->IsString())
-            {
-                std::string str = nodes_stack.back()->AsString();
-                nodes_stack.pop_back();
-
-                if (nodes_stack.back()->IsDict())
-                {
-                    Dict dictionary = nodes_stack.back()->AsDict();
-                    dictionary.emplace(std::move(str), node_);
-
-                    nodes_stack.pop_back();
-                    std::unique_ptr<json::Node> dictionary_ptr = std::make_unique<Node>(dictionary);
-                    nodes_stack.emplace_back(std::move(dictionary_ptr));
-                }
-                return;
-            }
+        if (!frame.is_dict)
+        {
+            frame.array.push_back(std::move(node_));
+        }
+        else if (frame.key)
+        {
+            frame.dict.emplace(std::move(*frame.key), std::move(node_));
+            frame.key.reset();
+        }
+        else
+        {
+            throw std::logic_error("unable to create node"s);
         }
     }
 
@@ -154,11 +139,9 @@ namespace json
             throw std::logic_error("unable to create key"s);
         }
 
-        std::unique_ptr<json::Node> key_ptr = std::make_unique<Node>(key_);
-
-        if (nodes_stack.back()->IsDict())
+        if (nodes_stack.back().is_dict)
         {
-            nodes_stack.emplace_back(std::move(key_ptr));
+            nodes_stack.back().key = key_;
         }
         return KeyContext(*this);
     }
@@ -172,7 +155,7 @@ namespace json
 
     DictionaryContext Builder::StartDict()
     {
-        nodes_stack.emplace_back(std::move(std::make_unique<Node>(Dict())));
+        nodes_stack.emplace_back(true, resource);
 
         return DictionaryContext(*this);
     }
@@ -184,22 +167,23 @@ namespace json
             throw std::logic_error("unable to close as without opening"s);
         }
 
-        Node node = *nodes_stack.back();
+        Frame& frame = nodes_stack.back();
 
-        if (!node.IsDict())
+        if (!frame.is_dict || frame.key)
         {
             throw std::logic_error("object isn't dictionary"s);
         }
 
+        Node node(std::move(frame.dict));
         nodes_stack.pop_back();
-        AddNode(node);
+        AddNode(std::move(node));
 
         return *this;
     }
 
     ArrayContext Builder::StartArray()
     {
-        nodes_stack.emplace_back(std::move(std::make_unique<Node>(Array())));
+        nodes_stack.emplace_back(false, resource);
 
         return ArrayContext(*this);
     }
@@ -211,19 +195,21 @@ namespace json
             throw std::logic_error("unable to close without opening"s);
         }
 
-        Node node = *nodes_stack.back();
+        Frame& frame = nodes_stack.back();
 
-        if (!node.IsArray())
+        if (frame.is_dict)
         {
             throw std::logic_error("object isn't array"s);
         }
 
+        Node node(std::move(frame.array));
         nodes_stack.pop_back();
-        AddNode(node);
+        AddNode(std::move(node));
 
         return *this;
     }
 
+    // Hands the tree over, leaving the builder empty.
     Node Builder::Build()
     {
         if (root.IsNull())
@@ -234,6 +220,9 @@ namespace json
         {
             throw std::logic_error("invalid json"s);
         }
-        return root;
+
+        Node result = std::move(root);
+        root = Node(nullptr);
+        return result;
     }
 } // end namespace json
\ No newline at end of file
@@ -4,6 +4,7 @@
 
 #include <string>
 #include <memory>
+#include <optional>
 
 namespace json
 {
@@ -15,8 +16,13 @@ namespace json
     {
     public:
 
+        Builder() = default;
+
+        // Containers of the built node are allocated from resource_, which must outlive the node.
+        explicit Builder(std::pmr::memory_resource* resource_);
+
         Node MakeNode(const Node::Value& value_);
-        void AddNode(const Node& node_);
+        void AddNode(Node node_);
 
         KeyContext Key(const std::string& key_);
         Builder& Value(const Node::Value& value_);
@@ -31,8 +37,20 @@ namespace json
 
     private:
 
+        // A container being filled; a dictionary also holds the key waiting for its value.
+        struct Frame
+        {
+            Frame(bool is_dict_, std::pmr::memory_resource* resource_);
+
+            bool is_dict = false;
+            Array array;
+            Dict dict;
+            std::optional<std::string> key;
+        };
+
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource();
         Node root{ nullptr };
-        std::vector<std::unique_ptr<Node>> nodes_stack;
+        std::vector<Frame> nodes_stack;
 
     };
 
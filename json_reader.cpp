@@ -1,23 +1,682 @@
 #include "json_reader.h"
 
+#include <algorithm>
+#include <optional>
+
 namespace json
 {
+    static const double MINUTES_PER_DAY = 24 * 60;
+    static const double MIN_BUS_INTERVAL = 1;
+    static const size_t MAX_BUS_TRIPS = 2 * 24 * 60;
+
+    namespace
+    {
+        // Departures of a bus, in minutes since midnight: those listed, and with an interval a trip every
+        // interval minutes from first_departure (0 by default) up to last_departure, or through the day.
+        // Intervals under a minute and bounds outside the day are rejected, and so is a bus with more
+        // than MAX_BUS_TRIPS trips in all.
+        std::vector<double> MakeDepartures(std::vector<double> departures_, const std::optional<Node>& interval_, const std::optional<Node>& first_departure_, const std::optional<Node>& last_departure_)
+        {
+            if (interval_)
+            {
+                const double interval = interval_->AsDouble();
+                const double first_departure = first_departure_ ? first_departure_->AsDouble() : 0.0;
+                const double last_departure = last_departure_ ? last_departure_->AsDouble() : MINUTES_PER_DAY;
+
+                if (!(interval >= MIN_BUS_INTERVAL))
+                {
+                    throw std::invalid_argument("bus interval is shorter than a minute"s);
+                }
+                if (!(0 <= first_departure && first_departure <= last_departure && last_departure <= MINUTES_PER_DAY))
+                {
+                    throw std::invalid_argument("bus departures are outside the day"s);
+                }
+
+                for (size_t i = 0; ; ++i)
+                {
+                    const double departure = first_departure + i * interval;
+
+                    if (last_departure_ ? departure > last_departure : departure >= last_departure)
+                    {
+                        break;
+                    }
+                    departures_.push_back(departure);
+                }
+            }
+
+            if (departures_.size() > MAX_BUS_TRIPS)
+            {
+                throw std::invalid_argument("bus has too many trips"s);
+            }
+
+            std::sort(departures_.begin(), departures_.end());
+
+            return departures_;
+        }
+    }//end namespace
+
+    // Reads the base_requests array from parser events. Fields of a request are kept only until the
+    // request ends: a stop goes to the catalogue at once, while its road distances and the buses are
+    // held in compact form and added when the array ends, in the order ParseNodeBase uses.
+    class BaseRequestsHandler final : public Handler
+    {
+    public:
+
+        explicit BaseRequestsHandler(TransportCatalogue& catalogue_) : catalogue(catalogue_) {}
+
+        void OnNull() override
+        {
+            OnScalar(Node(nullptr));
+        }
+        void OnBool(bool value_) override
+        {
+            OnScalar(Node(value_));
+        }
+        void OnInt(int value_) override
+        {
+            OnScalar(Node(value_));
+        }
+        void OnDouble(double value_) override
+        {
+            OnScalar(Node(value_));
+        }
+        void OnString(std::string_view value_) override
+        {
+            OnScalar(Node(std::string(value_)));
+        }
+
+        void OnKey(std::string_view key_) override;
+
+        void OnStartArray() override;
+        void OnEndArray() override;
+        void OnStartDict() override;
+        void OnEndDict() override;
+
+        // True if a malformed request stopped the loading, as an exception does in ParseNodeBase.
+        bool IsFailed() const
+        {
+            return failed;
+        }
+
+    private:
+
+        // Values of the fields a request may have; nested values of any other shape are replaced
+        // by an empty array, which fails the same checks the full value would.
+        struct Request
+        {
+            std::vector<std::string> keys;
+            std::optional<Node> type;
+            std::optional<Node> name;
+            std::optional<Node> latitude;
+            std::optional<Node> longitude;
+            std::optional<Node> is_roundtrip;
+
+            bool road_distances_is_dict = false;
+            std::vector<std::pair<std::string, Node>> road_distances;
+
+            bool stops_is_array = false;
+            std::vector<Node> stops;
+
+            std::optional<Node> interval;
+            std::optional<Node> first_departure;
+            std::optional<Node> last_departure;
+
+            bool departures_is_array = false;
+            std::vector<Node> departures;
+        };
+
+        // road_distances holds the distances up to the first invalid one, in name order.
+        struct PendingDistances
+        {
+            std::string stop_name;
+            std::vector<std::pair<std::string, int>> road_distances;
+            bool is_valid = true;
+        };
+
+        // stops holds the stop names up to the first invalid one.
+        struct PendingBus
+        {
+            std::optional<Node> name;
+            std::optional<Node> is_roundtrip;
+            std::vector<std::string> stops;
+            bool stops_valid = true;
+
+            std::optional<Node> interval;
+            std::optional<Node> first_departure;
+            std::optional<Node> last_departure;
+            std::vector<double> departures;
+            bool departures_valid = true;
+        };
+
+        TransportCatalogue& catalogue;
+
+        int depth = 0;
+        bool is_array = false;
+        bool failed = false;
+
+        std::string key;
+        std::string road_key;
+        Request request;
+
+        std::vector<PendingDistances> pending_distances;
+        std::vector<PendingBus> pending_buses;
+
+        void OnScalar(Node value_);
+        void OnNested();
+
+        void AddRequest();
+        void AddStop();
+        void AddPending();
+    };
+
+    void BaseRequestsHandler::OnKey(std::string_view key_)
+    {
+        if (!is_array)
+        {
+            return;
+        }
+        if (depth == 2)
+        {
+            key.assign(key_);
+
+            if (std::find(request.keys.begin(), request.keys.end(), key) != request.keys.end())
+            {
+                throw ParsingError("duplicate key '"s + key + "'found"s);
+            }
+            request.keys.push_back(key);
+        }
+        else if (depth == 3)
+        {
+            road_key.assign(key_);
+        }
+    }
+
+    void BaseRequestsHandler::OnStartArray()
+    {
+        if (depth == 0)
+        {
+            is_array = true;
+        }
+        else if (is_array && depth == 2 && key == "stops"s)
+        {
+            request.stops_is_array = true;
+        }
+        else if (is_array && depth == 2 && key == "departures"s)
+        {
+            request.departures_is_array = true;
+        }
+        else
+        {
+            OnNested();
+        }
+        ++depth;
+    }
+
+    void BaseRequestsHandler::OnEndArray()
+    {
+        --depth;
+
+        if (depth == 0 && is_array)
+        {
+            AddPending();
+        }
+    }
+
+    void BaseRequestsHandler::OnStartDict()
+    {
+        if (depth == 0)
+        {
+            std::cout << "base_requests is not an array"s;
+        }
+        else if (is_array && depth == 1)
+        {
+            request = Request();
+        }
+        else if (is_array && depth == 2 && key == "road_distances"s)
+        {
+            request.road_distances_is_dict = true;
+        }
+        else
+        {
+            OnNested();
+        }
+        ++depth;
+    }
+
+    void BaseRequestsHandler::OnEndDict()
+    {
+        --depth;
+
+        if (depth == 1 && is_array)
+        {
+            AddRequest();
+        }
+    }
+
+    // A nested value that is not one of the expected ones: recorded where a field is being read.
+    void BaseRequestsHandler::OnNested()
+    {
+        if (depth == 2 || depth == 3)
+        {
+            OnScalar(Node(Array()));
+        }
+    }
+
+    void BaseRequestsHandler::OnScalar(Node value_)
+    {
+        if (!is_array)
+        {
+            if (depth == 0)
+            {
+                std::cout << "base_requests is not an array"s;
+            }
+            return;
+        }
+
+        if (depth == 2)
+        {
+            if (key == "type"s)
+            {
+                request.type = std::move(value_);
+            }
+            else if (key == "name"s)
+            {
+                request.name = std::move(value_);
+            }
+            else if (key == "latitude"s)
+            {
+                request.latitude = std::move(value_);
+            }
+            else if (key == "longitude"s)
+            {
+                request.longitude = std::move(value_);
+            }
+            else if (key == "is_roundtrip"s)
+            {
+                request.is_roundtrip = std::move(value_);
+            }
+            else if (key == "interval"s)
+            {
+                request.interval = std::move(value_);
+            }
+            else if (key == "first_departure"s)
+            {
+                request.first_departure = std::move(value_);
+            }
+            else if (key == "last_departure"s)
+            {
+                request.last_departure = std::move(value_);
+            }
+        }
+        else if (depth == 3)
+        {
+            if (key == "road_distances"s && request.road_distances_is_dict)
+            {
+                request.road_distances.emplace_back(std::move(road_key), std::move(value_));
+            }
+            else if (key == "stops"s && request.stops_is_array)
+            {
+                request.stops.push_back(std::move(value_));
+            }
+            else if (key == "departures"s && request.departures_is_array)
+            {
+                request.departures.push_back(std::move(value_));
+            }
+        }
+    }
+
+    void BaseRequestsHandler::AddRequest()
+    {
+        if (failed)
+        {
+            return;
+        }
+        if (!request.type)
+        {
+            std::cout << "base_requests does not have type value"s;
+            return;
+        }
+        if (!request.type->IsString())
+        {
+            return;
+        }
+
+        if (request.type->AsString() == "Stop"s)
+        {
+            AddStop();
+        }
+        else if (request.type->AsString() == "Bus"s)
+        {
+            PendingBus bus;
+            bus.name = std::move(request.name);
+            bus.is_roundtrip = std::move(request.is_roundtrip);
+            bus.stops_valid = request.stops_is_array;
+
+            for (const Node& stop : request.stops)
+            {
+                if (!stop.IsString())
+                {
+                    bus.stops_valid = false;
+                    break;
+                }
+                bus.stops.push_back(stop.AsString());
+            }
+
+            bus.interval = std::move(request.interval);
+            bus.first_departure = std::move(request.first_departure);
+            bus.last_departure = std::move(request.last_departure);
+            bus.departures_valid = request.departures_is_array || std::find(request.keys.begin(), request.keys.end(), "departures"s) == request.keys.end();
+
+            for (const Node& departure : request.departures)
+            {
+                if (!departure.IsDouble())
+                {
+                    bus.departures_valid = false;
+                    break;
+                }
+                bus.departures.push_back(departure.AsDouble());
+            }
+            pending_buses.push_back(std::move(bus));
+        }
+        else
+        {
+            std::cout << "base_requests are invalid"s;
+        }
+    }
+
+    void BaseRequestsHandler::AddStop()
+    {
+        std::string name;
+        geo::Coordinates coordinates;
+
+        try
+        {
+            if (!request.name || !request.latitude || !request.longitude)
+            {
+                throw std::out_of_range("stop field is missing"s);
+            }
+            name = request.name->AsString();
+            coordinates.latitude = request.latitude->AsDouble();
+            coordinates.longitude = request.longitude->AsDouble();
+        }
+        catch (...)
+        {
+            failed = true;
+            return;
+        }
+
+        PendingDistances distances;
+        distances.stop_name = name;
+        distances.is_valid = request.road_distances_is_dict;
+
+        // ParseNodeDistance walks a Dict, that is in name order.
+        std::sort(request.road_distances.begin(), request.road_distances.end(), [](const auto& lhs, const auto& rhs)
+            {
+                return lhs.first < rhs.first;
+            });
+
+        const auto duplicate = std::adjacent_find(request.road_distances.begin(), request.road_distances.end(), [](const auto& lhs, const auto& rhs)
+            {
+                return lhs.first == rhs.first;
+            });
+
+        if (duplicate != request.road_distances.end())
+        {
+            throw ParsingError("duplicate key '"s + duplicate->first + "'found"s);
+        }
+
+        for (const auto& [name, value] : request.road_distances)
+        {
+            if (!value.IsInt())
+            {
+                distances.is_valid = false;
+                break;
+            }
+            distances.road_distances.emplace_back(name, value.AsInt());
+        }
+
+        catalogue.AddStop(name, coordinates);
+        pending_distances.push_back(std::move(distances));
+    }
+
+    void BaseRequestsHandler::AddPending()
+    {
+        if (failed)
+        {
+            return;
+        }
+
+        for (const PendingDistances& stop : pending_distances)
+        {
+            std::vector<Distance> distances;
+            const Stop* begin = catalogue.GetStop(stop.stop_name);
+
+            // A distance to a stop that was never added is ignored, as it was when distances were keyed by pointers.
+            for (const auto& [name, distance] : stop.road_distances)
+            {
+                if (const Stop* end = catalogue.GetStop(name))
+                {
+                    distances.push_back({ begin, end, distance });
+                }
+            }
+            if (!stop.is_valid)
+            {
+                std::cout << "invalide road"s << std::endl;
+            }
+            catalogue.AddDistance(distances);
+        }
+        pending_distances.clear();
+
+        for (const PendingBus& pending : pending_buses)
+        {
+            std::string name;
+            Bus bus;
+
+            try
+            {
+                if (!pending.name || !pending.is_roundtrip)
+                {
+                    throw std::out_of_range("bus field is missing"s);
+                }
+                name = pending.name->AsString();
+                bus.is_roundtrip = pending.is_roundtrip->AsBool();
+
+                if (!pending.departures_valid)
+                {
+                    throw std::invalid_argument("bus departures are invalid"s);
+                }
+                bus.departures = MakeDepartures(pending.departures, pending.interval, pending.first_departure, pending.last_departure);
+            }
+            catch (...)
+            {
+                failed = true;
+                break;
+            }
+
+            std::vector<StopId> stop_ids;
+
+            for (const std::string& stop : pending.stops)
+            {
+                stop_ids.push_back(catalogue.GetStop(stop)->id);
+            }
+
+            if (!pending.stops_valid)
+            {
+                std::cout << "base_requests: bus: stops is empty"s << std::endl;
+            }
+            else if (!bus.is_roundtrip)
+            {
+                size_t size = stop_ids.size() - 1;
+
+                for (size_t i = size; i > 0; i--)
+                {
+                    stop_ids.push_back(stop_ids[i - 1]);
+                }
+            }
+            catalogue.AddBus(name, std::move(bus), stop_ids);
+        }
+        pending_buses.clear();
+
+        catalogue.BuildIndexes();
+    }
+
+    // Splits a document whose root is a dict: the value of base_requests goes to its own handler and
+    // every other value is built into a Node of the root. Any other root is built as a whole.
+    class DocumentHandler final : public Handler
+    {
+    public:
+
+        DocumentHandler(Handler& base_requests_, std::pmr::memory_resource* resource_) : base_requests(base_requests_), tree(resource_), root(resource_) {}
+
+        void OnNull() override
+        {
+            Forward([](Handler& handler_) { handler_.OnNull(); }, 0);
+        }
+        void OnBool(bool value_) override
+        {
+            Forward([value_](Handler& handler_) { handler_.OnBool(value_); }, 0);
+        }
+        void OnInt(int value_) override
+        {
+            Forward([value_](Handler& handler_) { handler_.OnInt(value_); }, 0);
+        }
+        void OnDouble(double value_) override
+        {
+            Forward([value_](Handler& handler_) { handler_.OnDouble(value_); }, 0);
+        }
+        void OnString(std::string_view value_) override
+        {
+            Forward([value_](Handler& handler_) { handler_.OnString(value_); }, 0);
+        }
+
+        void OnKey(std::string_view key_) override
+        {
+            if (is_dict && depth == 1)
+            {
+                key.assign(key_);
+
+                if (root.count(key) || (key == "base_requests"s && has_base_requests))
+                {
+                    throw ParsingError("duplicate key '"s + key + "'found"s);
+                }
+                in_base_requests = key == "base_requests"s;
+                has_base_requests = has_base_requests || in_base_requests;
+            }
+            else
+            {
+                Forward([key_](Handler& handler_) { handler_.OnKey(key_); }, 0);
+            }
+        }
+
+        void OnStartArray() override
+        {
+            Forward([](Handler& handler_) { handler_.OnStartArray(); }, 1);
+        }
+        void OnEndArray() override
+        {
+            Forward([](Handler& handler_) { handler_.OnEndArray(); }, -1);
+        }
+
+        void OnStartDict() override
+        {
+            if (!started)
+            {
+                started = true;
+                is_dict = true;
+                depth = 1;
+            }
+            else
+            {
+                Forward([](Handler& handler_) { handler_.OnStartDict(); }, 1);
+            }
+        }
+        void OnEndDict() override
+        {
+            if (is_dict && depth == 1)
+            {
+                depth = 0;
+            }
+            else
+            {
+                Forward([](Handler& handler_) { handler_.OnEndDict(); }, -1);
+            }
+        }
+
+        bool HasBaseRequests() const
+        {
+            return has_base_requests;
+        }
+
+        Node ExtractRoot()
+        {
+            return is_dict ? Node(std::move(root)) : tree.Extract();
+        }
+
+    private:
+
+        Handler& base_requests;
+        TreeHandler tree;
+        Dict root;
+
+        std::string key;
+        int depth = 0;
+        bool started = false;
+        bool is_dict = false;
+        bool in_base_requests = false;
+        bool has_base_requests = false;
+
+        template <typename Event>
+        void Forward(Event event_, int depth_change_)
+        {
+            started = true;
+
+            if (!is_dict)
+            {
+                event_(tree);
+                return;
+            }
+
+            event_(in_base_requests ? base_requests : tree);
+            depth += depth_change_;
+
+            // Back at the level of the root keys: the value of key is complete.
+            if (depth == 1 && !in_base_requests)
+            {
+                root.emplace(std::move(key), tree.Extract());
+            }
+        }
+    };
+
     JSON_R::JSON_R(Document doc_) : document(std::move(doc_)) {}
     JSON_R::JSON_R(std::istream& input_) : document(json::Load(input_)) {}
 
-    Stop JSON_R::ParseNodeStop(const Node& node_)
+    JSON_R::JSON_R(std::istream& input_, TransportCatalogue& catalogue_)
     {
-        Stop stop;
+        auto arena = std::make_shared<Arena>();
+        BaseRequestsHandler base_requests(catalogue_);
+        DocumentHandler handler(base_requests, arena.get());
+
+        json::Parse(input_, handler);
+
+        document = Document(handler.ExtractRoot(), std::move(arena));
+        base_streamed = handler.HasBaseRequests();
+        base_failed = base_requests.IsFailed();
+    }
+
+    void JSON_R::ParseNodeStop(const Node& node_, TransportCatalogue& catalogue_)
+    {
+        std::string name;
+        geo::Coordinates coordinates;
         Dict stop_node;
 
         if (node_.IsDict())
         {
             stop_node = node_.AsDict();
-            stop.name = stop_node.at("name"s).AsString();
-            stop.latitude = stop_node.at("latitude"s).AsDouble();
-            stop.longitude = stop_node.at("longitude"s).AsDouble();
+            name = stop_node.at("name"s).AsString();
+            coordinates.latitude = stop_node.at("latitude"s).AsDouble();
+            coordinates.longitude = stop_node.at("longitude"s).AsDouble();
         }
-        return stop;
+        catalogue_.AddStop(name, coordinates);
     }
 
     std::vector<Distance> JSON_R::ParseNodeDistance(const Node& node_, TransportCatalogue& catalogue_)
@@ -42,7 +701,12 @@ namespace json
                 {
                     last_name = key;
                     distance = value.AsInt();
-                    distances.push_back({ catalogue_.GetStop(begin_name), catalogue_.GetStop(last_name), distance });
+
+                    // Distances to unknown stops are ignored, as in BaseRequestsHandler::AddPending.
+                    if (const Stop* end = catalogue_.GetStop(last_name))
+                    {
+                        distances.push_back({ catalogue_.GetStop(begin_name), end, distance });
+                    }
                 }
             }
             catch (...)
@@ -53,16 +717,18 @@ namespace json
         return distances;
     }
 
-    Bus JSON_R::ParseNodeBus(const Node& node_, TransportCatalogue& catalogue_)
+    void JSON_R::ParseNodeBus(const Node& node_, TransportCatalogue& catalogue_)
     {
+        std::string name;
         Bus bus;
+        std::vector<StopId> stop_ids;
         Dict bus_node;
         Array bus_stops;
 
         if (node_.IsDict())
         {
             bus_node = node_.AsDict();
-            bus.name = bus_node.at("name"s).AsString();
+            name = bus_node.at("name"s).AsString();
             bus.is_roundtrip = bus_node.at("is_roundtrip"s).AsBool();
 
             try
@@ -71,16 +737,16 @@ namespace json
 
                 for (const Node& stop : bus_stops)
                 {
-                    bus.stops.push_back(catalogue_.GetStop(stop.AsString()));
+                    stop_ids.push_back(catalogue_.GetStop(stop.AsString())->id);
                 }
 
                 if (!bus.is_roundtrip)
                 {
-                    size_t size = bus.stops.size() - 1;
+                    size_t size = stop_ids.size() - 1;
 
                     for (size_t i = size; i > 0; i--)
                     {
-                        bus.stops.push_back(bus.stops[i - 1]);
+                        stop_ids.push_back(stop_ids[i - 1]);
                     }
 
                 }
@@ -90,8 +756,25 @@ namespace json
             {
                 std::cout << "base_requests: bus: stops is empty"s << std::endl;
             }
+
+            const auto field = [&bus_node](const std::string& key_) -> std::optional<Node>
+                {
+                    const auto it = bus_node.find(key_);
+                    return it == bus_node.end() ? std::nullopt : std::optional<Node>(it->second);
+                };
+
+            std::vector<double> departures;
+
+            if (const std::optional<Node> departures_node = field("departures"s))
+            {
+                for (const Node& departure : departures_node->AsArray())
+                {
+                    departures.push_back(departure.AsDouble());
+                }
+            }
+            bus.departures = MakeDepartures(std::move(departures), field("interval"s), field("first_departure"s), field("last_departure"s));
         }
-        return bus;
+        catalogue_.AddBus(name, std::move(bus), stop_ids);
     }
 
     void JSON_R::ParseNodeBase(const Node& root_, TransportCatalogue& catalogue_)
@@ -142,7 +825,7 @@ namespace json
 
             for (const Node& stop : stops)
             {
-                catalogue_.AddStop(ParseNodeStop(stop));
+                ParseNodeStop(stop, catalogue_);
             }
             for (const Node& stop : stops)
             {
@@ -150,8 +833,9 @@ namespace json
             }
             for (const Node& bus : buses)
             {
-                catalogue_.AddBus(ParseNodeBus(bus, catalogue_));
+                ParseNodeBus(bus, catalogue_);
             }
+            catalogue_.BuildIndexes();
         }
         else
         {
@@ -159,6 +843,44 @@ namespace json
         }
     }
 
+    void JSON_R::ParseBase(const Dict& root_dictionary_, TransportCatalogue& catalogue_)
+    {
+        if (base_streamed)
+        {
+            if (base_failed)
+            {
+                std::cout << "base_requests is empty"s;
+            }
+            return;
+        }
+
+        try
+        {
+            ParseNodeBase(root_dictionary_.at("base_requests"s), catalogue_);
+        }
+        catch (...)
+        {
+            std::cout << "base_requests is empty"s;
+        }
+    }
+
+    // An end of a Route request is a stop name or a map of latitude and longitude.
+    void JSON_R::ParseRouteEnd(const Node& node_, std::string& stop_name_, std::optional<geo::Coordinates>& coordinates_)
+    {
+        if (node_.IsDict())
+        {
+            const Dict& point = node_.AsDict();
+
+            stop_name_ = ""s;
+            coordinates_ = geo::Coordinates{ point.at("latitude"s).AsDouble(), point.at("longitude"s).AsDouble() };
+        }
+        else
+        {
+            stop_name_ = node_.AsString();
+            coordinates_.reset();
+        }
+    }
+
     void JSON_R::ParseNodeStat(const Node& node_, std::vector<StatRequest>& stat_request_)
     {
         Array stat_requests;
@@ -176,6 +898,8 @@ namespace json
                     req_map = req_node.AsDict();
                     req.id = req_map.at("id"s).AsInt();
                     req.type = req_map.at("type"s).AsString();
+                    req.from_coordinates.reset();
+                    req.to_coordinates.reset();
 
                     if ((req.type == "Bus"s) || (req.type == "Stop"s))
                     {
@@ -188,6 +912,11 @@ namespace json
                         req.name = ""s;
 
                         if (req.type == "Route"s)
+                        {
+                            ParseRouteEnd(req_map.at("from"s), req.from, req.from_coordinates);
+                            ParseRouteEnd(req_map.at("to"s), req.to, req.to_coordinates);
+                        }
+                        else if (req.type == "EarliestArrival"s)
                         {
                             req.from = req_map.at("from"s).AsString();
                             req.to = req_map.at("to"s).AsString();
@@ -198,6 +927,30 @@ namespace json
                             req.to = ""s;
                         }
                     }
+
+                    req.departure_time = req.type == "EarliestArrival"s ? req_map.at("departure_time"s).AsDouble() : 0.0;
+
+                    if (req.type == "NearestStops"s)
+                    {
+                        req.coordinates = { req_map.at("latitude"s).AsDouble(), req_map.at("longitude"s).AsDouble() };
+                        req.count = req_map.at("count"s).AsInt();
+                    }
+                    else
+                    {
+                        req.coordinates = {};
+                        req.count = 0;
+                    }
+
+                    if (req.type == "StopsInBox"s)
+                    {
+                        req.box_min = { req_map.at("min_latitude"s).AsDouble(), req_map.at("min_longitude"s).AsDouble() };
+                        req.box_max = { req_map.at("max_latitude"s).AsDouble(), req_map.at("max_longitude"s).AsDouble() };
+                    }
+                    else
+                    {
+                        req.box_min = {};
+                        req.box_max = {};
+                    }
                     stat_request_.push_back(req);
                 }
             }
@@ -315,6 +1068,46 @@ namespace json
         }
     }
 
+    graph::RouterMode JSON_R::ParseRouterMode(const std::string& mode_)
+    {
+        if (mode_ == "on_demand"s)
+        {
+            return graph::RouterMode::ON_DEMAND;
+        }
+        else if (mode_ == "all_pairs"s)
+        {
+            return graph::RouterMode::ALL_PAIRS;
+        }
+        else if (mode_ == "all_pairs_parallel"s)
+        {
+            return graph::RouterMode::ALL_PAIRS_PARALLEL;
+        }
+        else if (mode_ == "contraction_hierarchy"s)
+        {
+            return graph::RouterMode::CONTRACTION_HIERARCHY;
+        }
+        else
+        {
+            throw std::invalid_argument("unknown router mode '"s + mode_ + "'"s);
+        }
+    }
+
+    BusGraphModel JSON_R::ParseBusGraphModel(const std::string& model_)
+    {
+        if (model_ == "pairwise"s)
+        {
+            return BusGraphModel::PAIRWISE;
+        }
+        else if (model_ == "ride_chain"s)
+        {
+            return BusGraphModel::RIDE_CHAIN;
+        }
+        else
+        {
+            throw std::invalid_argument("unknown bus graph model '"s + model_ + "'"s);
+        }
+    }
+
     void JSON_R::ParseNodeRouting(const Node& node_, RoutingSettings& route_set_)
     {
         Dict route;
@@ -327,6 +1120,23 @@ namespace json
             {
                 route_set_.bus_wait_time = route.at("bus_wait_time"s).AsDouble();
                 route_set_.bus_velocity = route.at("bus_velocity"s).AsDouble();
+
+                if (route.count("router_mode"s))
+                {
+                    route_set_.router_mode = ParseRouterMode(route.at("router_mode"s).AsString());
+                }
+                if (route.count("bus_graph_model"s))
+                {
+                    route_set_.bus_graph_model = ParseBusGraphModel(route.at("bus_graph_model"s).AsString());
+                }
+                if (route.count("walking_velocity"s))
+                {
+                    route_set_.walking_velocity = route.at("walking_velocity"s).AsDouble();
+                }
+                if (route.count("max_walking_distance"s))
+                {
+                    route_set_.max_walking_distance = route.at("max_walking_distance"s).AsDouble();
+                }
             }
             catch (...)
             {
@@ -339,6 +1149,19 @@ namespace json
         }
     }
 
+    // Without a base file there is nothing to save to or load from, so unlike the other settings a
+    // missing or malformed one stops the run with std::invalid_argument instead of a printed message.
+    void JSON_R::ParseSerialization(const Dict& root_dictionary_, SerializationSettings& serialization_settings_)
+    {
+        const auto it = root_dictionary_.find("serialization_settings"s);
+
+        if (it == root_dictionary_.end() || !it->second.IsDict() || !it->second.AsDict().count("file"s) || !it->second.AsDict().at("file"s).IsString())
+        {
+            throw std::invalid_argument("unable to parse serialization settings"s);
+        }
+        serialization_settings_.file = it->second.AsDict().at("file"s).AsString();
+    }
+
     void JSON_R::ParseNode(const Node& root_, TransportCatalogue& catalogue_, std::vector<StatRequest>& stat_request_, RenderSettings& render_settings_, RoutingSettings& routing_settings_)
     {
         Dict root_dictionary;
@@ -347,14 +1170,7 @@ namespace json
         {
             root_dictionary = root_.AsDict();
 
-            try
-            {
-                ParseNodeBase(root_dictionary.at("base_requests"s), catalogue_);
-            }
-            catch (...)
-            {
-                std::cout << "base_requests is empty"s;
-            }
+            ParseBase(root_dictionary, catalogue_);
 
             try
             {
@@ -394,6 +1210,149 @@ namespace json
         ParseNode(document.GetRoot(), catalogue_, stat_request_, render_settings_, routing_settings_);
     }
 
+    void JSON_R::ParseMakeBase(TransportCatalogue& catalogue_, RenderSettings& render_settings_, RoutingSettings& routing_settings_, SerializationSettings& serialization_settings_)
+    {
+        const Node& root = document.GetRoot();
+
+        if (!root.IsDict())
+        {
+            throw std::invalid_argument("root is not map"s);
+        }
+
+        const Dict& root_dictionary = root.AsDict();
+
+        ParseBase(root_dictionary, catalogue_);
+
+        try
+        {
+            ParseNodeRender(root_dictionary.at("render_settings"s), render_settings_);
+        }
+        catch (...)
+        {
+            std::cout << "render_settings is empty"s;
+        }
+
+        try
+        {
+            ParseNodeRouting(root_dictionary.at("routing_settings"s), routing_settings_);
+        }
+        catch (...)
+        {
+            std::cout << "routing_settings is empty"s;
+        }
+
+        ParseSerialization(root_dictionary, serialization_settings_);
+    }
+
+    void JSON_R::ParseProcessRequests(std::vector<StatRequest>& stat_request_, SerializationSettings& serialization_settings_)
+    {
+        const Node& root = document.GetRoot();
+
+        if (!root.IsDict())
+        {
+            throw std::invalid_argument("root is not map"s);
+        }
+
+        const Dict& root_dictionary = root.AsDict();
+
+        try
+        {
+            ParseNodeStat(root_dictionary.at("stat_requests"s), stat_request_);
+        }
+        catch (...)
+        {
+            std::cout << "stat_requests is empty"s;
+        }
+
+        ParseSerialization(root_dictionary, serialization_settings_);
+    }
+
+    void JSON_R::ParseBatch(std::vector<StatRequest>& stat_request_)
+    {
+        const Node& root = document.GetRoot();
+        const Node* requests = &root;
+
+        if (root.IsDict())
+        {
+            const Dict& root_dictionary = root.AsDict();
+            const auto it = root_dictionary.find("stat_requests"s);
+
+            if (it == root_dictionary.end())
+            {
+                throw std::invalid_argument("stat_requests is empty"s);
+            }
+            requests = &it->second;
+        }
+
+        if (!requests->IsArray())
+        {
+            throw std::invalid_argument("stat_requests is not array"s);
+        }
+
+        for (const Node& req_node : requests->AsArray())
+        {
+            if (!req_node.IsDict())
+            {
+                throw std::invalid_argument("stat request is not map"s);
+            }
+
+            const Dict& req_map = req_node.AsDict();
+            const auto field = [&req_map](const std::string& key_) -> const Node&
+                {
+                    const auto it = req_map.find(key_);
+
+                    if (it == req_map.end())
+                    {
+                        throw std::invalid_argument("stat request has no "s + key_);
+                    }
+                    return it->second;
+                };
+
+            StatRequest req;
+            req.id = field("id"s).AsInt();
+            req.type = field("type"s).AsString();
+
+            if ((req.type == "Bus"s) || (req.type == "Stop"s))
+            {
+                req.name = field("name"s).AsString();
+            }
+            else if (req.type == "Route"s)
+            {
+                ParseRouteEnd(field("from"s), req.from, req.from_coordinates);
+                ParseRouteEnd(field("to"s), req.to, req.to_coordinates);
+            }
+            else if (req.type == "EarliestArrival"s)
+            {
+                req.from = field("from"s).AsString();
+                req.to = field("to"s).AsString();
+                req.departure_time = field("departure_time"s).AsDouble();
+            }
+            else if (req.type == "NearestStops"s)
+            {
+                req.coordinates = { field("latitude"s).AsDouble(), field("longitude"s).AsDouble() };
+                req.count = field("count"s).AsInt();
+            }
+            else if (req.type == "StopsInBox"s)
+            {
+                req.box_min = { field("min_latitude"s).AsDouble(), field("min_longitude"s).AsDouble() };
+                req.box_max = { field("max_latitude"s).AsDouble(), field("max_longitude"s).AsDouble() };
+            }
+            stat_request_.push_back(std::move(req));
+        }
+    }
+
+    void JSON_R::ParseServerSettings(SerializationSettings& serialization_settings_)
+    {
+        const Node& root = document.GetRoot();
+
+        if (!root.IsDict())
+        {
+            throw std::invalid_argument("root is not map"s);
+        }
+
+        ParseSerialization(root.AsDict(), serialization_settings_);
+    }
+
     const Document& JSON_R::GetDocument() const
     {
         return document;
@@ -18,22 +18,47 @@ namespace json
         JSON_R(Document doc_);
         JSON_R(std::istream& input_);
 
+        // Streams base_requests straight into catalogue_ while reading input_: stops are added as
+        // they are read, distances and buses once every stop is known, and no tree is kept for
+        // them. The rest of the document is loaded as usual; pass the same catalogue to Parse.
+        JSON_R(std::istream& input_, TransportCatalogue& catalogue_);
+
         void Parse(TransportCatalogue& catalogue_, std::vector<StatRequest>& stat_request_, RenderSettings& render_settings_, RoutingSettings& router_settings_);
 
+        // Halves of Parse for the make_base and process_requests steps: the first reads everything
+        // that goes into a saved base, the second only the queries against it.
+        // Both throw std::invalid_argument when the root is not a map or serialization_settings
+        // does not name a file.
+        void ParseMakeBase(TransportCatalogue& catalogue_, RenderSettings& render_settings_, RoutingSettings& router_settings_, SerializationSettings& serialization_settings_);
+        void ParseProcessRequests(std::vector<StatRequest>& stat_request_, SerializationSettings& serialization_settings_);
+
+        // Strict parts for the server, which must not mix diagnostics into its responses: both throw
+        // std::invalid_argument instead of printing. A batch is a document with stat_requests or the
+        // bare array of them.
+        void ParseBatch(std::vector<StatRequest>& stat_request_);
+        void ParseServerSettings(SerializationSettings& serialization_settings_);
+
         const Document& GetDocument() const;
 
     private:
 
         Document document; // json::
+        bool base_streamed = false;
+        bool base_failed = false;
 
         void ParseNodeBase(const Node& root_, TransportCatalogue& catalogue_);
+        void ParseBase(const Dict& root_dictionary_, TransportCatalogue& catalogue_);
         void ParseNodeStat(const Node& root_, std::vector<StatRequest>& stat_request_);
+        void ParseRouteEnd(const Node& node_, std::string& stop_name_, std::optional<geo::Coordinates>& coordinates_);
         void ParseNodeRender(const Node& node_, RenderSettings& render_settings_);
         void ParseNodeRouting(const Node& node_, RoutingSettings& route_set_);
+        graph::RouterMode ParseRouterMode(const std::string& mode_);
+        BusGraphModel ParseBusGraphModel(const std::string& model_);
+        void ParseSerialization(const Dict& root_dictionary_, SerializationSettings& serialization_settings_);
         void ParseNode(const Node& root, TransportCatalogue& catalogue_, std::vector<StatRequest>& stat_request_, RenderSettings& render_settings_, RoutingSettings& router_settings_);
 
-        Stop ParseNodeStop(const Node& node_);
-        Bus ParseNodeBus(const Node& node_, TransportCatalogue& catalogue_);
+        void ParseNodeStop(const Node& node_, TransportCatalogue& catalogue_);
+        void ParseNodeBus(const Node& node_, TransportCatalogue& catalogue_);
         std::vector<Distance> ParseNodeDistance(const Node& node_, TransportCatalogue& catalogue_);
     };
 
@@ -0,0 +1,140 @@
+#include "json_scan.h"
+
+#include <cstdlib>
+#include <string_view>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define JSON_SCAN_X86
+#endif
+
+namespace json
+{
+    namespace scan
+    {
+        using namespace std::string_view_literals;
+
+        bool IsStringSpecial(char ch_)
+        {
+            return ch_ == '"' || ch_ == '\\' || ch_ == '\n' || ch_ == '\r';
+        }
+
+        const char* SkipWhitespaceScalar(const char* begin_, const char* end_)
+        {
+            while (begin_ != end_ && IsWhitespace(*begin_))
+            {
+                ++begin_;
+            }
+            return begin_;
+        }
+
+        const char* FindStringSpecialScalar(const char* begin_, const char* end_)
+        {
+            while (begin_ != end_ && !IsStringSpecial(*begin_))
+            {
+                ++begin_;
+            }
+            return begin_;
+        }
+
+#ifdef JSON_SCAN_X86
+
+        // The vector versions work on whole blocks and leave the tail, shorter than a block, to the
+        // scalar loop. Whitespace is ' ' or a byte in ['\t', '\r'], tested as min(max(c, '\t'), '\r') == c.
+
+        __attribute__((target("sse2"))) const char* SkipWhitespaceSse2(const char* begin_, const char* end_)
+        {
+            const __m128i space = _mm_set1_epi8(' ');
+            const __m128i tab = _mm_set1_epi8('\t');
+            const __m128i carriage_return = _mm_set1_epi8('\r');
+
+            for (; end_ - begin_ >= 16; begin_ += 16)
+            {
+                const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin_));
+                const __m128i is_control = _mm_cmpeq_epi8(_mm_min_epu8(_mm_max_epu8(block, tab), carriage_return), block);
+                const __m128i is_space = _mm_or_si128(_mm_cmpeq_epi8(block, space), is_control);
+                const unsigned mask = ~static_cast<unsigned>(_mm_movemask_epi8(is_space)) & 0xFFFFu;
+
+                if (mask != 0)
+                {
+                    return begin_ + __builtin_ctz(mask);
+                }
+            }
+            return SkipWhitespaceScalar(begin_, end_);
+        }
+
+        __attribute__((target("sse2"))) const char* FindStringSpecialSse2(const char* begin_, const char* end_)
+        {
+            const __m128i quote = _mm_set1_epi8('"');
+            const __m128i backslash = _mm_set1_epi8('\\');
+            const __m128i line_feed = _mm_set1_epi8('\n');
+            const __m128i carriage_return = _mm_set1_epi8('\r');
+
+            for (; end_ - begin_ >= 16; begin_ += 16)
+            {
+                const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin_));
+                const __m128i is_special = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(block, quote), _mm_cmpeq_epi8(block, backslash)),
+                    _mm_or_si128(_mm_cmpeq_epi8(block, line_feed), _mm_cmpeq_epi8(block, carriage_return)));
+                const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(is_special));
+
+                if (mask != 0)
+                {
+                    return begin_ + __builtin_ctz(mask);
+                }
+            }
+            return FindStringSpecialScalar(begin_, end_);
+        }
+
+#endif
+
+        struct ScanFunctions
+        {
+            InstructionSet instruction_set = InstructionSet::SCALAR;
+            const char* (*skip_whitespace)(const char*, const char*) = SkipWhitespaceScalar;
+            const char* (*find_string_special)(const char*, const char*) = FindStringSpecialScalar;
+        };
+
+        ScanFunctions SelectFunctions()
+        {
+            ScanFunctions functions;
+
+#ifdef JSON_SCAN_X86
+            const char* limit_variable = std::getenv("TRANSPORT_JSON_SIMD");
+            const std::string_view limit = limit_variable ? limit_variable : ""sv;
+
+            if (limit == "scalar"sv)
+            {
+                return functions;
+            }
+
+            __builtin_cpu_init();
+
+            if (__builtin_cpu_supports("sse2"))
+            {
+                return { InstructionSet::SSE2, SkipWhitespaceSse2, FindStringSpecialSse2 };
+            }
+#endif
+            return functions;
+        }
+
+        static const ScanFunctions FUNCTIONS = SelectFunctions();
+
+        InstructionSet GetInstructionSet()
+        {
+            return FUNCTIONS.instruction_set;
+        }
+
+        const char* SkipWhitespaceRun(const char* begin_, const char* end_)
+        {
+            return FUNCTIONS.skip_whitespace(begin_, end_);
+        }
+
+        const char* FindStringSpecial(const char* begin_, const char* end_)
+        {
+            return FUNCTIONS.find_string_special(begin_, end_);
+        }
+
+    }//end namespace scan
+
+} // end namespace json
\ No newline at end of file
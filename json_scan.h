@@ -0,0 +1,46 @@
+#pragma once
+
+namespace json
+{
+    // Character scans the buffer parser spends most of its time in. Each one has a scalar version and,
+    // on x86, an SSE2 version, picked at the first call when the running CPU supports it. Setting
+    // TRANSPORT_JSON_SIMD to "scalar" keeps the scalar versions. AVX2 versions measured no faster than
+    // SSE2 ones, as the runs between structural characters are mostly shorter than a 16-byte block.
+    namespace scan
+    {
+        enum class InstructionSet
+        {
+            SCALAR,
+            SSE2,
+        };
+
+        InstructionSet GetInstructionSet();
+
+        inline bool IsWhitespace(char ch_)
+        {
+            return ch_ == ' ' || (ch_ >= '\t' && ch_ <= '\r');
+        }
+
+        // Vector part of SkipWhitespace, for runs longer than a separator.
+        const char* SkipWhitespaceRun(const char* begin_, const char* end_);
+
+        // First character in [begin_, end_) that is not whitespace in the sense of std::isspace.
+        // Most runs are empty or a single separator and are skipped here without a call.
+        inline const char* SkipWhitespace(const char* begin_, const char* end_)
+        {
+            for (int i = 0; i < 2; ++i, ++begin_)
+            {
+                if (begin_ == end_ || !IsWhitespace(*begin_))
+                {
+                    return begin_;
+                }
+            }
+            return SkipWhitespaceRun(begin_, end_);
+        }
+
+        // First '"', '\\', '\n' or '\r' in [begin_, end_): the characters that end a plain run of a string.
+        const char* FindStringSpecial(const char* begin_, const char* end_);
+
+    }//end namespace scan
+
+} // end namespace json
\ No newline at end of file
@@ -0,0 +1,341 @@
+#include "json_writer.h"
+#include "json_scan.h"
+
+#include <charconv>
+
+namespace json
+{
+    using namespace std::string_literals;
+
+    static const size_t INDENT_STEP = 4;
+
+    namespace
+    {
+        // Hands value_ to append_ in parts: plain runs between the characters to escape, copied whole,
+        // and the escape sequences for those characters.
+        template <typename Append>
+        void EscapeRuns(std::string_view value_, Append append_)
+        {
+            const char* begin = value_.data();
+            const char* end = begin + value_.size();
+
+            while (begin != end)
+            {
+                const char* special = scan::FindStringSpecial(begin, end);
+
+                append_(std::string_view(begin, static_cast<size_t>(special - begin)));
+
+                if (special == end)
+                {
+                    break;
+                }
+
+                switch (*special)
+                {
+                case '\r':
+                {
+                    append_(R"(\r)");
+                    break;
+                }
+                case '\n':
+                {
+                    append_(R"(\n)");
+                    break;
+                }
+                case '"':
+                {
+                    append_(R"(\")");
+                    break;
+                }
+                default:
+                {
+                    append_(R"(\\)");
+                    break;
+                }
+                }
+                begin = special + 1;
+            }
+        }
+
+    } // end namespace
+
+    std::string EscapeString(std::string_view value_)
+    {
+        std::string result;
+        result.reserve(value_.size());
+
+        EscapeRuns(value_, [&result](std::string_view part_) { result.append(part_); });
+        return result;
+    }
+
+    Writer::Writer(std::ostream& output_, WriterFormat format_) : output(output_), format(format_)
+    {
+        buffer.reserve(FLUSH_SIZE);
+    }
+
+    Writer::~Writer()
+    {
+        Flush();
+    }
+
+    Writer& Writer::Key(std::string_view key_)
+    {
+        if (levels.empty() || !levels.back().is_dict || has_key)
+        {
+            throw std::logic_error("unable to write key"s);
+        }
+
+        Level& level = levels.back();
+
+        if (!level.is_empty)
+        {
+            buffer.push_back(',');
+        }
+        level.is_empty = false;
+
+        WriteLineBreak(levels.size());
+        WriteString(key_);
+        buffer.append(format == WriterFormat::INDENTED ? ": " : ":");
+
+        has_key = true;
+        return *this;
+    }
+
+    Writer& Writer::Value(const Node& node_)
+    {
+        if (node_.IsArray())
+        {
+            StartArray();
+
+            for (const Node& node : node_.AsArray())
+            {
+                Value(node);
+            }
+            return EndArray();
+        }
+        else if (node_.IsDict())
+        {
+            StartDict();
+
+            for (const auto& [key, node] : node_.AsDict())
+            {
+                Key(key);
+                Value(node);
+            }
+            return EndDict();
+        }
+        else
+        {
+            return std::visit([this](const auto& value) -> Writer&
+                {
+                    using Type = std::decay_t<decltype(value)>;
+
+                    if constexpr (std::is_same_v<Type, Array> || std::is_same_v<Type, Dict>)
+                    {
+                        return *this;
+                    }
+                    else
+                    {
+                        return Value(value);
+                    }
+                }, node_.GetValue());
+        }
+    }
+
+    Writer& Writer::Value(std::nullptr_t)
+    {
+        StartValue();
+        buffer.append("null");
+        EndValue();
+        return *this;
+    }
+
+    Writer& Writer::Value(bool value_)
+    {
+        StartValue();
+        buffer.append(value_ ? "true" : "false");
+        EndValue();
+        return *this;
+    }
+
+    Writer& Writer::Value(int value_)
+    {
+        char chars[16];
+        const auto result = std::to_chars(chars, chars + sizeof(chars), value_);
+
+        StartValue();
+        buffer.append(chars, result.ptr);
+        EndValue();
+        return *this;
+    }
+
+    // General format with precision 6 is what an ostream with default flags writes, so the text is
+    // the same as PrintDocument used to give.
+    Writer& Writer::Value(double value_)
+    {
+        char chars[32];
+        const auto result = std::to_chars(chars, chars + sizeof(chars), value_, std::chars_format::general, 6);
+
+        StartValue();
+        buffer.append(chars, result.ptr);
+        EndValue();
+        return *this;
+    }
+
+    Writer& Writer::Value(std::string_view value_)
+    {
+        StartValue();
+        WriteString(value_);
+        EndValue();
+        return *this;
+    }
+
+    Writer& Writer::Value(const std::string& value_)
+    {
+        return Value(std::string_view(value_));
+    }
+
+    Writer& Writer::Value(const char* value_)
+    {
+        return Value(std::string_view(value_));
+    }
+
+    Writer& Writer::EscapedValue(std::string_view escaped_)
+    {
+        StartValue();
+        buffer.push_back('"');
+        WriteText(escaped_);
+        buffer.push_back('"');
+        EndValue();
+        return *this;
+    }
+
+    Writer& Writer::StartDict()
+    {
+        StartValue();
+        buffer.push_back('{');
+        levels.push_back({ true });
+        return *this;
+    }
+
+    Writer& Writer::EndDict()
+    {
+        Close(true, '}');
+        return *this;
+    }
+
+    Writer& Writer::StartArray()
+    {
+        StartValue();
+        buffer.push_back('[');
+        levels.push_back({ false });
+        return *this;
+    }
+
+    Writer& Writer::EndArray()
+    {
+        Close(false, ']');
+        return *this;
+    }
+
+    void Writer::Flush()
+    {
+        if (!buffer.empty())
+        {
+            output.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            buffer.clear();
+        }
+    }
+
+    // Puts what goes before a value: nothing after a key or at the top, a separator and a line
+    // break in an array.
+    void Writer::StartValue()
+    {
+        if (levels.empty())
+        {
+            return;
+        }
+
+        Level& level = levels.back();
+
+        if (level.is_dict)
+        {
+            if (!has_key)
+            {
+                throw std::logic_error("value without key"s);
+            }
+            has_key = false;
+            return;
+        }
+
+        if (!level.is_empty)
+        {
+            buffer.push_back(',');
+        }
+        level.is_empty = false;
+
+        WriteLineBreak(levels.size());
+    }
+
+    // A finished top-level value goes to the stream at once, so a caller reading the stream sees
+    // every complete value; inside one, the buffer is only handed over in whole blocks.
+    void Writer::EndValue()
+    {
+        if (levels.empty() || buffer.size() >= FLUSH_SIZE)
+        {
+            Flush();
+        }
+    }
+
+    // PrintDocument breaks the line after an opening bracket even when nothing follows it, so an
+    // empty container takes two line breaks.
+    void Writer::Close(bool is_dict_, char bracket_)
+    {
+        if (levels.empty() || levels.back().is_dict != is_dict_ || has_key)
+        {
+            throw std::logic_error(is_dict_ ? "object isn't dictionary"s : "object isn't array"s);
+        }
+
+        if (levels.back().is_empty)
+        {
+            WriteLineBreak(0);
+        }
+        levels.pop_back();
+
+        WriteLineBreak(levels.size());
+        buffer.push_back(bracket_);
+        EndValue();
+    }
+
+    void Writer::WriteLineBreak(size_t depth_)
+    {
+        if (format == WriterFormat::INDENTED)
+        {
+            buffer.push_back('\n');
+            buffer.append(depth_ * INDENT_STEP, ' ');
+        }
+    }
+
+    void Writer::WriteString(std::string_view value_)
+    {
+        buffer.push_back('"');
+        EscapeRuns(value_, [this](std::string_view part_) { WriteText(part_); });
+        buffer.push_back('"');
+    }
+
+    // Text of a block or more, such as a rendered map, goes to the stream directly rather than
+    // through the buffer.
+    void Writer::WriteText(std::string_view text_)
+    {
+        if (text_.size() >= FLUSH_SIZE)
+        {
+            Flush();
+            output.write(text_.data(), static_cast<std::streamsize>(text_.size()));
+        }
+        else
+        {
+            buffer.append(text_);
+        }
+    }
+
+} // end namespace json
\ No newline at end of file
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "json.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace json
+{
+    enum class WriterFormat
+    {
+        INDENTED,
+        COMPACT,
+    };
+
+    // Text of value_ as it goes between the quotes of a JSON string.
+    std::string EscapeString(std::string_view value_);
+
+    // Writes JSON to a stream as the values are given, with no nodes built on the way, so memory does
+    // not grow with the size of the output. INDENTED is the format of PrintDocument; COMPACT writes
+    // a whole value on one line, with no whitespace at all.
+    // Text is gathered in a buffer and handed to the stream in blocks of FLUSH_SIZE, when a top-level
+    // value is complete, on Flush and on destruction.
+    class Writer
+    {
+    public:
+
+        static const size_t FLUSH_SIZE = 1 << 16;
+
+        explicit Writer(std::ostream& output_, WriterFormat format_ = WriterFormat::INDENTED);
+        ~Writer();
+
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+
+        Writer& Key(std::string_view key_);
+
+        Writer& Value(const Node& node_);
+        Writer& Value(std::nullptr_t);
+        Writer& Value(bool value_);
+        Writer& Value(int value_);
+        Writer& Value(double value_);
+        Writer& Value(std::string_view value_);
+        Writer& Value(const std::string& value_);
+        Writer& Value(const char* value_);
+        // Writes escaped_, text already escaped by EscapeString, as a string value without escaping it again.
+        Writer& EscapedValue(std::string_view escaped_);
+
+        Writer& StartDict();
+        Writer& EndDict();
+
+        Writer& StartArray();
+        Writer& EndArray();
+
+        void Flush();
+
+    private:
+
+        struct Level
+        {
+            bool is_dict = false;
+            bool is_empty = true;
+        };
+
+        std::ostream& output;
+        WriterFormat format;
+        std::vector<Level> levels;
+        bool has_key = false;
+        std::string buffer;
+
+        void StartValue();
+        void EndValue();
+        void Close(bool is_dict_, char bracket_);
+        void WriteLineBreak(size_t depth_);
+        void WriteString(std::string_view value_);
+        void WriteText(std::string_view text_);
+    };
+
+} // end namespace json
\ No newline at end of file
@@ -1,13 +1,103 @@
 #include "json_reader.h"
 #include "map_renderer.h"
 #include "request_handler.h"
+#include "serialization.h"
+#include "server.h"
+
+#include <algorithm>
+#include <fstream>
+#include <string_view>
 
 using namespace transport;
 using namespace map_renderer;
 using namespace request_handler;
 using namespace json;
 
-int main()
+void PrintUsage(std::ostream& stream_ = std::cerr)
+{
+    stream_ << "Usage: transport_catalogue [make_base|process_requests]\n"sv;
+    stream_ << "       transport_catalogue serve <settings.json> [<socket path>]\n"sv;
+}
+
+// make_base: builds the catalogue and the router from base_requests and saves them to the file
+// named in serialization_settings.
+void MakeBase(std::istream& input_)
+{
+    RenderSettings render_settings;
+    TransportCatalogue catalogue;
+    RoutingSettings routing_settings;
+    SerializationSettings serialization_settings;
+
+    JSON_R json_reader(input_, catalogue);
+    json_reader.ParseMakeBase(catalogue, render_settings, routing_settings, serialization_settings);
+
+    router::TransportRouter routing(catalogue, routing_settings);
+    serialization::SaveBase(serialization_settings, catalogue, render_settings, routing);
+}
+
+// process_requests: loads a base saved by make_base and answers stat_requests against it. Requests
+// that are all Bus and Stop are answered from the mapped base as it is, without loading the catalogue
+// or the router.
+void ProcessRequests(std::istream& input_, std::ostream& output_)
+{
+    std::vector<StatRequest> stat_request;
+    RenderSettings render_settings;
+    TransportCatalogue catalogue;
+    SerializationSettings serialization_settings;
+
+    JSON_R json_reader(input_);
+    json_reader.ParseProcessRequests(stat_request, serialization_settings);
+
+    if (std::all_of(stat_request.begin(), stat_request.end(), RequestHandler::IsViewQuery))
+    {
+        const serialization::BaseCatalogue base(serialization_settings);
+
+        json::Writer writer(output_);
+        RequestHandler().ExecuteQueries(base.GetView(), stat_request, writer);
+        return;
+    }
+
+    router::TransportRouter routing = serialization::LoadBase(serialization_settings, catalogue, render_settings);
+
+    RequestHandler request_handler;
+    json::Writer writer(output_);
+    request_handler.ExecuteQueries(catalogue, stat_request, render_settings, routing, writer);
+}
+
+// serve: loads the base named in the serialization_settings of settings_path_ once, then answers
+// newline-delimited batches of stat_requests from stdin, or from each connection to the Unix socket
+// at socket_path_ when one is given.
+void Serve(const std::string& settings_path_, const std::string& socket_path_)
+{
+    RenderSettings render_settings;
+    TransportCatalogue catalogue;
+    SerializationSettings serialization_settings;
+
+    std::ifstream settings_file(settings_path_);
+
+    if (!settings_file)
+    {
+        throw std::runtime_error("unable to open settings '"s + settings_path_ + "'"s);
+    }
+
+    JSON_R json_reader(settings_file);
+    json_reader.ParseServerSettings(serialization_settings);
+
+    router::TransportRouter routing = serialization::LoadBase(serialization_settings, catalogue, render_settings);
+
+    server::Server server(catalogue, render_settings, routing);
+
+    if (socket_path_.empty())
+    {
+        server.ServeStream(std::cin, std::cout);
+    }
+    else
+    {
+        server.ServeSocket(socket_path_);
+    }
+}
+
+int main(int argc, char* argv[])
 {
     /*std::ifstream inputFile("s12_final_opentest_1.json");
     if (!inputFile.is_open())
@@ -16,6 +106,53 @@ int main()
         return 1;
     }*/
 
+    if (argc >= 3 && argc <= 4 && argv[1] == "serve"sv)
+    {
+        try
+        {
+            Serve(argv[2], argc == 4 ? argv[3] : ""s);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (argc == 2)
+    {
+        const std::string_view mode(argv[1]);
+
+        try
+        {
+            if (mode == "make_base"sv)
+            {
+                MakeBase(std::cin);
+            }
+            else if (mode == "process_requests"sv)
+            {
+                ProcessRequests(std::cin, std::cout);
+            }
+            else
+            {
+                PrintUsage();
+                return 1;
+            }
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    else if (argc != 1)
+    {
+        PrintUsage();
+        return 1;
+    }
+
     std::vector<StatRequest> stat_request;
     RenderSettings render_settings;
     TransportCatalogue catalogue;
@@ -24,7 +161,7 @@ int main()
     JSON_R json_reader;
     RequestHandler request_handler;
 
-    json_reader = JSON_R(std::cin);
+    json_reader = JSON_R(std::cin, catalogue);
     json_reader.Parse(catalogue, stat_request, render_settings, routing_settings);
 
     /*std::fstream outputFileJson("test_output_json.json", std::ios::out);
@@ -35,8 +172,9 @@ int main()
     }*/
 
     request_handler = RequestHandler();
-    request_handler.ExecuteQueries(catalogue, stat_request, render_settings, routing_settings);
-    json::PrintDocument(request_handler.GetDocument(), std::cout);
+    router::TransportRouter routing(catalogue, routing_settings);
+    json::Writer writer(std::cout);
+    request_handler.ExecuteQueries(catalogue, stat_request, render_settings, routing, writer);
 
     //outputFileJson.close();
 
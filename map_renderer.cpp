@@ -2,6 +2,106 @@
 
 namespace map_renderer
 {
+    namespace
+    {
+        void HashCombine(size_t& hash_, size_t value_)
+        {
+            hash_ ^= value_ + 0x9e3779b9 + (hash_ << 6) + (hash_ >> 2);
+        }
+
+        struct ColorHasher
+        {
+            size_t operator()(std::monostate) const
+            {
+                return 0;
+            }
+
+            size_t operator()(const std::string& color_) const
+            {
+                return std::hash<std::string>{}(color_);
+            }
+
+            size_t operator()(svg::Rgb color_) const
+            {
+                return (static_cast<size_t>(color_.red) << 16) | (static_cast<size_t>(color_.green) << 8) | color_.blue;
+            }
+
+            size_t operator()(svg::Rgba color_) const
+            {
+                size_t hash = (*this)(static_cast<svg::Rgb>(color_));
+                HashCombine(hash, std::hash<double>{}(color_.opacity));
+                return hash;
+            }
+        };
+
+        void HashColor(size_t& hash_, const svg::Color& color_)
+        {
+            HashCombine(hash_, color_.index());
+            HashCombine(hash_, std::visit(ColorHasher{}, color_));
+        }
+
+        bool IsSameRgb(svg::Rgb lhs_, svg::Rgb rhs_)
+        {
+            return lhs_.red == rhs_.red && lhs_.green == rhs_.green && lhs_.blue == rhs_.blue;
+        }
+
+        bool IsSameColor(const svg::Color& lhs_, const svg::Color& rhs_)
+        {
+            if (lhs_.index() != rhs_.index())
+            {
+                return false;
+            }
+            if (const std::string* name = std::get_if<std::string>(&lhs_))
+            {
+                return *name == std::get<std::string>(rhs_);
+            }
+            if (const svg::Rgba* rgba = std::get_if<svg::Rgba>(&lhs_))
+            {
+                return IsSameRgb(*rgba, std::get<svg::Rgba>(rhs_)) && rgba->opacity == std::get<svg::Rgba>(rhs_).opacity;
+            }
+            if (const svg::Rgb* rgb = std::get_if<svg::Rgb>(&lhs_))
+            {
+                return IsSameRgb(*rgb, std::get<svg::Rgb>(rhs_));
+            }
+            return true;
+        }
+
+    }//end namespace
+
+    bool operator==(const RenderSettings& lhs_, const RenderSettings& rhs_)
+    {
+        return lhs_.width == rhs_.width && lhs_.height == rhs_.height && lhs_.padding == rhs_.padding && lhs_.line_width == rhs_.line_width
+            && lhs_.stop_radius == rhs_.stop_radius && lhs_.bus_label_font_size == rhs_.bus_label_font_size && lhs_.bus_label_offset == rhs_.bus_label_offset
+            && lhs_.stop_label_font_size == rhs_.stop_label_font_size && lhs_.stop_label_offset == rhs_.stop_label_offset
+            && IsSameColor(lhs_.underlayer_color, rhs_.underlayer_color) && lhs_.underlayer_width == rhs_.underlayer_width
+            && std::equal(lhs_.color_palette.begin(), lhs_.color_palette.end(), rhs_.color_palette.begin(), rhs_.color_palette.end(), IsSameColor);
+    }
+
+    size_t RenderSettingsHasher::operator()(const RenderSettings& render_settings_) const
+    {
+        const std::hash<double> double_hasher;
+        size_t hash = 0;
+
+        for (const double value : { render_settings_.width, render_settings_.height, render_settings_.padding, render_settings_.line_width, render_settings_.stop_radius,
+            render_settings_.bus_label_offset.first, render_settings_.bus_label_offset.second, render_settings_.stop_label_offset.first, render_settings_.stop_label_offset.second,
+            render_settings_.underlayer_width })
+        {
+            HashCombine(hash, double_hasher(value));
+        }
+
+        HashCombine(hash, std::hash<int>{}(render_settings_.bus_label_font_size));
+        HashCombine(hash, std::hash<int>{}(render_settings_.stop_label_font_size));
+        HashColor(hash, render_settings_.underlayer_color);
+
+        HashCombine(hash, render_settings_.color_palette.size());
+
+        for (const svg::Color& color : render_settings_.color_palette)
+        {
+            HashColor(hash, color);
+        }
+        return hash;
+    }
+
     bool SphereProjector::IsZero(double value_)
     {
         return std::abs(value_) < EPSILON;
@@ -110,20 +210,16 @@ namespace map_renderer
         text_.SetFillColor("black"s);
     }
 
-    void MapRenderer::AddLine(std::vector<std::pair<Bus*, int>>& buses_palette_)
+    void MapRenderer::AddLine(const transport::TransportCatalogue& catalogue_, std::vector<std::pair<const Bus*, int>>& buses_palette_)
     {
         std::vector<geo::Coordinates> stops_geo_coords;
 
         for (const auto& [bus, palette] : buses_palette_)
         {
 
-            for (const Stop* stop : bus->stops)
+            for (const StopId stop : catalogue_.GetBusStopIds(bus->id))
             {
-                geo::Coordinates coordinates;
-                coordinates.latitude = stop->latitude;
-                coordinates.longitude = stop->longitude;
-
-                stops_geo_coords.push_back(coordinates);
+                stops_geo_coords.push_back(catalogue_.GetStopCoordinates(stop));
             }
 
             svg::Polyline bus_line;
@@ -143,7 +239,7 @@ namespace map_renderer
         }
     }
 
-    void MapRenderer::AddBusesName(std::vector<std::pair<Bus*, int>>& buses_palette_)
+    void MapRenderer::AddBusesName(const transport::TransportCatalogue& catalogue_, std::vector<std::pair<const Bus*, int>>& buses_palette_)
     {
         std::vector<geo::Coordinates> stops_geo_coords;
         bool bus_empty = true;
@@ -151,13 +247,9 @@ namespace map_renderer
         for (const auto& [bus, palette] : buses_palette_)
         {
 
-            for (const Stop* stop : bus->stops)
+            for (const StopId stop : catalogue_.GetBusStopIds(bus->id))
             {
-                geo::Coordinates coordinates;
-                coordinates.latitude = stop->latitude;
-                coordinates.longitude = stop->longitude;
-
-                stops_geo_coords.push_back(coordinates);
+                stops_geo_coords.push_back(catalogue_.GetStopCoordinates(stop));
 
                 if (bus_empty)
                 {
@@ -174,27 +266,27 @@ namespace map_renderer
             {
                 if (bus->is_roundtrip)
                 {
-                    SetRouteTextAdditionalProperties(route_name_roundtrip, std::string(bus->name), sphere_projector(stops_geo_coords[0]));
+                    SetRouteTextAdditionalProperties(route_name_roundtrip, std::string(catalogue_.GetBusName(bus->id)), sphere_projector(stops_geo_coords[0]));
                     map_svg.Add(route_name_roundtrip);
 
-                    SetRouteTextColorProperties(route_title_roundtrip, std::string(bus->name), palette, sphere_projector(stops_geo_coords[0]));
+                    SetRouteTextColorProperties(route_title_roundtrip, std::string(catalogue_.GetBusName(bus->id)), palette, sphere_projector(stops_geo_coords[0]));
                     map_svg.Add(route_title_roundtrip);
 
                 }
                 else
                 {
-                    SetRouteTextAdditionalProperties(route_name_roundtrip, std::string(bus->name), sphere_projector(stops_geo_coords[0]));
+                    SetRouteTextAdditionalProperties(route_name_roundtrip, std::string(catalogue_.GetBusName(bus->id)), sphere_projector(stops_geo_coords[0]));
                     map_svg.Add(route_name_roundtrip);
 
-                    SetRouteTextColorProperties(route_title_roundtrip, std::string(bus->name), palette, sphere_projector(stops_geo_coords[0]));
+                    SetRouteTextColorProperties(route_title_roundtrip, std::string(catalogue_.GetBusName(bus->id)), palette, sphere_projector(stops_geo_coords[0]));
                     map_svg.Add(route_title_roundtrip);
 
                     if (stops_geo_coords[0] != stops_geo_coords[stops_geo_coords.size() / 2])
                     {
-                        SetRouteTextAdditionalProperties(route_name_notroundtrip, std::string(bus->name), sphere_projector(stops_geo_coords[stops_geo_coords.size() / 2]));
+                        SetRouteTextAdditionalProperties(route_name_notroundtrip, std::string(catalogue_.GetBusName(bus->id)), sphere_projector(stops_geo_coords[stops_geo_coords.size() / 2]));
                         map_svg.Add(route_name_notroundtrip);
 
-                        SetRouteTextColorProperties(route_title_notroundtrip, std::string(bus->name), palette, sphere_projector(stops_geo_coords[stops_geo_coords.size() / 2]));
+                        SetRouteTextColorProperties(route_title_notroundtrip, std::string(catalogue_.GetBusName(bus->id)), palette, sphere_projector(stops_geo_coords[stops_geo_coords.size() / 2]));
                         map_svg.Add(route_title_notroundtrip);
                     }
                 }
@@ -204,7 +296,7 @@ namespace map_renderer
         }
     }
 
-    void MapRenderer::AddStopsCircle(std::vector<Stop*>& stops_)
+    void MapRenderer::AddStopsCircle(const transport::TransportCatalogue& catalogue_, std::vector<const Stop*>& stops_)
     {
         std::vector<geo::Coordinates> stops_geo_coords;
         svg::Circle icon;
@@ -213,9 +305,7 @@ namespace map_renderer
         {
             if (stop_info)
             {
-                geo::Coordinates coordinates;
-                coordinates.latitude = stop_info->latitude;
-                coordinates.longitude = stop_info->longitude;
+                const geo::Coordinates& coordinates = catalogue_.GetStopCoordinates(stop_info->id);
 
                 SetStopsCirclesProperties(icon, sphere_projector(coordinates));
                 map_svg.Add(icon);
@@ -223,7 +313,7 @@ namespace map_renderer
         }
     }
 
-    void MapRenderer::AddStopsName(std::vector<Stop*>& stops_)
+    void MapRenderer::AddStopsName(const transport::TransportCatalogue& catalogue_, std::vector<const Stop*>& stops_)
     {
         std::vector<geo::Coordinates> stops_geo_coords;
 
@@ -234,14 +324,13 @@ namespace map_renderer
         {
             if (stop_info)
             {
-                geo::Coordinates coordinates;
-                coordinates.latitude = stop_info->latitude;
-                coordinates.longitude = stop_info->longitude;
+                const geo::Coordinates& coordinates = catalogue_.GetStopCoordinates(stop_info->id);
+                const std::string name(catalogue_.GetStopName(stop_info->id));
 
-                SetStopsTextAdditionalProperties(svg_stop_name, stop_info->name, sphere_projector(coordinates));
+                SetStopsTextAdditionalProperties(svg_stop_name, name, sphere_projector(coordinates));
                 map_svg.Add(svg_stop_name);
 
-                SetStopsTextColorProperties(svg_stop_name_title, stop_info->name, sphere_projector(coordinates));
+                SetStopsTextColorProperties(svg_stop_name_title, name, sphere_projector(coordinates));
                 map_svg.Add(svg_stop_name_title);
             }
         }
@@ -3,6 +3,7 @@
 #include "domain.h"
 #include "geo.h"
 #include "svg.h"
+#include "transport_catalogue.h"
 
 #include <iostream>
 #include <optional>
@@ -54,6 +55,15 @@ namespace map_renderer
         std::vector<svg::Color> color_palette;
     };
 
+    // Field by field; colors are equal when they are of the same kind and have the same components.
+    bool operator==(const RenderSettings& lhs_, const RenderSettings& rhs_);
+
+    // Hash of every field, so that maps rendered with different settings can be told apart by key.
+    struct RenderSettingsHasher
+    {
+        size_t operator()(const RenderSettings& render_settings_) const;
+    };
+
     class MapRenderer
     {
     public:
@@ -67,10 +77,11 @@ namespace map_renderer
         int GetPaletteSize() const;
         svg::Color GetColor(int line_number_) const;
 
-        void AddLine(std::vector<std::pair<Bus*, int>>& buses_palette_);
-        void AddBusesName(std::vector<std::pair<Bus*, int>>& buses_palette_);
-        void AddStopsCircle(std::vector<Stop*>& stops_name_);
-        void AddStopsName(std::vector<Stop*>& stops_name_);
+        // Routes and stop positions are read from catalogue_ by the ids of the buses and stops given.
+        void AddLine(const transport::TransportCatalogue& catalogue_, std::vector<std::pair<const Bus*, int>>& buses_palette_);
+        void AddBusesName(const transport::TransportCatalogue& catalogue_, std::vector<std::pair<const Bus*, int>>& buses_palette_);
+        void AddStopsCircle(const transport::TransportCatalogue& catalogue_, std::vector<const Stop*>& stops_name_);
+        void AddStopsName(const transport::TransportCatalogue& catalogue_, std::vector<const Stop*>& stops_name_);
 
         void GetStreamMap(std::ostream& stream_);
 
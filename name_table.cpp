@@ -0,0 +1,67 @@
+#include "name_table.h"
+#include "perfect_hash.h"
+
+#include <algorithm>
+
+namespace transport
+{
+    std::string_view NameTable::Add(std::string_view name_)
+    {
+        const uint32_t id = static_cast<uint32_t>(names.size());
+        const auto found = first_ids.find(name_);
+
+        if (found != first_ids.end())
+        {
+            names.push_back(names[found->second]);
+
+            return names.back();
+        }
+
+        // A name longer than a chunk gets a chunk of its own; the rest of the current one is left unused.
+        if (name_.size() > free_size)
+        {
+            const size_t size = std::max(CHUNK_SIZE, name_.size());
+
+            chunks.push_back(std::make_unique<char[]>(size));
+            free_begin = chunks.back().get();
+            free_size = size;
+        }
+
+        std::copy(name_.begin(), name_.end(), free_begin);
+        names.emplace_back(free_begin, name_.size());
+        free_begin += name_.size();
+        free_size -= name_.size();
+
+        first_ids.emplace(names.back(), id);
+
+        return names.back();
+    }
+
+    std::string_view NameTable::Get(uint32_t id_) const
+    {
+        return names.at(id_);
+    }
+
+    uint32_t NameTable::Find(std::string_view name_) const
+    {
+        const auto found = first_ids.find(name_);
+
+        return found != first_ids.end() ? found->second : perfect_hash::EMPTY_SLOT;
+    }
+
+    const std::vector<std::string_view>& NameTable::GetNames() const
+    {
+        return names;
+    }
+
+    size_t NameTable::GetSize() const
+    {
+        return names.size();
+    }
+
+    size_t NameTable::GetUniqCount() const
+    {
+        return first_ids.size();
+    }
+
+}//end namespace transport
\ No newline at end of file
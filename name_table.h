@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace transport
+{
+    // Names of stops or of buses, indexed by their ids. The characters are interned: a name given
+    // again shares the bytes of its first copy. They are packed into chunks that never move, so the
+    // views handed out stay valid while names are added, and an id costs one view in a flat array.
+    class NameTable
+    {
+    public:
+
+        // Names the next id, the size of the table, and returns the view the table keeps of name_.
+        std::string_view Add(std::string_view name_);
+
+        std::string_view Get(uint32_t id_) const;
+
+        // The first id given name_, or perfect_hash::EMPTY_SLOT.
+        uint32_t Find(std::string_view name_) const;
+
+        // Views of all names, indexed by id.
+        const std::vector<std::string_view>& GetNames() const;
+
+        size_t GetSize() const;
+        size_t GetUniqCount() const;
+
+    private:
+
+        static constexpr size_t CHUNK_SIZE = 1 << 16;
+
+        std::vector<std::unique_ptr<char[]>> chunks;
+        char* free_begin = nullptr;
+        size_t free_size = 0;
+
+        std::vector<std::string_view> names;
+        std::unordered_map<std::string_view, uint32_t> first_ids;
+    };
+
+}//end namespace transport
\ No newline at end of file
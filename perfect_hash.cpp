@@ -0,0 +1,173 @@
+#include "perfect_hash.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+namespace perfect_hash
+{
+    using namespace std::string_literals;
+
+    static const uint32_t MAX_SEED = 1u << 20;
+    static const int MAX_ATTEMPTS = 16;
+
+    uint64_t Mix(uint64_t value_)
+    {
+        value_ ^= value_ >> 33;
+        value_ *= 0xff51afd7ed558ccdull;
+        value_ ^= value_ >> 33;
+        value_ *= 0xc4ceb9fe1a85ec53ull;
+        value_ ^= value_ >> 33;
+        return value_;
+    }
+
+    size_t GetBucket(uint64_t hash_, size_t bucket_count_)
+    {
+        return Mix(hash_) % bucket_count_;
+    }
+
+    size_t GetSlot(uint64_t hash_, uint32_t seed_, size_t slot_count_)
+    {
+        return Mix(hash_ + seed_ * 0x9e3779b97f4a7c15ull) % slot_count_;
+    }
+
+    uint64_t HashName(std::string_view name_)
+    {
+        uint64_t hash = 0xcbf29ce484222325ull;
+
+        for (const char c : name_)
+        {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    // Places every bucket into slot_count_ slots; returns false if some bucket found no seed.
+    bool TryBuild(const std::vector<uint64_t>& hashes_, size_t slot_count_, Table& table_)
+    {
+        const size_t bucket_count = table_.seeds.size();
+        std::vector<std::vector<uint32_t>> buckets(bucket_count);
+
+        for (uint32_t i = 0; i < hashes_.size(); ++i)
+        {
+            buckets[GetBucket(hashes_[i], bucket_count)].push_back(i);
+        }
+
+        std::vector<uint32_t> order(bucket_count);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&buckets](uint32_t lhs, uint32_t rhs)
+            {
+                return buckets[lhs].size() > buckets[rhs].size();
+            });
+
+        table_.slots.assign(slot_count_, EMPTY_SLOT);
+        std::vector<size_t> bucket_slots;
+
+        for (const uint32_t bucket : order)
+        {
+            if (buckets[bucket].empty())
+            {
+                break;
+            }
+
+            uint32_t seed = 1;
+
+            for (; seed < MAX_SEED; ++seed)
+            {
+                bucket_slots.clear();
+
+                for (const uint32_t key : buckets[bucket])
+                {
+                    const size_t slot = GetSlot(hashes_[key], seed, slot_count_);
+
+                    if (table_.slots[slot] != EMPTY_SLOT || std::find(bucket_slots.begin(), bucket_slots.end(), slot) != bucket_slots.end())
+                    {
+                        break;
+                    }
+                    bucket_slots.push_back(slot);
+                }
+
+                if (bucket_slots.size() == buckets[bucket].size())
+                {
+                    break;
+                }
+            }
+
+            if (seed == MAX_SEED)
+            {
+                return false;
+            }
+
+            table_.seeds[bucket] = seed;
+
+            for (size_t i = 0; i < bucket_slots.size(); ++i)
+            {
+                table_.slots[bucket_slots[i]] = buckets[bucket][i];
+            }
+        }
+        return true;
+    }
+
+    Table Build(const std::vector<std::string_view>& names_)
+    {
+        Table table;
+
+        if (names_.empty())
+        {
+            return table;
+        }
+
+        std::vector<uint64_t> hashes(names_.size());
+        std::transform(names_.begin(), names_.end(), hashes.begin(), HashName);
+
+        // Two names per bucket on average keeps seed searches short; a table that still cannot be
+        // placed gets a few spare slots and is rebuilt.
+        size_t slot_count = names_.size();
+
+        for (int attempt = 0; attempt < MAX_ATTEMPTS; ++attempt)
+        {
+            table.seeds.assign(names_.size() / 2 + 1, 0);
+
+            if (TryBuild(hashes, slot_count, table))
+            {
+                return table;
+            }
+            slot_count += slot_count / 8 + 1;
+        }
+
+        throw std::invalid_argument("unable to build a perfect hash: names are not distinct"s);
+    }
+
+    TableView::TableView(const uint32_t* seeds_, size_t seed_count_, const uint32_t* slots_, size_t slot_count_) : seeds(seeds_), seed_count(seed_count_), slots(slots_), slot_count(slot_count_) {}
+
+    TableView::TableView(const Table& table_) : TableView(table_.seeds.data(), table_.seeds.size(), table_.slots.data(), table_.slots.size()) {}
+
+    uint32_t TableView::Find(std::string_view name_) const
+    {
+        if (seed_count == 0 || slot_count == 0)
+        {
+            return EMPTY_SLOT;
+        }
+
+        const uint64_t hash = HashName(name_);
+
+        return slots[GetSlot(hash, seeds[GetBucket(hash, seed_count)], slot_count)];
+    }
+
+    NameIndex::NameIndex(std::vector<std::string_view> names_) : names(std::move(names_)), table(Build(names)) {}
+
+    uint32_t NameIndex::Find(std::string_view name_) const
+    {
+        const uint32_t index = TableView(table).Find(name_);
+
+        return index != EMPTY_SLOT && names[index] == name_ ? index : EMPTY_SLOT;
+    }
+
+    bool NameIndex::IsEmpty() const
+    {
+        return names.empty();
+    }
+
+}//end namespace perfect_hash
\ No newline at end of file
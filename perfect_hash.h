@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include <vector>
+
+namespace perfect_hash
+{
+    static const uint32_t EMPTY_SLOT = std::numeric_limits<uint32_t>::max();
+
+    // Hash-and-displace perfect hash over a fixed set of distinct names.
+    // Names are spread over buckets by their hash; every bucket then gets the smallest seed that sends
+    // all of its names to slots nobody else took. A lookup costs two hash mixes and one array read,
+    // and a slot holds the index of its name in the key list the table was built from.
+    struct Table
+    {
+        std::vector<uint32_t> seeds;
+        std::vector<uint32_t> slots;
+    };
+
+    uint64_t HashName(std::string_view name_);
+
+    Table Build(const std::vector<std::string_view>& names_);
+
+    // Lookup over table arrays that may live outside any Table, e.g. in a memory-mapped file.
+    class TableView
+    {
+    public:
+
+        TableView() = default;
+        TableView(const uint32_t* seeds_, size_t seed_count_, const uint32_t* slots_, size_t slot_count_);
+        explicit TableView(const Table& table_);
+
+        // Index of the only name that can be equal to name_, or EMPTY_SLOT. Names outside the
+        // original set also land on some slot, so the caller must compare the name itself.
+        uint32_t Find(std::string_view name_) const;
+
+    private:
+
+        const uint32_t* seeds = nullptr;
+        size_t seed_count = 0;
+        const uint32_t* slots = nullptr;
+        size_t slot_count = 0;
+    };
+
+    // Perfect hash that keeps views of its names, so it can tell names outside the set apart itself:
+    // a miss costs the same hash, slot read and one comparison as a hit. The names must outlive it.
+    class NameIndex
+    {
+    public:
+
+        NameIndex() = default;
+        explicit NameIndex(std::vector<std::string_view> names_);
+
+        // Index of name_ in the names the index was built from, or EMPTY_SLOT.
+        uint32_t Find(std::string_view name_) const;
+
+        bool IsEmpty() const;
+
+    private:
+
+        std::vector<std::string_view> names;
+        Table table;
+    };
+
+}//end namespace perfect_hash
\ No newline at end of file
@@ -24,6 +24,10 @@ namespace ranges
         {
             return end_iter;
         }
+        size_t size() const
+        {
+            return static_cast<size_t>(std::distance(begin_iter, end_iter));
+        }
 
     private:
 
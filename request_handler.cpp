@@ -1,267 +1,609 @@
 #include "request_handler.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <numeric>
+#include <system_error>
+
 namespace request_handler 
 {
-    struct EdgeInfoGetter
+    // Keys are written in the order PrintDocument gives them, sorted, so the Writer output matches
+    // the printed document byte for byte.
+    template <typename Output>
+    struct EdgeInfoWriter
     {
-        Node operator()(const StopEdge& edge_info_)
+        Output& output;
+
+        void operator()(const StopEdge& edge_info_)
+        {
+            output.StartDict();
+            output.Key("stop_name"s).Value(std::string(edge_info_.stop_name));
+            output.Key("time"s).Value(edge_info_.time);
+            output.Key("type"s).Value("Wait"s);
+            output.EndDict();
+        }
+
+        void operator()(const BusEdge& edge_info_)
         {
-            return Builder{}.StartDict()
-                .Key("type"s).Value("Wait"s)
-                .Key("stop_name"s).Value(std::string(edge_info_.stop_name))
-                .Key("time"s).Value(edge_info_.time)
-                .EndDict().Build();
+            output.StartDict();
+            output.Key("bus"s).Value(std::string(edge_info_.bus_name));
+            output.Key("span_count"s).Value(static_cast<int>(edge_info_.span_count));
+            output.Key("time"s).Value(edge_info_.time);
+            output.Key("type"s).Value("Bus"s);
+            output.EndDict();
         }
 
-        Node operator()(const BusEdge& edge_info_)
+        void operator()(const WalkEdge& edge_info_)
         {
-            return Builder{}.StartDict()
-                .Key("type").Value("Bus")
-                .Key("bus").Value(std::string(edge_info_.bus_name))
-                .Key("span_count").Value(static_cast<int>(edge_info_.span_count))
-                .Key("time").Value(edge_info_.time)
-                .EndDict().Build();
+            output.StartDict();
+            output.Key("distance"s).Value(edge_info_.distance);
+            output.Key("time"s).Value(edge_info_.time);
+            output.Key("type"s).Value("Walk"s);
+            output.EndDict();
         }
     };
 
-    Node RequestHandler::ExecuteMakeNodeStop(int id_request_, const StopQueryResult& stop_info_) 
+    template <typename Output, typename Catalogue>
+    void RequestHandler::ExecuteWriteStop(Output& output_, int id_request_, const StopQueryResult& stop_info_, const Catalogue& catalogue_) const
     {
-        Node result;
-        Array buses;
-        Builder builder;
-
         std::string str_not_found = "not found";
 
+        output_.StartDict();
+
         if (stop_info_.not_found) 
         {
-            builder.StartDict()
-                .Key("request_id").Value(id_request_)
-                .Key("error_message").Value(str_not_found)
-                .EndDict();
-
-            result = builder.Build();
-
+            output_.Key("error_message"s).Value(str_not_found);
         }
         else 
         {
-            builder.StartDict()
-                .Key("request_id").Value(id_request_)
-                .Key("buses").StartArray();
+            output_.Key("buses"s).StartArray();
 
-            for (const std::string& bus_name : stop_info_.buses_name) 
+            for (const BusId bus_id : stop_info_.bus_ids) 
             {
-                builder.Value(bus_name);
+                output_.Value(std::string(catalogue_.GetBusName(bus_id)));
             }
 
-            builder.EndArray().EndDict();
-
-            result = builder.Build();
+            output_.EndArray();
         }
-        return result;
+        output_.Key("request_id"s).Value(id_request_);
+        output_.EndDict();
     }
 
-    Node RequestHandler::ExecuteMakeNodeBus(int id_request_, const BusQueryResult& bus_info_) 
+    template <typename Output>
+    void RequestHandler::ExecuteWriteBus(Output& output_, int id_request_, const BusQueryResult& bus_info_) const
     {
-        Node result;
         std::string str_not_found = "not found";
 
+        output_.StartDict();
+
         if (bus_info_.not_found) 
         {
-            result = Builder{}.StartDict()
-                .Key("request_id").Value(id_request_)
-                .Key("error_message").Value(str_not_found)
-                .EndDict()
-                .Build();
+            output_.Key("error_message"s).Value(str_not_found);
+            output_.Key("request_id"s).Value(id_request_);
         }
         else 
         {
-            result = Builder{}.StartDict()
-                .Key("request_id").Value(id_request_)
-                .Key("curvature").Value(bus_info_.curvature)
-                .Key("route_length").Value(bus_info_.route_length)
-                .Key("stop_count").Value(bus_info_.stops_on_route)
-                .Key("unique_stop_count").Value(bus_info_.unique_stops)
-                .EndDict()
-                .Build();
+            output_.Key("curvature"s).Value(bus_info_.curvature);
+            output_.Key("request_id"s).Value(id_request_);
+            output_.Key("route_length"s).Value(bus_info_.route_length);
+            output_.Key("stop_count"s).Value(bus_info_.stops_on_route);
+            output_.Key("unique_stop_count"s).Value(bus_info_.unique_stops);
         }
-        return result;
+        output_.EndDict();
     }
 
-    Node RequestHandler::ExecuteMakeNodeMap(int id_request_, TransportCatalogue& catalogue_, RenderSettings render_settings_) 
+    template <typename Output>
+    void RequestHandler::ExecuteWriteNearestStops(Output& output_, int id_request_, const NearestStopsResult& nearest_stops_) const
     {
-        Node result;
+        output_.StartDict();
+        output_.Key("request_id"s).Value(id_request_);
+        output_.Key("stops"s).StartArray();
 
-        std::ostringstream map_stream;
-        std::string map_str;
+        for (const NearbyStop& stop : nearest_stops_.stops)
+        {
+            output_.StartDict();
+            output_.Key("distance"s).Value(stop.distance);
+            output_.Key("name"s).Value(std::string(stop.name));
+            output_.EndDict();
+        }
 
-        MapRenderer map_catalogue(render_settings_);
+        output_.EndArray();
+        output_.EndDict();
+    }
 
-        map_catalogue.InitSphereProjector(catalogue_.GetStopCoordinates());
+    template <typename Output>
+    void RequestHandler::ExecuteWriteStopsInBox(Output& output_, int id_request_, const StopsInBoxResult& stops_in_box_) const
+    {
+        output_.StartDict();
+        output_.Key("request_id"s).Value(id_request_);
+        output_.Key("stops"s).StartArray();
 
-        ExecuteRenderMap(map_catalogue, catalogue_);
-        map_catalogue.GetStreamMap(map_stream);
-        map_str = map_stream.str();
+        for (std::string_view stop_name : stops_in_box_.stops)
+        {
+            output_.Value(std::string(stop_name));
+        }
 
-        result = Builder{}
-            .StartDict()
-            .Key("request_id"s).Value(id_request_)
-            .Key("map"s).Value(map_str)
-            .EndDict().Build();
+        output_.EndArray();
+        output_.EndDict();
+    }
+
+    template <typename Output>
+    void RequestHandler::ExecuteWriteMap(Output& output_, int id_request_, const RenderedMap& map_) const
+    {
+        output_.StartDict();
 
-        return result;
+        if constexpr (std::is_same_v<Output, Writer>)
+        {
+            output_.Key("map"s).EscapedValue(map_.escaped_svg);
+        }
+        else
+        {
+            output_.Key("map"s).Value(map_.svg);
+        }
+
+        output_.Key("request_id"s).Value(id_request_);
+        output_.EndDict();
     }
 
-    Node RequestHandler::ExecuteMakeNodeRoute(StatRequest& request_, TransportCatalogue& catalogue_, TransportRouter& routing_) 
+    template <typename Output>
+    void RequestHandler::ExecuteWriteRoute(Output& output_, int id_request_, const std::optional<RouteInfo>& route_info_) const
     {
-        const auto& route_info = GetRouteInfo(request_.from, request_.to, catalogue_, routing_);
+        output_.StartDict();
 
-        if (!route_info) 
+        if (!route_info_) 
         {
-            return Builder{}.StartDict()
-                .Key("request_id").Value(request_.id)
-                .Key("error_message").Value("not found")
-                .EndDict()
-                .Build();
+            output_.Key("error_message"s).Value("not found"s);
+            output_.Key("request_id"s).Value(id_request_);
+            output_.EndDict();
+            return;
         }
 
-        Array items;
-        for (const auto& item : route_info->edges) 
+        output_.Key("items"s).StartArray();
+
+        for (const auto& item : route_info_->edges) 
         {
-            items.emplace_back(std::visit(EdgeInfoGetter{}, item));
+            std::visit(EdgeInfoWriter<Output>{ output_ }, item);
         }
 
-        return Builder{}.StartDict()
-            .Key("request_id").Value(request_.id)
-            .Key("total_time").Value(route_info->total_time)
-            .Key("items").Value(items)
-            .EndDict()
-            .Build();
+        output_.EndArray();
+        output_.Key("request_id"s).Value(id_request_);
+        output_.Key("total_time"s).Value(route_info_->total_time);
+        output_.EndDict();
     }
 
-    void RequestHandler::ExecuteQueries(TransportCatalogue& catalogue_, std::vector<StatRequest>& stat_requests_, RenderSettings& render_settings_, RoutingSettings& routing_settings_)
+    template <typename Output>
+    void RequestHandler::ExecuteWriteEarliestArrival(Output& output_, int id_request_, double departure_time_, const std::optional<RouteInfo>& route_info_) const
     {
-        std::vector<Node> result_request;
-        TransportRouter routing(catalogue_, routing_settings_);
+        output_.StartDict();
 
+        if (!route_info_)
+        {
+            output_.Key("error_message"s).Value("not found"s);
+            output_.Key("request_id"s).Value(id_request_);
+            output_.EndDict();
+            return;
+        }
 
-        for (StatRequest req : stat_requests_) 
+        output_.Key("arrival_time"s).Value(departure_time_ + route_info_->total_time);
+        output_.Key("items"s).StartArray();
+
+        for (const auto& item : route_info_->edges)
         {
-            if (req.type == "Stop") 
+            std::visit(EdgeInfoWriter<Output>{ output_ }, item);
+        }
+
+        output_.EndArray();
+        output_.Key("request_id"s).Value(id_request_);
+        output_.Key("total_time"s).Value(route_info_->total_time);
+        output_.EndDict();
+    }
+
+    template <typename Output>
+    void RequestHandler::ExecuteWriteResponse(Output& output_, const StatRequest& request_, const QueryResult& result_, const TransportCatalogue& catalogue_, const RenderSettings& render_settings_) const
+    {
+        if (request_.type == "Stop") 
+        {
+            ExecuteWriteStop(output_, request_.id, std::get<StopQueryResult>(result_), catalogue_);
+        }
+        else if (request_.type == "Bus") 
+        {
+            ExecuteWriteBus(output_, request_.id, std::get<BusQueryResult>(result_));
+        }
+        else if (request_.type == "Map") 
+        {
+            ExecuteWriteMap(output_, request_.id, *GetRenderedMap(catalogue_, render_settings_));
+        }
+        else if (request_.type == "Route") 
+        {
+            ExecuteWriteRoute(output_, request_.id, std::get<std::optional<RouteInfo>>(result_));
+        }
+        else if (request_.type == "EarliestArrival")
+        {
+            ExecuteWriteEarliestArrival(output_, request_.id, request_.departure_time, std::get<std::optional<RouteInfo>>(result_));
+        }
+        else if (request_.type == "NearestStops")
+        {
+            ExecuteWriteNearestStops(output_, request_.id, std::get<NearestStopsResult>(result_));
+        }
+        else if (request_.type == "StopsInBox")
+        {
+            ExecuteWriteStopsInBox(output_, request_.id, std::get<StopsInBoxResult>(result_));
+        }
+    }
+
+    RequestHandler::QueryResult RequestHandler::ExecuteQuery(const StatRequest& request_, const TransportCatalogue& catalogue_, const TransportRouter& routing_) const
+    {
+        if (request_.type == "Stop") 
+        {
+            return StopQuery(catalogue_, request_.name);
+        }
+        else if (request_.type == "Bus") 
+        {
+            return BusQuery(catalogue_, request_.name);
+        }
+        else if (request_.type == "Route") 
+        {
+            if (request_.from_coordinates || request_.to_coordinates)
             {
-                result_request.push_back(ExecuteMakeNodeStop(req.id, StopQuery(catalogue_, req.name)));
+                return GetPointRouteInfo(request_, catalogue_, routing_);
             }
-            else if (req.type == "Bus") 
+            return GetRouteInfo(request_.from, request_.to, catalogue_, routing_);
+        }
+        else if (request_.type == "EarliestArrival")
+        {
+            return routing_.GetTimetableRouteInfo(catalogue_, catalogue_.GetStop(request_.from), catalogue_.GetStop(request_.to), request_.departure_time);
+        }
+        else if (request_.type == "NearestStops")
+        {
+            return NearestStopsQuery(catalogue_, request_.coordinates, request_.count);
+        }
+        else if (request_.type == "StopsInBox")
+        {
+            return StopsInBoxQuery(catalogue_, request_.box_min, request_.box_max);
+        }
+        return std::monostate{};
+    }
+
+    // The calling thread works alongside the group's own threads, which sleep between batches. Tasks
+    // are taken from a shared counter, so a few slow routes do not hold up a whole share of the batch.
+    // The first exception stops the batch and is rethrown on the calling thread.
+    class RequestHandler::WorkerGroup
+    {
+    public:
+
+        explicit WorkerGroup(size_t threads_count_)
+        {
+            try
             {
-                result_request.push_back(ExecuteMakeNodeBus(req.id, BusQuery(catalogue_, req.name)));
+                for (size_t i = 1; i < threads_count_; ++i)
+                {
+                    threads.emplace_back([this]() { Work(); });
+                }
             }
-            else if (req.type == "Map") 
+            catch (const std::system_error&)
             {
-                result_request.push_back(ExecuteMakeNodeMap(req.id, catalogue_, render_settings_));
+                // Fewer threads than asked for still answer every request.
             }
-            else if (req.type == "Route") 
+        }
+
+        WorkerGroup(const WorkerGroup&) = delete;
+        WorkerGroup& operator=(const WorkerGroup&) = delete;
+
+        ~WorkerGroup()
+        {
             {
-                result_request.push_back(ExecuteMakeNodeRoute(req, catalogue_, routing));
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+
+            for (std::thread& thread : threads)
+            {
+                thread.join();
             }
         }
 
-        document = Document{ Node(result_request) };
-    }
+        // Calls task_(i) for every i below count_ and returns once all of them are done.
+        void Run(size_t count_, const std::function<void(size_t)>& task_)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                task = &task_;
+                task_count = count_;
+                next_task = 0;
+                failed = false;
+                error = nullptr;
+                busy_count = threads.size();
+                ++generation;
+            }
+            wake.notify_all();
 
-    void RequestHandler::ExecuteRenderMap(MapRenderer& map_catalogue_, TransportCatalogue& catalogue_) const 
-    {
-        std::vector<std::pair<Bus*, int>> buses_palette;
-        std::vector<Stop*> stops_sort;
-        int palette_size = 0;
-        int palette_index = 0;
+            RunTasks();
 
-        palette_size = map_catalogue_.GetPaletteSize();
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [this]() { return busy_count == 0; });
 
-        if (palette_size == 0)
-        {
-            std::cout << "color palette is empty";
-            return;
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
         }
 
-        BusMap buses = catalogue_.GetBusnameToBus();
-        if (buses.size() > 0) 
+    private:
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable done;
+
+        const std::function<void(size_t)>* task = nullptr;
+        size_t task_count = 0;
+        std::atomic<size_t> next_task{ 0 };
+        std::atomic<bool> failed{ false };
+        std::exception_ptr error;
+
+        size_t busy_count = 0;
+        uint64_t generation = 0;
+        bool stopping = false;
+
+        std::vector<std::thread> threads;
+
+        void Work()
         {
-            for (std::string_view bus_name : catalogue_.GetSortedBusesNames()) 
-            {
-                Bus* bus_info = catalogue_.GetBus(bus_name);
+            uint64_t seen_generation = 0;
 
-                if (bus_info) 
+            while (true)
+            {
                 {
-                    if (bus_info->stops.size() > 0) 
-                    {
-                        buses_palette.push_back(std::make_pair(bus_info, palette_index));
-                        palette_index++;
+                    std::unique_lock<std::mutex> lock(mutex);
+                    wake.wait(lock, [this, seen_generation]() { return stopping || generation != seen_generation; });
 
-                        if (palette_index == palette_size) 
-                        {
-                            palette_index = 0;
-                        }
+                    if (stopping)
+                    {
+                        return;
                     }
+                    seen_generation = generation;
+                }
+
+                RunTasks();
+
+                std::lock_guard<std::mutex> lock(mutex);
+
+                if (--busy_count == 0)
+                {
+                    done.notify_one();
                 }
             }
+        }
 
-            if (buses_palette.size() > 0) 
+        void RunTasks()
+        {
+            for (size_t i = next_task++; i < task_count && !failed; i = next_task++)
             {
-                map_catalogue_.AddLine(buses_palette);
-                map_catalogue_.AddBusesName(buses_palette);
+                try
+                {
+                    (*task)(i);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+
+                    if (!error)
+                    {
+                        error = std::current_exception();
+                    }
+                    failed = true;
+                }
             }
         }
+    };
+
+    void RequestHandler::ExecuteBatch(WorkerGroup& workers_, const StatRequest* requests_, QueryResult* results_, size_t count_, const TransportCatalogue& catalogue_, const TransportRouter& routing_) const
+    {
+        workers_.Run(count_, [&](size_t i_)
+            {
+                results_[i_] = ExecuteQuery(requests_[i_], catalogue_, routing_);
+            });
+    }
+
+    // Requests are answered a batch at a time and each batch is written before the next one starts,
+    // so memory holds one batch of answers however many requests there are.
+    template <typename Output>
+    void RequestHandler::ExecuteAll(Output& output_, const TransportCatalogue& catalogue_, const std::vector<StatRequest>& stat_requests_, const RenderSettings& render_settings_, const TransportRouter& routing_) const
+    {
+        std::vector<QueryResult> results(std::min(BATCH_SIZE, stat_requests_.size()));
+        WorkerGroup workers(std::min(threads_count, results.size()));
+
+        output_.StartArray();
 
-        auto stops = catalogue_.GetStopnameToStop();
-        if (stops.size() > 0) 
+        for (size_t first = 0; first < stat_requests_.size(); first += BATCH_SIZE)
         {
-            std::vector<std::string_view> stops_name;
+            const size_t count = std::min(BATCH_SIZE, stat_requests_.size() - first);
 
-            for (auto& [stop_name, stop] : stops) 
+            ExecuteBatch(workers, stat_requests_.data() + first, results.data(), count, catalogue_, routing_);
+
+            for (size_t i = 0; i < count; ++i)
             {
-                if (stop->buses.size() > 0) 
-                {
-                    stops_name.push_back(stop_name);
-                }
+                ExecuteWriteResponse(output_, stat_requests_[first + i], results[i], catalogue_, render_settings_);
             }
+        }
+
+        output_.EndArray();
+    }
+
+    void RequestHandler::ExecuteQueries(TransportCatalogue& catalogue_, std::vector<StatRequest>& stat_requests_, RenderSettings& render_settings_, RoutingSettings& routing_settings_)
+    {
+        TransportRouter routing(catalogue_, routing_settings_);
+
+        ExecuteQueries(catalogue_, stat_requests_, render_settings_, routing);
+    }
+
+    void RequestHandler::ExecuteQueries(const TransportCatalogue& catalogue_, const std::vector<StatRequest>& stat_requests_, const RenderSettings& render_settings_, const TransportRouter& routing_)
+    {
+        arena = std::make_shared<Arena>();
+        Builder builder(arena.get());
+
+        ExecuteAll(builder, catalogue_, stat_requests_, render_settings_, routing_);
+
+        document = Document(builder.Build(), arena);
+    }
+
+    void RequestHandler::ExecuteQueries(const TransportCatalogue& catalogue_, const std::vector<StatRequest>& stat_requests_, const RenderSettings& render_settings_, const TransportRouter& routing_, Writer& writer_) const
+    {
+        ExecuteAll(writer_, catalogue_, stat_requests_, render_settings_, routing_);
+    }
+
+    void RequestHandler::ExecuteQueries(const CatalogueView& view_, const std::vector<StatRequest>& stat_requests_, Writer& writer_) const
+    {
+        writer_.StartArray();
+
+        for (const StatRequest& request : stat_requests_)
+        {
+            if (request.type == "Stop")
+            {
+                ExecuteWriteStop(writer_, request.id, StopQuery(view_, request.name), view_);
+            }
+            else if (request.type == "Bus")
+            {
+                ExecuteWriteBus(writer_, request.id, BusQuery(view_, request.name));
+            }
+            else
+            {
+                throw std::invalid_argument("request type '"s + request.type + "' needs the full catalogue"s);
+            }
+        }
+
+        writer_.EndArray();
+    }
+
+    bool RequestHandler::IsViewQuery(const StatRequest& request_)
+    {
+        return request_.type == "Stop" || request_.type == "Bus";
+    }
+
+    void RequestHandler::SetThreadsCount(size_t threads_count_)
+    {
+        threads_count = std::max<size_t>(threads_count_, 1);
+    }
+
+    std::string RequestHandler::RenderMap(const TransportCatalogue& catalogue_, RenderSettings render_settings_) const
+    {
+        std::ostringstream map_stream;
+
+        MapRenderer map_catalogue(render_settings_);
 
-            std::sort(stops_name.begin(), stops_name.end());
+        map_catalogue.InitSphereProjector(catalogue_.GetStopCoordinates());
+
+        ExecuteRenderMap(map_catalogue, catalogue_);
+        map_catalogue.GetStreamMap(map_stream);
+
+        return map_stream.str();
+    }
+
+    // Renders under the lock, so that threads asking for the same map at once render it only once.
+    std::shared_ptr<const RequestHandler::RenderedMap> RequestHandler::GetRenderedMap(const TransportCatalogue& catalogue_, const RenderSettings& render_settings_) const
+    {
+        const uint64_t catalogue_version = catalogue_.GetVersion();
+        const size_t settings_hash = RenderSettingsHasher{}(render_settings_);
+
+        std::lock_guard<std::mutex> lock(map_cache->mutex);
+
+        if (map_cache->map && map_cache->map->catalogue_version == catalogue_version && map_cache->map->settings_hash == settings_hash
+            && map_cache->map->render_settings == render_settings_)
+        {
+            return map_cache->map;
+        }
+
+        auto map = std::make_shared<RenderedMap>();
+        map->catalogue_version = catalogue_version;
+        map->settings_hash = settings_hash;
+        map->render_settings = render_settings_;
+        map->svg = RenderMap(catalogue_, render_settings_);
+        map->escaped_svg = EscapeString(map->svg);
+
+        map_cache->map = map;
+        return map;
+    }
+
+    void RequestHandler::ExecuteRenderMap(MapRenderer& map_catalogue_, const TransportCatalogue& catalogue_) const 
+    {
+        std::vector<std::pair<const Bus*, int>> buses_palette;
+        std::vector<const Stop*> stops_sort;
+        int palette_size = 0;
+        int palette_index = 0;
+
+        palette_size = map_catalogue_.GetPaletteSize();
+
+        if (palette_size == 0)
+        {
+            std::cout << "color palette is empty";
+            return;
+        }
 
-            for (const std::string_view stop_name : stops_name) 
+        for (const Bus* bus_info : catalogue_.GetSortedBuses()) 
+        {
+            if (catalogue_.GetBusStopIds(bus_info->id).size() > 0) 
             {
-                Stop* stop = catalogue_.GetStop(stop_name);
-                if (stop) 
+                buses_palette.push_back(std::make_pair(bus_info, palette_index));
+                palette_index++;
+
+                if (palette_index == palette_size) 
                 {
-                    stops_sort.push_back(stop);
+                    palette_index = 0;
                 }
             }
+        }
+
+        if (buses_palette.size() > 0) 
+        {
+            map_catalogue_.AddLine(catalogue_, buses_palette);
+            map_catalogue_.AddBusesName(catalogue_, buses_palette);
+        }
 
-            if (stops_sort.size() > 0) 
+        for (const Stop* stop : catalogue_.GetSortedStops()) 
+        {
+            if (catalogue_.GetStopBusIds(stop->id).size() > 0) 
             {
-                map_catalogue_.AddStopsCircle(stops_sort);
-                map_catalogue_.AddStopsName(stops_sort);
+                stops_sort.push_back(stop);
             }
         }
+
+        if (stops_sort.size() > 0) 
+        {
+            map_catalogue_.AddStopsCircle(catalogue_, stops_sort);
+            map_catalogue_.AddStopsName(catalogue_, stops_sort);
+        }
     }
 
-    std::optional<RouteInfo> RequestHandler::GetRouteInfo(std::string_view start_, std::string_view end_, TransportCatalogue& catalogue_, TransportRouter& routing_) const 
+    std::optional<RouteInfo> RequestHandler::GetRouteInfo(std::string_view start_, std::string_view end_, const TransportCatalogue& catalogue_, const TransportRouter& routing_) const 
     {
         return routing_.GetRouterInfo(routing_.GetRouterByStop(catalogue_.GetStop(start_))->bus_wait_start, routing_.GetRouterByStop(catalogue_.GetStop(end_))->bus_wait_start);
 
     }
 
-    BusQueryResult RequestHandler::BusQuery(TransportCatalogue& catalogue_, std::string_view bus_name_) 
+    std::optional<RouteInfo> RequestHandler::GetPointRouteInfo(const StatRequest& request_, const TransportCatalogue& catalogue_, const TransportRouter& routing_) const
+    {
+        const RoutePoint from = request_.from_coordinates ? RoutePoint{ *request_.from_coordinates } : RoutePoint{ catalogue_.GetStop(request_.from) };
+        const RoutePoint to = request_.to_coordinates ? RoutePoint{ *request_.to_coordinates } : RoutePoint{ catalogue_.GetStop(request_.to) };
+
+        return routing_.GetRouterInfo(catalogue_, from, to);
+    }
+
+    BusQueryResult RequestHandler::BusQuery(const TransportCatalogue& catalogue_, std::string_view bus_name_) const
     {
         BusQueryResult bus_info;
-        Bus* bus = catalogue_.GetBus(bus_name_);
+        const Bus* bus = catalogue_.GetBus(bus_name_);
 
         if (bus != nullptr) 
         {
-            bus_info.name = bus->name;
+            bus_info.name = catalogue_.GetBusName(bus->id);
             bus_info.not_found = false;
-            bus_info.stops_on_route = static_cast<int>(bus->stops.size());
-            bus_info.unique_stops = static_cast<int>(catalogue_.GetUniqStops(bus).size());
+            bus_info.stops_on_route = static_cast<int>(catalogue_.GetBusStopIds(bus->id).size());
+            bus_info.unique_stops = static_cast<int>(bus->unique_stops);
             bus_info.route_length = static_cast<int>(bus->route_length);
-            bus_info.curvature = double(catalogue_.GetDistanceToBus(bus) / catalogue_.GetLength(bus));
+            bus_info.curvature = double(bus->route_length / bus->geo_length);
         }
         else 
         {
@@ -271,36 +613,111 @@ namespace request_handler
         return bus_info;
     }
 
-    StopQueryResult RequestHandler::StopQuery(TransportCatalogue& catalogue_, std::string_view stop_name_) 
+    StopQueryResult RequestHandler::StopQuery(const TransportCatalogue& catalogue_, std::string_view stop_name_) const
     {
-        std::unordered_set<const Bus*> unique_buses;
         StopQueryResult stop_info;
-        Stop* stop = catalogue_.GetStop(stop_name_);
+        const Stop* stop = catalogue_.GetStop(stop_name_);
 
         if (stop != nullptr) 
         {
-            stop_info.name = stop->name;
+            stop_info.name = catalogue_.GetStopName(stop->id);
             stop_info.not_found = false;
-            unique_buses = catalogue_.StopGetUniqBuses(stop);
+            stop_info.bus_ids = catalogue_.GetStopBusIds(stop->id);
+        }
+        else 
+        {
+            stop_info.name = stop_name_;
+            stop_info.not_found = true;
+        }
+        return stop_info;
+    }
 
-            if (unique_buses.size() > 0) 
-            {
-                for (const Bus* bus : unique_buses) 
+    // The same sums as the catalogue makes when the bus is added, in the same order, so curvature comes out the same.
+    BusQueryResult RequestHandler::BusQuery(const CatalogueView& view_, std::string_view bus_name_) const
+    {
+        BusQueryResult bus_info;
+        const std::optional<BusView> bus = view_.GetBus(bus_name_);
+
+        if (!bus)
+        {
+            bus_info.name = bus_name_;
+            bus_info.not_found = true;
+
+            return bus_info;
+        }
+
+        std::vector<StopIndex> unique_stops(bus->stops.begin(), bus->stops.end());
+
+        std::sort(unique_stops.begin(), unique_stops.end());
+        unique_stops.erase(std::unique(unique_stops.begin(), unique_stops.end()), unique_stops.end());
+
+        double geo_length = 0.0;
+
+        if (bus->stops.begin() != bus->stops.end())
+        {
+            geo_length = std::transform_reduce(std::next(bus->stops.begin()), bus->stops.end(), bus->stops.begin(), 0.0, std::plus<>{}, [&view_](StopIndex lhs_, StopIndex rhs_)
                 {
-                    stop_info.buses_name.push_back(bus->name);
-                }
+                    const StopView lhs = view_.GetStop(lhs_);
+                    const StopView rhs = view_.GetStop(rhs_);
 
-                std::sort(stop_info.buses_name.begin(), stop_info.buses_name.end());
-            }
+                    return geo::ComputeDistance({ lhs.latitude, lhs.longitude }, { rhs.latitude, rhs.longitude });
+                });
         }
-        else 
+
+        bus_info.name = bus->name;
+        bus_info.not_found = false;
+        bus_info.stops_on_route = static_cast<int>(bus->stops.size());
+        bus_info.unique_stops = static_cast<int>(unique_stops.size());
+        bus_info.route_length = static_cast<int>(bus->route_length);
+        bus_info.curvature = double(bus->route_length / geo_length);
+
+        return bus_info;
+    }
+
+    StopQueryResult RequestHandler::StopQuery(const CatalogueView& view_, std::string_view stop_name_) const
+    {
+        StopQueryResult stop_info;
+        const std::optional<StopView> stop = view_.GetStop(stop_name_);
+
+        if (!stop)
         {
             stop_info.name = stop_name_;
             stop_info.not_found = true;
+
+            return stop_info;
         }
+
+        stop_info.name = stop->name;
+        stop_info.not_found = false;
+        stop_info.bus_ids = view_.StopGetUniqBuses(stop->index);
+
         return stop_info;
     }
 
+    NearestStopsResult RequestHandler::NearestStopsQuery(const TransportCatalogue& catalogue_, geo::Coordinates point_, int count_) const
+    {
+        NearestStopsResult nearest_stops;
+
+        for (const SpatialIndex::Neighbour& neighbour : catalogue_.GetNearestStops(point_, static_cast<size_t>(std::max(0, count_))))
+        {
+            nearest_stops.stops.push_back({ catalogue_.GetStopName(neighbour.id), neighbour.distance });
+        }
+        return nearest_stops;
+    }
+
+    StopsInBoxResult RequestHandler::StopsInBoxQuery(const TransportCatalogue& catalogue_, geo::Coordinates min_, geo::Coordinates max_) const
+    {
+        StopsInBoxResult stops_in_box;
+
+        for (const StopId id : catalogue_.GetStopsInBox(min_, max_))
+        {
+            stops_in_box.stops.push_back(catalogue_.GetStopName(id));
+        }
+        std::sort(stops_in_box.stops.begin(), stops_in_box.stops.end());
+
+        return stops_in_box;
+    }
+
     const Document& RequestHandler::GetDocument() 
     {
         return document;
@@ -1,13 +1,18 @@
 #pragma once
 
 #include "transport_catalogue.h"
+#include "catalogue_view.h"
 #include "map_renderer.h"
 #include "json_builder.h"
+#include "json_writer.h"
 #include "transport_router.h"
 
 #include <string_view>
 #include <variant>
 #include <sstream>
+#include <thread>
+#include <mutex>
+#include <memory>
 
 namespace request_handler
 {
@@ -22,24 +27,102 @@ namespace request_handler
 
         RequestHandler() = default;
 
-        std::optional<RouteInfo> GetRouteInfo(std::string_view start_, std::string_view end_, TransportCatalogue& catalogue_, TransportRouter& routing_) const;
+        std::optional<RouteInfo> GetRouteInfo(std::string_view start_, std::string_view end_, const TransportCatalogue& catalogue_, const TransportRouter& routing_) const;
 
         void ExecuteQueries(TransportCatalogue& catalogue_, std::vector<StatRequest>& stat_requests_, RenderSettings& render_settings_, RoutingSettings& route_settings_);
-        void ExecuteRenderMap(MapRenderer& map_catalogue_, TransportCatalogue& catalogue_) const;
+        // Same, over a router that is already built, e.g. one loaded from a saved base.
+        void ExecuteQueries(const TransportCatalogue& catalogue_, const std::vector<StatRequest>& stat_requests_, const RenderSettings& render_settings_, const TransportRouter& routing_);
+        // Writes the array of responses to writer_ one batch at a time, as the batches are answered;
+        // GetDocument is left as it was.
+        void ExecuteQueries(const TransportCatalogue& catalogue_, const std::vector<StatRequest>& stat_requests_, const RenderSettings& render_settings_, const TransportRouter& routing_, Writer& writer_) const;
+        // Answers Bus and Stop requests straight from the image of a saved base, with no catalogue or
+        // router loaded, one request after another; any other request throws std::invalid_argument.
+        void ExecuteQueries(const CatalogueView& view_, const std::vector<StatRequest>& stat_requests_, Writer& writer_) const;
+        void ExecuteRenderMap(MapRenderer& map_catalogue_, const TransportCatalogue& catalogue_) const;
+
+        // Whether ExecuteQueries over a CatalogueView answers request_.
+        static bool IsViewQuery(const StatRequest& request_);
+
+        // Requests other than Map are answered on this many threads, the calling one included;
+        // responses keep the order of the requests. Defaults to the number of hardware threads.
+        void SetThreadsCount(size_t threads_count_);
 
         const Document& GetDocument();
 
     private:
 
+        // Answer to a Stop, Bus, Route, EarliestArrival, NearestStops or StopsInBox request, computed apart from writing it so that a batch can
+        // be answered on several threads and then written in order. Map requests are rendered as they
+        // are written, so that no more than one map is held at a time.
+        using QueryResult = std::variant<std::monostate, StopQueryResult, BusQueryResult, std::optional<RouteInfo>, NearestStopsResult, StopsInBoxResult>;
+
+        static constexpr size_t BATCH_SIZE = 1024;
+
+        // Threads started once per ExecuteQueries call and handed one batch after another.
+        class WorkerGroup;
+
+        // A map rendered for one catalogue version and one set of render settings, with its text
+        // escaped for a JSON string, so that a repeated Map request is only copied out. The hash
+        // rules out most other settings at once; the settings themselves decide.
+        struct RenderedMap
+        {
+            uint64_t catalogue_version = 0;
+            size_t settings_hash = 0;
+            RenderSettings render_settings;
+            std::string svg;
+            std::string escaped_svg;
+        };
+
+        // Shared by copies of the handler; the server reads it from several threads.
+        struct MapCache
+        {
+            std::mutex mutex;
+            std::shared_ptr<const RenderedMap> map;
+        };
+
         Document document; // json::
 
-        BusQueryResult BusQuery(TransportCatalogue& catalogue_, std::string_view str_);
-        StopQueryResult StopQuery(TransportCatalogue& catalogue_, std::string_view stop_name_);
+        // Responses of the current ExecuteQueries call are built here and handed to the document.
+        std::shared_ptr<Arena> arena;
+
+        size_t threads_count = std::max(1u, std::thread::hardware_concurrency());
+
+        std::shared_ptr<MapCache> map_cache = std::make_shared<MapCache>();
+
+        // Route with one or both ends given by coordinates; an unknown stop name finds no route.
+        std::optional<RouteInfo> GetPointRouteInfo(const StatRequest& request_, const TransportCatalogue& catalogue_, const TransportRouter& routing_) const;
+        BusQueryResult BusQuery(const TransportCatalogue& catalogue_, std::string_view str_) const;
+        StopQueryResult StopQuery(const TransportCatalogue& catalogue_, std::string_view stop_name_) const;
+        BusQueryResult BusQuery(const CatalogueView& view_, std::string_view bus_name_) const;
+        StopQueryResult StopQuery(const CatalogueView& view_, std::string_view stop_name_) const;
+        NearestStopsResult NearestStopsQuery(const TransportCatalogue& catalogue_, geo::Coordinates point_, int count_) const;
+        StopsInBoxResult StopsInBoxQuery(const TransportCatalogue& catalogue_, geo::Coordinates min_, geo::Coordinates max_) const;
+        QueryResult ExecuteQuery(const StatRequest& request_, const TransportCatalogue& catalogue_, const TransportRouter& routing_) const;
+        void ExecuteBatch(WorkerGroup& workers_, const StatRequest* requests_, QueryResult* results_, size_t count_, const TransportCatalogue& catalogue_, const TransportRouter& routing_) const;
+        std::string RenderMap(const TransportCatalogue& catalogue_, RenderSettings render_settings_) const;
+        std::shared_ptr<const RenderedMap> GetRenderedMap(const TransportCatalogue& catalogue_, const RenderSettings& render_settings_) const;
+
+        // Responses go to an Output, either a json::Builder or a json::Writer: both take the same calls.
+        template <typename Output>
+        void ExecuteAll(Output& output_, const TransportCatalogue& catalogue_, const std::vector<StatRequest>& stat_requests_, const RenderSettings& render_settings_, const TransportRouter& routing_) const;
+        template <typename Output>
+        void ExecuteWriteResponse(Output& output_, const StatRequest& request_, const QueryResult& result_, const TransportCatalogue& catalogue_, const RenderSettings& render_settings_) const;
 
-        Node ExecuteMakeNodeStop(int id_request_, const StopQueryResult& query_result_);
-        Node ExecuteMakeNodeBus(int id_request_, const BusQueryResult& query_result_);
-        Node ExecuteMakeNodeRoute(StatRequest& recuest_, TransportCatalogue& catalogue_, TransportRouter& routing_);
-        Node ExecuteMakeNodeMap(int id_request_, TransportCatalogue& catalogue_, RenderSettings render_settings_);
+        // Catalogue is the TransportCatalogue or the CatalogueView the query ran on, which names its buses.
+        template <typename Output, typename Catalogue>
+        void ExecuteWriteStop(Output& output_, int id_request_, const StopQueryResult& query_result_, const Catalogue& catalogue_) const;
+        template <typename Output>
+        void ExecuteWriteBus(Output& output_, int id_request_, const BusQueryResult& query_result_) const;
+        template <typename Output>
+        void ExecuteWriteRoute(Output& output_, int id_request_, const std::optional<RouteInfo>& route_info_) const;
+        template <typename Output>
+        void ExecuteWriteEarliestArrival(Output& output_, int id_request_, double departure_time_, const std::optional<RouteInfo>& route_info_) const;
+        template <typename Output>
+        void ExecuteWriteNearestStops(Output& output_, int id_request_, const NearestStopsResult& nearest_stops_) const;
+        template <typename Output>
+        void ExecuteWriteStopsInBox(Output& output_, int id_request_, const StopsInBoxResult& stops_in_box_) const;
+        template <typename Output>
+        void ExecuteWriteMap(Output& output_, int id_request_, const RenderedMap& map_) const;
     };
 
 }//end namespace request_handler
\ No newline at end of file
@@ -1,19 +1,35 @@
 #pragma once
 
+#include "contraction_hierarchy.h"
 #include "graph.h"
+#include "scratch_pool.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstdint>
+#include <exception>
+#include <functional>
 #include <iterator>
+#include <limits>
+#include <memory>
 #include <optional>
 #include <stdexcept>
+#include <system_error>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 namespace graph
 {
+    // ALL_PAIRS fills the all-pairs table with Floyd-Warshall on one thread; ALL_PAIRS_PARALLEL
+    // fills the same table with one Dijkstra search per source, spread over the hardware threads.
+    // CONTRACTION_HIERARCHY contracts the graph once and searches only upwards from both ends.
+    // Every mode finds a route of the same weight, but where several routes tie, the modes may
+    // return different ones of them; each mode returns the same one on every run.
+    enum class RouterMode { ON_DEMAND, ALL_PAIRS, ALL_PAIRS_PARALLEL, CONTRACTION_HIERARCHY, };
+
     template <typename Weight>
     class Router
     {
@@ -21,7 +37,19 @@ namespace graph
 
     public:
 
-        explicit Router(const Graph& graph_);
+        // Precomputed part of a router: the all-pairs table or the contraction hierarchy,
+        // whichever its mode builds. Restoring a router from it skips that precomputation.
+        struct RouterData
+        {
+            RouterMode mode = RouterMode::ON_DEMAND;
+            std::vector<Weight> all_pairs_weights;
+            std::vector<CompactIndex> all_pairs_prev_edges;
+            typename ContractionHierarchy<Weight>::HierarchyData hierarchy;
+        };
+
+        // The graph must be frozen before a router is built over it.
+        explicit Router(const Graph& graph_, RouterMode mode_ = RouterMode::ON_DEMAND);
+        Router(const Graph& graph_, RouterData data_);
 
         struct RouteInfo
         {
@@ -29,125 +57,695 @@ namespace graph
             std::vector<EdgeId> edges;
         };
 
-        void Build()
+        RouterMode GetMode() const;
+        RouterData GetRouterData() const;
+
+        // Safe to call from several threads at once: each running query takes its own scratch buffers.
+        std::optional<RouteInfo> BuildRoute(VertexId from_, VertexId to_) const;
+
+        // The lightest route from any of sources_ to any of targets_, terminal weights included,
+        // found by a single search from all the sources at once rather than one per pair.
+        std::optional<TerminalRouteInfo<Weight>> BuildRoute(const std::vector<Terminal<Weight>>& sources_, const std::vector<Terminal<Weight>>& targets_) const;
+
+    private:
+
+        static constexpr Weight ZERO_WEIGHT{};
+        static constexpr VertexId NO_VERTEX = std::numeric_limits<VertexId>::max();
+        static constexpr CompactIndex NO_EDGE = std::numeric_limits<CompactIndex>::max();
+
+        struct QueueItem
         {
-            InitializeRoutesInternalData(graph);
-            const size_t vertex_count = graph.GetVertexCount();
+            Weight weight;
+            VertexId vertex;
 
-            for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through)
+            bool operator>(const QueueItem& other_) const
             {
-                RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
+                return weight > other_.weight;
             }
-        }
+        };
 
-        std::optional<RouteInfo> BuildRoute(VertexId from_, VertexId to_) const;
+        // Scratch buffers of a single-source search, sized once and reused by every search.
+        // A vertex's weight and prev_edge are valid only while its stamp equals the current one,
+        // so resetting between searches costs O(1) instead of O(V).
+        struct SearchData
+        {
+            std::vector<Weight> weights;
+            std::vector<EdgeId> prev_edges;
+            std::vector<VertexId> prev_vertices;
+            std::vector<uint32_t> stamps;
+            std::vector<QueueItem> queue;
+            uint32_t stamp = 0;
 
-    private:
+            SearchData() = default;
+            explicit SearchData(size_t vertex_count_) : weights(vertex_count_), prev_edges(vertex_count_), prev_vertices(vertex_count_), stamps(vertex_count_, 0) {}
 
-        struct RouteInternalData
+            void NextStamp()
+            {
+                if (++stamp == 0)
+                {
+                    std::fill(stamps.begin(), stamps.end(), 0);
+                    stamp = 1;
+                }
+            }
+
+            bool IsReached(VertexId vertex_) const
+            {
+                return stamps[vertex_] == stamp;
+            }
+        };
+
+        // Row-major V x V table: the weight of the best route from -> to and the last edge of
+        // that route. Unreachable cells hold UNREACHABLE_WEIGHT, the diagonal holds zero weight
+        // and NO_EDGE.
+        struct AllPairsData
         {
-            Weight weight;
-            std::optional<EdgeId> prev_edge;
+            size_t vertex_count = 0;
+            std::vector<Weight> weights;
+            std::vector<CompactIndex> prev_edges;
+
+            size_t GetIndex(VertexId from_, VertexId to_) const
+            {
+                return from_ * vertex_count + to_;
+            }
         };
 
-        using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
+        static constexpr Weight UNREACHABLE_WEIGHT = std::numeric_limits<Weight>::has_infinity ? std::numeric_limits<Weight>::infinity() : std::numeric_limits<Weight>::max();
+
+        void CheckEdgesWeights(const Graph& graph_) const
+        {
+            using namespace std::string_literals;
+
+            if (!graph_.IsFrozen())
+            {
+                throw std::logic_error("graph should be frozen before routing"s);
+            }
+
+            for (VertexId vertex = 0; vertex < graph_.GetVertexCount(); ++vertex)
+            {
+                for (const Weight weight : graph_.GetIncidentWeights(vertex))
+                {
+                    if (weight < ZERO_WEIGHT)
+                    {
+                        throw std::domain_error("Edges' weights should be non-negative"s);
+                    }
+                }
+            }
+        }
 
-        void InitializeRoutesInternalData(const Graph& graph_)
+        // A restored table is walked back the way BuildRouteAllPairs walks it, once per cell: every
+        // previous edge must exist and end at its cell's vertex, and no walk may come round in a circle.
+        void CheckAllPairs(const Graph& graph_) const
         {
             using namespace std::string_literals;
 
+            const CsrArrays<Weight>& csr = graph_.GetCsrArrays();
+            const size_t vertex_count = all_pairs.vertex_count;
+            const size_t edge_count = graph_.GetEdgeCount();
+
+            std::vector<VertexId> edge_sources(edge_count);
+
+            for (VertexId vertex = 0; vertex < vertex_count; ++vertex)
+            {
+                for (CompactIndex slot = csr.offsets[vertex]; slot < csr.offsets[vertex + 1]; ++slot)
+                {
+                    edge_sources[csr.edge_ids[slot]] = vertex;
+                }
+            }
+
+            // Per row: 0 not walked yet, 1 on the walk under way, 2 known to walk back to an end.
+            std::vector<uint8_t> states(vertex_count);
+            std::vector<VertexId> walk;
+
+            for (VertexId from = 0; from < vertex_count; ++from)
+            {
+                std::fill(states.begin(), states.end(), 0);
+
+                for (VertexId to = 0; to < vertex_count; ++to)
+                {
+                    walk.clear();
+
+                    for (VertexId vertex = to; states[vertex] == 0; )
+                    {
+                        states[vertex] = 1;
+                        walk.push_back(vertex);
+
+                        const CompactIndex edge_id = all_pairs.prev_edges[all_pairs.GetIndex(from, vertex)];
+
+                        if (edge_id == NO_EDGE)
+                        {
+                            break;
+                        }
+                        if (edge_id >= edge_count || csr.targets[csr.edge_slots[edge_id]] != vertex || states[edge_sources[edge_id]] == 1)
+                        {
+                            throw std::invalid_argument("all-pairs table does not match the graph"s);
+                        }
+                        vertex = edge_sources[edge_id];
+                    }
+
+                    for (const VertexId vertex : walk)
+                    {
+                        states[vertex] = 2;
+                    }
+                }
+            }
+        }
+
+        // Dijkstra from from_ until to_ is settled; with to_ == NO_VERTEX the whole reachable part
+        // of the graph is settled. Returns whether to_ was reached.
+        bool RunSearch(SearchData& data_, VertexId from_, VertexId to_) const
+        {
+            data_.NextStamp();
+            const uint32_t stamp = data_.stamp;
+
+            data_.queue.clear();
+            data_.weights[from_] = ZERO_WEIGHT;
+            data_.stamps[from_] = stamp;
+            data_.queue.push_back({ ZERO_WEIGHT, from_ });
+
+            while (!data_.queue.empty())
+            {
+                std::pop_heap(data_.queue.begin(), data_.queue.end(), std::greater<>{});
+                const QueueItem item = data_.queue.back();
+                data_.queue.pop_back();
+
+                if (data_.weights[item.vertex] < item.weight)
+                {
+                    continue;
+                }
+                if (item.vertex == to_)
+                {
+                    return true;
+                }
+
+                const CompactIndex* target = graph.GetIncidentTargets(item.vertex).begin();
+                const Weight* edge_weight = graph.GetIncidentWeights(item.vertex).begin();
+
+                for (const EdgeId edge_id : graph.GetIncidentEdges(item.vertex))
+                {
+                    const VertexId to = *target++;
+                    const Weight candidate_weight = item.weight + *edge_weight++;
+
+                    if (data_.stamps[to] != stamp || candidate_weight < data_.weights[to])
+                    {
+                        data_.stamps[to] = stamp;
+                        data_.weights[to] = candidate_weight;
+                        data_.prev_edges[to] = edge_id;
+                        data_.prev_vertices[to] = item.vertex;
+
+                        data_.queue.push_back({ candidate_weight, to });
+                        std::push_heap(data_.queue.begin(), data_.queue.end(), std::greater<>{});
+                    }
+                }
+            }
+
+            return false;
+        }
+
+        std::optional<RouteInfo> BuildRouteOnDemand(VertexId from_, VertexId to_) const
+        {
+            const auto lease = search_pool.Acquire([this]() { return SearchData(graph.GetVertexCount()); });
+            SearchData& data = *lease;
+
+            if (!RunSearch(data, from_, to_))
+            {
+                return std::nullopt;
+            }
+
+            std::vector<EdgeId> edges;
+
+            for (VertexId vertex = to_; vertex != from_; vertex = data.prev_vertices[vertex])
+            {
+                edges.push_back(data.prev_edges[vertex]);
+            }
+
+            std::reverse(edges.begin(), edges.end());
+
+            return RouteInfo{ data.weights[to_], std::move(edges) };
+        }
+
+        // Dijkstra from all of sources_ at once, each starting at its weight, until no target can be
+        // reached lighter than the best one so far; targets_ must be sorted by vertex, one per vertex.
+        std::optional<TerminalRouteInfo<Weight>> BuildTerminalRouteOnDemand(const std::vector<Terminal<Weight>>& sources_, const std::vector<Terminal<Weight>>& targets_) const
+        {
+            const auto lease = search_pool.Acquire([this]() { return SearchData(graph.GetVertexCount()); });
+            SearchData& data = *lease;
+
+            data.NextStamp();
+            const uint32_t stamp = data.stamp;
+
+            data.queue.clear();
+
+            for (const Terminal<Weight>& source : sources_)
+            {
+                if (data.stamps[source.vertex] != stamp || source.weight < data.weights[source.vertex])
+                {
+                    data.stamps[source.vertex] = stamp;
+                    data.weights[source.vertex] = source.weight;
+                    data.prev_vertices[source.vertex] = NO_VERTEX;
+                    data.queue.push_back({ source.weight, source.vertex });
+                }
+            }
+            std::make_heap(data.queue.begin(), data.queue.end(), std::greater<>{});
+
+            std::optional<Weight> best_weight;
+            VertexId best_target = NO_VERTEX;
+
+            while (!data.queue.empty())
+            {
+                std::pop_heap(data.queue.begin(), data.queue.end(), std::greater<>{});
+                const QueueItem item = data.queue.back();
+                data.queue.pop_back();
+
+                if (data.weights[item.vertex] < item.weight)
+                {
+                    continue;
+                }
+                if (best_weight && !(item.weight < *best_weight))
+                {
+                    break;
+                }
+
+                const auto target = std::lower_bound(targets_.begin(), targets_.end(), item.vertex, [](const Terminal<Weight>& terminal_, VertexId vertex_)
+                    {
+                        return terminal_.vertex < vertex_;
+                    });
+
+                if (target != targets_.end() && target->vertex == item.vertex && (!best_weight || item.weight + target->weight < *best_weight))
+                {
+                    best_weight = item.weight + target->weight;
+                    best_target = item.vertex;
+                }
+
+                const CompactIndex* edge_target = graph.GetIncidentTargets(item.vertex).begin();
+                const Weight* edge_weight = graph.GetIncidentWeights(item.vertex).begin();
+
+                for (const EdgeId edge_id : graph.GetIncidentEdges(item.vertex))
+                {
+                    const VertexId to = *edge_target++;
+                    const Weight candidate_weight = item.weight + *edge_weight++;
+
+                    if (data.stamps[to] != stamp || candidate_weight < data.weights[to])
+                    {
+                        data.stamps[to] = stamp;
+                        data.weights[to] = candidate_weight;
+                        data.prev_edges[to] = edge_id;
+                        data.prev_vertices[to] = item.vertex;
+
+                        data.queue.push_back({ candidate_weight, to });
+                        std::push_heap(data.queue.begin(), data.queue.end(), std::greater<>{});
+                    }
+                }
+            }
+
+            if (!best_weight)
+            {
+                return std::nullopt;
+            }
+
+            std::vector<EdgeId> edges;
+            VertexId from = best_target;
+
+            for (; data.prev_vertices[from] != NO_VERTEX; from = data.prev_vertices[from])
+            {
+                edges.push_back(data.prev_edges[from]);
+            }
+
+            std::reverse(edges.begin(), edges.end());
+
+            return TerminalRouteInfo<Weight>{ *best_weight, from, best_target, std::move(edges) };
+        }
+
+        // Every source and target pair is one lookup in the table.
+        std::optional<TerminalRouteInfo<Weight>> BuildTerminalRouteAllPairs(const std::vector<Terminal<Weight>>& sources_, const std::vector<Terminal<Weight>>& targets_) const
+        {
+            std::optional<Weight> best_weight;
+            const Terminal<Weight>* best_source = nullptr;
+            const Terminal<Weight>* best_target = nullptr;
+
+            for (const Terminal<Weight>& source : sources_)
+            {
+                const Weight* weights = all_pairs.weights.data() + all_pairs.GetIndex(source.vertex, 0);
+
+                for (const Terminal<Weight>& target : targets_)
+                {
+                    if (weights[target.vertex] == UNREACHABLE_WEIGHT)
+                    {
+                        continue;
+                    }
+
+                    const Weight weight = source.weight + weights[target.vertex] + target.weight;
+
+                    if (!best_weight || weight < *best_weight)
+                    {
+                        best_weight = weight;
+                        best_source = &source;
+                        best_target = &target;
+                    }
+                }
+            }
+
+            if (!best_weight)
+            {
+                return std::nullopt;
+            }
+
+            auto route = BuildRouteAllPairs(best_source->vertex, best_target->vertex);
+
+            return TerminalRouteInfo<Weight>{ *best_weight, best_source->vertex, best_target->vertex, std::move(route->edges) };
+        }
+
+        void InitializeAllPairs(size_t vertex_count_)
+        {
+            all_pairs.vertex_count = vertex_count_;
+            all_pairs.weights.assign(vertex_count_ * vertex_count_, UNREACHABLE_WEIGHT);
+            all_pairs.prev_edges.assign(vertex_count_ * vertex_count_, NO_EDGE);
+        }
+
+        void BuildAllPairs(const Graph& graph_)
+        {
             const size_t vertex_count = graph_.GetVertexCount();
 
+            InitializeAllPairs(vertex_count);
+
             for (VertexId vertex = 0; vertex < vertex_count; ++vertex)
             {
-                routes_internal_data[vertex][vertex] = RouteInternalData{ ZERO_WEIGHT, std::nullopt };
+                all_pairs.weights[all_pairs.GetIndex(vertex, vertex)] = ZERO_WEIGHT;
+
+                const CompactIndex* target = graph_.GetIncidentTargets(vertex).begin();
+                const Weight* edge_weight = graph_.GetIncidentWeights(vertex).begin();
 
                 for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex))
                 {
-                    const auto& edge = graph_.GetEdge(edge_id);
+                    const Weight weight = *edge_weight++;
+                    const size_t index = all_pairs.GetIndex(vertex, *target++);
 
-                    if (edge.weight < ZERO_WEIGHT)
+                    if (all_pairs.weights[index] > weight)
                     {
-                        throw std::domain_error("Edges' weights should be non-negative"s);
+                        all_pairs.weights[index] = weight;
+                        all_pairs.prev_edges[index] = static_cast<CompactIndex>(edge_id);
                     }
+                }
+            }
+
+            for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through)
+            {
+                RelaxRoutesThroughVertex(vertex_count, vertex_through);
+            }
+        }
+
+        void RelaxRoutesThroughVertex(size_t vertex_count_, VertexId vertex_through_)
+        {
+            const Weight* through_weights = all_pairs.weights.data() + all_pairs.GetIndex(vertex_through_, 0);
+            const CompactIndex* through_prev_edges = all_pairs.prev_edges.data() + all_pairs.GetIndex(vertex_through_, 0);
+
+            for (VertexId vertex_from = 0; vertex_from < vertex_count_; ++vertex_from)
+            {
+                const size_t index_from = all_pairs.GetIndex(vertex_from, vertex_through_);
+                const Weight weight_from = all_pairs.weights[index_from];
 
-                    auto& route_internal_data = routes_internal_data[vertex][edge.to];
+                if (weight_from == UNREACHABLE_WEIGHT)
+                {
+                    continue;
+                }
+
+                const CompactIndex prev_edge_from = all_pairs.prev_edges[index_from];
+                Weight* weights = all_pairs.weights.data() + all_pairs.GetIndex(vertex_from, 0);
+                CompactIndex* prev_edges = all_pairs.prev_edges.data() + all_pairs.GetIndex(vertex_from, 0);
+
+                for (VertexId vertex_to = 0; vertex_to < vertex_count_; ++vertex_to)
+                {
+                    const Weight candidate_weight = weight_from + through_weights[vertex_to];
 
-                    if (!route_internal_data || route_internal_data->weight > edge.weight)
+                    if (candidate_weight < weights[vertex_to])
                     {
-                        route_internal_data = RouteInternalData{ edge.weight, edge_id };
+                        weights[vertex_to] = candidate_weight;
+                        prev_edges[vertex_to] = through_prev_edges[vertex_to] != NO_EDGE ? through_prev_edges[vertex_to] : prev_edge_from;
                     }
                 }
             }
         }
 
-        void RelaxRoute(VertexId vertex_from_, VertexId vertex_to_, const RouteInternalData& route_from_, const RouteInternalData& route_to_)
+        // Each source owns its row of the table, so workers share nothing but the counter that
+        // hands out the next source.
+        void BuildAllPairsParallel(const Graph& graph_)
         {
-            auto& route_relaxing = routes_internal_data[vertex_from_][vertex_to_];
-            const Weight candidate_weight = route_from_.weight + route_to_.weight;
+            const size_t vertex_count = graph_.GetVertexCount();
+
+            InitializeAllPairs(vertex_count);
+
+            std::atomic<VertexId> next_source{ 0 };
+
+            const size_t threads_count = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), std::max<size_t>(vertex_count, 1));
+
+            // A worker that throws takes the remaining sources away from the others and leaves its
+            // exception here, to be rethrown once every thread has been joined.
+            std::vector<std::exception_ptr> errors(threads_count);
+
+            auto worker = [this, vertex_count, &next_source, &errors](size_t worker_index_)
+                {
+                    try
+                    {
+                        RunSources(vertex_count, next_source);
+                    }
+                    catch (...)
+                    {
+                        errors[worker_index_] = std::current_exception();
+                        next_source = static_cast<VertexId>(vertex_count);
+                    }
+                };
+
+            std::vector<std::thread> threads;
+
+            try
+            {
+                for (size_t i = 1; i < threads_count; ++i)
+                {
+                    threads.emplace_back(worker, i);
+                }
+            }
+            catch (const std::system_error&)
+            {
+                // Fewer threads than asked for still fill the whole table.
+            }
 
-            if (!route_relaxing || candidate_weight < route_relaxing->weight)
+            worker(0);
+
+            for (std::thread& thread : threads)
             {
-                route_relaxing = { candidate_weight, route_to_.prev_edge ? route_to_.prev_edge : route_from_.prev_edge };
+                thread.join();
+            }
+
+            for (const std::exception_ptr& error : errors)
+            {
+                if (error)
+                {
+                    std::rethrow_exception(error);
+                }
             }
         }
 
-        void RelaxRoutesInternalDataThroughVertex(size_t vertex_count_, VertexId vertex_through_)
+        // Takes sources from next_source_ until they run out and fills their rows of the all-pairs table.
+        void RunSources(size_t vertex_count_, std::atomic<VertexId>& next_source_)
         {
-            for (VertexId vertex_from = 0; vertex_from < vertex_count_; ++vertex_from)
+            SearchData data(vertex_count_);
+
+            for (VertexId source = next_source_++; source < vertex_count_; source = next_source_++)
             {
-                if (const auto& route_from = routes_internal_data[vertex_from][vertex_through_])
+                RunSearch(data, source, NO_VERTEX);
+
+                Weight* weights = all_pairs.weights.data() + all_pairs.GetIndex(source, 0);
+                CompactIndex* prev_edges = all_pairs.prev_edges.data() + all_pairs.GetIndex(source, 0);
+
+                for (VertexId vertex = 0; vertex < vertex_count_; ++vertex)
                 {
-                    for (VertexId vertex_to = 0; vertex_to < vertex_count_; ++vertex_to)
+                    if (data.IsReached(vertex))
                     {
-                        if (const auto& route_to = routes_internal_data[vertex_through_][vertex_to])
-                        {
-                            RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
-                        }
+                        weights[vertex] = data.weights[vertex];
+                        prev_edges[vertex] = vertex == source ? NO_EDGE : static_cast<CompactIndex>(data.prev_edges[vertex]);
                     }
                 }
             }
         }
 
-        static constexpr Weight ZERO_WEIGHT{};
+        std::optional<RouteInfo> BuildRouteAllPairs(VertexId from_, VertexId to_) const
+        {
+            const size_t index = all_pairs.GetIndex(from_, to_);
+            const Weight weight = all_pairs.weights[index];
+
+            if (weight == UNREACHABLE_WEIGHT)
+            {
+                return std::nullopt;
+            }
+
+            std::vector<EdgeId> edges;
+
+            for (CompactIndex edge_id = all_pairs.prev_edges[index]; edge_id != NO_EDGE; edge_id = all_pairs.prev_edges[all_pairs.GetIndex(from_, graph.GetEdge(edge_id).from)])
+            {
+                edges.push_back(edge_id);
+            }
+
+            std::reverse(edges.begin(), edges.end());
+
+            return RouteInfo{ weight, std::move(edges) };
+        }
+
         const Graph& graph;
-        RoutesInternalData routes_internal_data;
+        RouterMode mode;
+
+        AllPairsData all_pairs;
+        mutable ScratchPool<SearchData> search_pool;
+        std::unique_ptr<ContractionHierarchy<Weight>> contraction_hierarchy;
     };
 
     template <typename Weight>
-    Router<Weight>::Router(const Graph& graph_) : graph(graph_), routes_internal_data(graph_.GetVertexCount(), std::vector<std::optional<RouteInternalData>>(graph_.GetVertexCount()))
+    Router<Weight>::Router(const Graph& graph_, RouterMode mode_) : graph(graph_), mode(mode_)
+    {
+        CheckEdgesWeights(graph_);
+
+        if (mode == RouterMode::ALL_PAIRS)
+        {
+            BuildAllPairs(graph_);
+        }
+        else if (mode == RouterMode::ALL_PAIRS_PARALLEL)
+        {
+            BuildAllPairsParallel(graph_);
+        }
+        else if (mode == RouterMode::CONTRACTION_HIERARCHY)
+        {
+            contraction_hierarchy = std::make_unique<ContractionHierarchy<Weight>>(graph_);
+        }
+    }
+
+    template <typename Weight>
+    Router<Weight>::Router(const Graph& graph_, RouterData data_) : graph(graph_), mode(data_.mode)
     {
-        InitializeRoutesInternalData(graph_);
+        using namespace std::string_literals;
+
+        CheckEdgesWeights(graph_);
 
         const size_t vertex_count = graph_.GetVertexCount();
 
-        for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through)
+        if (mode == RouterMode::ALL_PAIRS || mode == RouterMode::ALL_PAIRS_PARALLEL)
         {
-            RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
+            if (data_.all_pairs_weights.size() != vertex_count * vertex_count || data_.all_pairs_prev_edges.size() != vertex_count * vertex_count)
+            {
+                throw std::invalid_argument("all-pairs table does not match the graph"s);
+            }
+
+            all_pairs.vertex_count = vertex_count;
+            all_pairs.weights = std::move(data_.all_pairs_weights);
+            all_pairs.prev_edges = std::move(data_.all_pairs_prev_edges);
+
+            CheckAllPairs(graph_);
+        }
+        else if (mode == RouterMode::CONTRACTION_HIERARCHY)
+        {
+            contraction_hierarchy = std::make_unique<ContractionHierarchy<Weight>>(graph_, std::move(data_.hierarchy));
+        }
+        else if (mode != RouterMode::ON_DEMAND)
+        {
+            throw std::invalid_argument("unknown router mode"s);
         }
     }
 
+    template <typename Weight>
+    RouterMode Router<Weight>::GetMode() const
+    {
+        return mode;
+    }
+
+    template <typename Weight>
+    typename Router<Weight>::RouterData Router<Weight>::GetRouterData() const
+    {
+        RouterData data;
+        data.mode = mode;
+        data.all_pairs_weights = all_pairs.weights;
+        data.all_pairs_prev_edges = all_pairs.prev_edges;
+
+        if (contraction_hierarchy)
+        {
+            data.hierarchy = contraction_hierarchy->GetHierarchyData();
+        }
+        return data;
+    }
+
     template <typename Weight>
     std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from_, VertexId to_) const
     {
-        const auto& route_internal_data = routes_internal_data.at(from_).at(to_);
+        using namespace std::string_literals;
 
-        if (!route_internal_data)
+        if (from_ >= graph.GetVertexCount() || to_ >= graph.GetVertexCount())
+        {
+            throw std::out_of_range("vertex is out of range"s);
+        }
+
+        if (mode == RouterMode::ALL_PAIRS || mode == RouterMode::ALL_PAIRS_PARALLEL)
+        {
+            return BuildRouteAllPairs(from_, to_);
+        }
+
+        if (mode == RouterMode::CONTRACTION_HIERARCHY)
+        {
+            auto route = contraction_hierarchy->BuildRoute(from_, to_);
+
+            if (!route)
+            {
+                return std::nullopt;
+            }
+            return RouteInfo{ route->weight, std::move(route->edges) };
+        }
+
+        return BuildRouteOnDemand(from_, to_);
+    }
+
+    template <typename Weight>
+    std::optional<TerminalRouteInfo<Weight>> Router<Weight>::BuildRoute(const std::vector<Terminal<Weight>>& sources_, const std::vector<Terminal<Weight>>& targets_) const
+    {
+        using namespace std::string_literals;
+
+        for (const std::vector<Terminal<Weight>>* terminals : { &sources_, &targets_ })
+        {
+            for (const Terminal<Weight>& terminal : *terminals)
+            {
+                if (terminal.vertex >= graph.GetVertexCount())
+                {
+                    throw std::out_of_range("vertex is out of range"s);
+                }
+                if (terminal.weight < ZERO_WEIGHT)
+                {
+                    throw std::domain_error("Terminals' weights should be non-negative"s);
+                }
+            }
+        }
+
+        if (sources_.empty() || targets_.empty())
         {
             return std::nullopt;
         }
 
-        const Weight weight = route_internal_data->weight;
-        std::vector<EdgeId> edges;
+        if (mode == RouterMode::ALL_PAIRS || mode == RouterMode::ALL_PAIRS_PARALLEL)
+        {
+            return BuildTerminalRouteAllPairs(sources_, targets_);
+        }
 
-        for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge; edge_id; edge_id = routes_internal_data[from_][graph.GetEdge(*edge_id).from]->prev_edge)
+        if (mode == RouterMode::CONTRACTION_HIERARCHY)
         {
-            edges.push_back(*edge_id);
+            return contraction_hierarchy->BuildRoute(sources_, targets_);
         }
 
-        std::reverse(edges.begin(), edges.end());
+        // The lightest of the terminals of each vertex, in vertex order for lookups during the search.
+        std::vector<Terminal<Weight>> targets = targets_;
+
+        std::sort(targets.begin(), targets.end(), [](const Terminal<Weight>& lhs_, const Terminal<Weight>& rhs_)
+            {
+                return lhs_.vertex < rhs_.vertex || (lhs_.vertex == rhs_.vertex && lhs_.weight < rhs_.weight);
+            });
+        targets.erase(std::unique(targets.begin(), targets.end(), [](const Terminal<Weight>& lhs_, const Terminal<Weight>& rhs_)
+            {
+                return lhs_.vertex == rhs_.vertex;
+            }), targets.end());
 
-        return RouteInfo{ weight, std::move(edges) };
+        return BuildTerminalRouteOnDemand(sources_, targets);
     }
 
 }//end namespace graph
\ No newline at end of file
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace graph
+{
+    // Scratch buffers of route queries, handed out one per running query, so that queries through the
+    // same router may run on several threads at once. A buffer returns to the pool when its lease ends
+    // and is reused by the next query; a new one is made only when all of them are taken.
+    template <typename Item>
+    class ScratchPool
+    {
+    public:
+
+        class Lease
+        {
+        public:
+
+            Lease(ScratchPool& pool_, std::unique_ptr<Item> item_) : pool(pool_), item(std::move(item_)) {}
+
+            Lease(const Lease&) = delete;
+            Lease& operator=(const Lease&) = delete;
+
+            ~Lease()
+            {
+                pool.Release(std::move(item));
+            }
+
+            Item& operator*() const
+            {
+                return *item;
+            }
+
+            Item* operator->() const
+            {
+                return item.get();
+            }
+
+        private:
+
+            ScratchPool& pool;
+            std::unique_ptr<Item> item;
+        };
+
+        ScratchPool() = default;
+
+        ScratchPool(const ScratchPool&) = delete;
+        ScratchPool& operator=(const ScratchPool&) = delete;
+
+        // make_ builds a new buffer when none is free; it is called outside the lock.
+        template <typename Make>
+        Lease Acquire(Make make_)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+
+                if (!items.empty())
+                {
+                    std::unique_ptr<Item> item = std::move(items.back());
+                    items.pop_back();
+                    return Lease(*this, std::move(item));
+                }
+            }
+            return Lease(*this, std::make_unique<Item>(make_()));
+        }
+
+    private:
+
+        std::mutex mutex;
+        std::vector<std::unique_ptr<Item>> items;
+
+        void Release(std::unique_ptr<Item> item_)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            items.push_back(std::move(item_));
+        }
+    };
+
+}//end namespace graph
\ No newline at end of file
@@ -0,0 +1,719 @@
+#include "serialization.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define TRANSPORT_BASE_MMAP
+#endif
+
+namespace serialization
+{
+    using namespace std::string_literals;
+
+    using graph::CompactIndex;
+    using graph::CsrArrays;
+    using graph::DirectedWeightedGraph;
+    using graph::Router;
+
+    static const char BASE_MAGIC[8] = { 'T', 'C', 'A', 'T', 'B', 'A', 'S', 'E' };
+    static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+    static const size_t CATALOGUE_ALIGNMENT = 8;
+
+    enum class ColorKind : uint8_t { NONE, NAME, RGB, RGBA, };
+    enum class EdgeKind : uint8_t { STOP, BUS, BOARD, RIDE, ALIGHT, };
+
+    // Values are stored in host byte order; the header records it together with the width of size_t,
+    // and a base written on an incompatible machine is rejected rather than misread.
+    class BaseWriter
+    {
+    public:
+
+        explicit BaseWriter(std::ostream& output_) : output(output_) {}
+
+        template <typename T>
+        void Write(const T& value_)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            WriteBytes(reinterpret_cast<const char*>(&value_), sizeof(T));
+        }
+
+        void WriteString(std::string_view str_)
+        {
+            Write(static_cast<uint64_t>(str_.size()));
+            WriteBytes(str_.data(), str_.size());
+        }
+
+        template <typename T>
+        void WriteArray(const std::vector<T>& values_)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            Write(static_cast<uint64_t>(values_.size()));
+            WriteBytes(reinterpret_cast<const char*>(values_.data()), values_.size() * sizeof(T));
+        }
+
+        void WriteBytes(const char* data_, size_t size_)
+        {
+            output.write(data_, size_);
+            written += size_;
+        }
+
+        // Pads the output with zero bytes up to a multiple of alignment_ from the start of the file.
+        void Align(size_t alignment_)
+        {
+            while (written % alignment_ != 0)
+            {
+                Write('\0');
+            }
+        }
+
+    private:
+
+        std::ostream& output;
+        uint64_t written = 0;
+    };
+
+    class BaseReader
+    {
+    public:
+
+        BaseReader(const char* begin_, const char* end_) : begin(begin_), position(begin_), end(end_) {}
+
+        template <typename T>
+        T Read()
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            T value;
+            std::memcpy(&value, Take(sizeof(T)), sizeof(T));
+            return value;
+        }
+
+        std::string ReadString()
+        {
+            const uint64_t size = Read<uint64_t>();
+            return std::string(Take(size), size);
+        }
+
+        template <typename T>
+        std::vector<T> ReadArray()
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            const uint64_t size = Read<uint64_t>();
+
+            if (size > static_cast<uint64_t>(end - position) / sizeof(T))
+            {
+                throw std::runtime_error("transport base is truncated"s);
+            }
+
+            std::vector<T> values(size);
+            const char* data = Take(size * sizeof(T));
+
+            if (size > 0)
+            {
+                std::memcpy(values.data(), data, size * sizeof(T));
+            }
+            return values;
+        }
+
+        const char* ReadBlock(uint64_t size_)
+        {
+            return Take(size_);
+        }
+
+        void Align(size_t alignment_)
+        {
+            Take((alignment_ - static_cast<size_t>(position - begin) % alignment_) % alignment_);
+        }
+
+        // Reads an index into an array of size_ elements.
+        uint32_t ReadIndex(size_t size_)
+        {
+            const uint32_t index = Read<uint32_t>();
+
+            if (index >= size_)
+            {
+                throw std::runtime_error("transport base is corrupted"s);
+            }
+            return index;
+        }
+
+    private:
+
+        const char* begin;
+        const char* position;
+        const char* end;
+
+        const char* Take(uint64_t size_)
+        {
+            if (size_ > static_cast<uint64_t>(end - position))
+            {
+                throw std::runtime_error("transport base is truncated"s);
+            }
+
+            const char* result = position;
+            position += size_;
+            return result;
+        }
+    };
+
+    MappedFile::MappedFile(const std::string& path_)
+    {
+#ifdef TRANSPORT_BASE_MMAP
+        const int fd = open(path_.c_str(), O_RDONLY);
+
+        if (fd >= 0)
+        {
+            struct stat file_stat;
+
+            if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0)
+            {
+                void* mapping = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+                if (mapping != MAP_FAILED)
+                {
+                    mapped_data = static_cast<const char*>(mapping);
+                    mapped_size = file_stat.st_size;
+                }
+            }
+            close(fd);
+        }
+
+        if (mapped_data)
+        {
+            return;
+        }
+#endif
+        std::ifstream input(path_, std::ios::binary);
+
+        if (!input)
+        {
+            throw std::runtime_error("unable to open transport base '"s + path_ + "'"s);
+        }
+
+        buffer.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    }
+
+    MappedFile::~MappedFile()
+    {
+#ifdef TRANSPORT_BASE_MMAP
+        if (mapped_data)
+        {
+            munmap(const_cast<char*>(mapped_data), mapped_size);
+        }
+#endif
+    }
+
+    const char* MappedFile::begin() const
+    {
+        return mapped_data ? mapped_data : buffer.data();
+    }
+
+    const char* MappedFile::end() const
+    {
+        return mapped_data ? mapped_data + mapped_size : buffer.data() + buffer.size();
+    }
+
+    void WriteColor(BaseWriter& writer_, const svg::Color& color_)
+    {
+        if (const auto* name = std::get_if<std::string>(&color_))
+        {
+            writer_.Write(ColorKind::NAME);
+            writer_.WriteString(*name);
+        }
+        else if (const auto* rgba = std::get_if<svg::Rgba>(&color_))
+        {
+            writer_.Write(ColorKind::RGBA);
+            writer_.Write(rgba->red);
+            writer_.Write(rgba->green);
+            writer_.Write(rgba->blue);
+            writer_.Write(rgba->opacity);
+        }
+        else if (const auto* rgb = std::get_if<svg::Rgb>(&color_))
+        {
+            writer_.Write(ColorKind::RGB);
+            writer_.Write(rgb->red);
+            writer_.Write(rgb->green);
+            writer_.Write(rgb->blue);
+        }
+        else
+        {
+            writer_.Write(ColorKind::NONE);
+        }
+    }
+
+    svg::Color ReadColor(BaseReader& reader_)
+    {
+        const ColorKind kind = reader_.Read<ColorKind>();
+
+        if (kind == ColorKind::NAME)
+        {
+            return svg::Color(reader_.ReadString());
+        }
+        else if (kind == ColorKind::RGB || kind == ColorKind::RGBA)
+        {
+            const uint8_t red = reader_.Read<uint8_t>();
+            const uint8_t green = reader_.Read<uint8_t>();
+            const uint8_t blue = reader_.Read<uint8_t>();
+
+            if (kind == ColorKind::RGBA)
+            {
+                return svg::Color(svg::Rgba(red, green, blue, reader_.Read<double>()));
+            }
+            return svg::Color(svg::Rgb(red, green, blue));
+        }
+        else if (kind == ColorKind::NONE)
+        {
+            return svg::NoneColor;
+        }
+        throw std::runtime_error("transport base is corrupted"s);
+    }
+
+    void WriteRenderSettings(BaseWriter& writer_, const RenderSettings& render_settings_)
+    {
+        writer_.Write(render_settings_.width);
+        writer_.Write(render_settings_.height);
+        writer_.Write(render_settings_.padding);
+        writer_.Write(render_settings_.line_width);
+        writer_.Write(render_settings_.stop_radius);
+        writer_.Write(render_settings_.bus_label_font_size);
+        writer_.Write(render_settings_.bus_label_offset.first);
+        writer_.Write(render_settings_.bus_label_offset.second);
+        writer_.Write(render_settings_.stop_label_font_size);
+        writer_.Write(render_settings_.stop_label_offset.first);
+        writer_.Write(render_settings_.stop_label_offset.second);
+        WriteColor(writer_, render_settings_.underlayer_color);
+        writer_.Write(render_settings_.underlayer_width);
+
+        writer_.Write(static_cast<uint64_t>(render_settings_.color_palette.size()));
+
+        for (const svg::Color& color : render_settings_.color_palette)
+        {
+            WriteColor(writer_, color);
+        }
+    }
+
+    RenderSettings ReadRenderSettings(BaseReader& reader_)
+    {
+        RenderSettings render_settings;
+
+        render_settings.width = reader_.Read<double>();
+        render_settings.height = reader_.Read<double>();
+        render_settings.padding = reader_.Read<double>();
+        render_settings.line_width = reader_.Read<double>();
+        render_settings.stop_radius = reader_.Read<double>();
+        render_settings.bus_label_font_size = reader_.Read<int>();
+        render_settings.bus_label_offset.first = reader_.Read<double>();
+        render_settings.bus_label_offset.second = reader_.Read<double>();
+        render_settings.stop_label_font_size = reader_.Read<int>();
+        render_settings.stop_label_offset.first = reader_.Read<double>();
+        render_settings.stop_label_offset.second = reader_.Read<double>();
+        render_settings.underlayer_color = ReadColor(reader_);
+        render_settings.underlayer_width = reader_.Read<double>();
+
+        const uint64_t palette_size = reader_.Read<uint64_t>();
+
+        for (uint64_t i = 0; i < palette_size; ++i)
+        {
+            render_settings.color_palette.push_back(ReadColor(reader_));
+        }
+        return render_settings;
+    }
+
+    // The catalogue goes in as a flat image at an aligned offset, so that it can be used in place from the mapped file.
+    void WriteCatalogue(BaseWriter& writer_, const TransportCatalogue& catalogue_)
+    {
+        const std::vector<char> catalogue_image = transport::MakeCatalogueImage(catalogue_);
+
+        writer_.Write(static_cast<uint64_t>(catalogue_image.size()));
+        writer_.Align(CATALOGUE_ALIGNMENT);
+        writer_.WriteBytes(catalogue_image.data(), catalogue_image.size());
+    }
+
+    CatalogueView ReadCatalogueView(BaseReader& reader_)
+    {
+        const uint64_t image_size = reader_.Read<uint64_t>();
+
+        reader_.Align(CATALOGUE_ALIGNMENT);
+
+        return CatalogueView(reader_.ReadBlock(image_size), image_size);
+    }
+
+    void FillCatalogue(const CatalogueView& view_, TransportCatalogue& catalogue_)
+    {
+        const size_t stops_count = view_.GetStopCount();
+
+        for (transport::StopIndex i = 0; i < stops_count; ++i)
+        {
+            const transport::StopView stop_view = view_.GetStop(i);
+
+            catalogue_.AddStop(stop_view.name, { stop_view.latitude, stop_view.longitude });
+        }
+
+        // The view numbers stops and buses in the order the catalogue added them, so its indices are the ids.
+        const std::deque<Stop>& stops = catalogue_.GetStops();
+        std::vector<Distance> distances;
+
+        for (transport::StopIndex i = 0; i < stops_count; ++i)
+        {
+            for (const transport::image::DistanceRecord& distance : view_.GetStopDistances(i))
+            {
+                distances.push_back({ &stops[i], &stops[distance.to], distance.distance });
+            }
+        }
+
+        catalogue_.AddDistance(distances);
+
+        for (transport::BusIndex i = 0; i < view_.GetBusCount(); ++i)
+        {
+            const transport::BusView bus_view = view_.GetBus(i);
+
+            Bus bus;
+            bus.is_roundtrip = bus_view.is_roundtrip;
+
+            catalogue_.AddBus(bus_view.name, std::move(bus), std::vector<StopId>(bus_view.stops.begin(), bus_view.stops.end()));
+        }
+        catalogue_.BuildIndexes();
+    }
+
+    template <typename Hierarchy>
+    void WriteUpwardGraph(BaseWriter& writer_, const typename Hierarchy::UpwardGraph& upward_graph_)
+    {
+        writer_.WriteArray(upward_graph_.offsets);
+        writer_.WriteArray(upward_graph_.targets);
+        writer_.WriteArray(upward_graph_.weights);
+        writer_.WriteArray(upward_graph_.hierarchy_edge_ids);
+    }
+
+    template <typename Hierarchy>
+    typename Hierarchy::UpwardGraph ReadUpwardGraph(BaseReader& reader_)
+    {
+        typename Hierarchy::UpwardGraph upward_graph;
+
+        upward_graph.offsets = reader_.ReadArray<size_t>();
+        upward_graph.targets = reader_.ReadArray<graph::VertexId>();
+        upward_graph.weights = reader_.ReadArray<double>();
+        upward_graph.hierarchy_edge_ids = reader_.ReadArray<size_t>();
+
+        return upward_graph;
+    }
+
+    struct EdgeWriter
+    {
+        BaseWriter& writer;
+        const std::unordered_map<std::string_view, uint32_t>& stop_indices;
+        const std::unordered_map<std::string_view, uint32_t>& bus_indices;
+
+        void Write(EdgeKind kind_, uint32_t name_index_, uint64_t span_count_, double time_)
+        {
+            writer.Write(kind_);
+            writer.Write(name_index_);
+            writer.Write(span_count_);
+            writer.Write(time_);
+        }
+
+        void operator()(const StopEdge& edge_)
+        {
+            Write(EdgeKind::STOP, stop_indices.at(edge_.stop_name), 0, edge_.time);
+        }
+
+        void operator()(const BusEdge& edge_)
+        {
+            Write(EdgeKind::BUS, bus_indices.at(edge_.bus_name), edge_.span_count, edge_.time);
+        }
+
+        void operator()(const BoardEdge& edge_)
+        {
+            Write(EdgeKind::BOARD, bus_indices.at(edge_.bus_name), 0, 0);
+        }
+
+        void operator()(const RideEdge& edge_)
+        {
+            Write(EdgeKind::RIDE, 0, 0, edge_.time);
+        }
+
+        void operator()(const AlightEdge&)
+        {
+            Write(EdgeKind::ALIGHT, 0, 0, 0);
+        }
+    };
+
+    RouterEdge ReadEdge(BaseReader& reader_, const TransportCatalogue& catalogue_)
+    {
+        const EdgeKind kind = reader_.Read<EdgeKind>();
+        const uint32_t name_index = reader_.Read<uint32_t>();
+        const uint64_t span_count = reader_.Read<uint64_t>();
+        const double time = reader_.Read<double>();
+
+        const bool named_by_stop = kind == EdgeKind::STOP;
+        const bool named_by_bus = kind == EdgeKind::BUS || kind == EdgeKind::BOARD;
+
+        if ((named_by_stop && name_index >= catalogue_.GetStopCount()) || (named_by_bus && name_index >= catalogue_.GetBusCount()))
+        {
+            throw std::runtime_error("transport base is corrupted"s);
+        }
+
+        switch (kind)
+        {
+        case EdgeKind::STOP:
+            return StopEdge{ catalogue_.GetStopName(name_index), time };
+        case EdgeKind::BUS:
+            return BusEdge{ catalogue_.GetBusName(name_index), static_cast<size_t>(span_count), time };
+        case EdgeKind::BOARD:
+            return BoardEdge{ catalogue_.GetBusName(name_index) };
+        case EdgeKind::RIDE:
+            return RideEdge{ time };
+        case EdgeKind::ALIGHT:
+            return AlightEdge{};
+        }
+        throw std::runtime_error("transport base is corrupted"s);
+    }
+
+    // Stops are referred to by their ids, which are also their indices in the catalogue image.
+    void WriteRouter(BaseWriter& writer_, const TransportCatalogue& catalogue_, const TransportRouter& router_)
+    {
+        using Hierarchy = graph::ContractionHierarchy<double>;
+
+        const RoutingSettings& routing_settings = router_.GetRoutingSettings();
+
+        writer_.Write(routing_settings.bus_wait_time);
+        writer_.Write(routing_settings.bus_velocity);
+        writer_.Write(static_cast<uint8_t>(routing_settings.router_mode));
+        writer_.Write(static_cast<uint8_t>(routing_settings.bus_graph_model));
+        writer_.Write(routing_settings.walking_velocity);
+        writer_.Write(routing_settings.max_walking_distance);
+
+        writer_.Write(static_cast<uint32_t>(router_.GetStopToVertex().size()));
+
+        const router::StopToRouter& stop_to_router = router_.GetStopToVertex();
+
+        for (StopId id = 0; id < stop_to_router.size(); ++id)
+        {
+            writer_.Write(id);
+            writer_.Write(static_cast<uint64_t>(stop_to_router[id].bus_wait_start));
+            writer_.Write(static_cast<uint64_t>(stop_to_router[id].bus_wait_end));
+        }
+
+        std::unordered_map<std::string_view, uint32_t> stop_name_indices;
+        std::unordered_map<std::string_view, uint32_t> bus_name_indices;
+
+        for (const Stop& stop : catalogue_.GetStops())
+        {
+            stop_name_indices.emplace(catalogue_.GetStopName(stop.id), stop.id);
+        }
+        for (const Bus& bus : catalogue_.GetBuses())
+        {
+            bus_name_indices.emplace(catalogue_.GetBusName(bus.id), bus.id);
+        }
+
+        EdgeWriter edge_writer{ writer_, stop_name_indices, bus_name_indices };
+
+        writer_.Write(static_cast<uint64_t>(router_.GetEdgeIdToEdge().size()));
+
+        for (const RouterEdge& edge : router_.GetEdgeIdToEdge())
+        {
+            std::visit(edge_writer, edge);
+        }
+
+        const CsrArrays<double>& csr = router_.GetGraph().GetCsrArrays();
+
+        writer_.WriteArray(csr.offsets);
+        writer_.WriteArray(csr.targets);
+        writer_.WriteArray(csr.weights);
+        writer_.WriteArray(csr.edge_ids);
+        writer_.WriteArray(csr.edge_slots);
+
+        const Router<double>::RouterData router_data = router_.GetRouter().GetRouterData();
+
+        writer_.Write(static_cast<uint8_t>(router_data.mode));
+        writer_.WriteArray(router_data.all_pairs_weights);
+        writer_.WriteArray(router_data.all_pairs_prev_edges);
+        writer_.WriteArray(router_data.hierarchy.hierarchy_edges);
+        WriteUpwardGraph<Hierarchy>(writer_, router_data.hierarchy.forward_graph);
+        WriteUpwardGraph<Hierarchy>(writer_, router_data.hierarchy.backward_graph);
+        writer_.Write(static_cast<uint64_t>(router_data.hierarchy.shortcut_count));
+
+        const router::ConnectionScan::TimetableData& timetable_data = router_.GetTimetable().GetTimetableData();
+
+        writer_.WriteArray(timetable_data.trip_buses);
+        writer_.WriteArray(timetable_data.connections);
+    }
+
+    TransportRouter ReadRouter(BaseReader& reader_, TransportCatalogue& catalogue_)
+    {
+        using Hierarchy = graph::ContractionHierarchy<double>;
+
+        const std::deque<Stop>& stops = catalogue_.GetStops();
+        RoutingSettings routing_settings;
+
+        routing_settings.bus_wait_time = reader_.Read<double>();
+        routing_settings.bus_velocity = reader_.Read<double>();
+        routing_settings.router_mode = static_cast<graph::RouterMode>(reader_.Read<uint8_t>());
+        routing_settings.bus_graph_model = static_cast<BusGraphModel>(reader_.Read<uint8_t>());
+        routing_settings.walking_velocity = reader_.Read<double>();
+        routing_settings.max_walking_distance = reader_.Read<double>();
+
+        router::StopToRouter stop_to_router(stops.size());
+        const uint32_t stop_vertices_count = reader_.Read<uint32_t>();
+
+        for (uint32_t i = 0; i < stop_vertices_count; ++i)
+        {
+            const StopId id = reader_.ReadIndex(stops.size());
+            const graph::VertexId bus_wait_start = reader_.Read<uint64_t>();
+            const graph::VertexId bus_wait_end = reader_.Read<uint64_t>();
+
+            stop_to_router[id] = StopVertexPair{ bus_wait_start, bus_wait_end };
+        }
+
+        router::EdgeIdToEdge edge_id_to_edge;
+        const uint64_t edges_count = reader_.Read<uint64_t>();
+
+        for (uint64_t i = 0; i < edges_count; ++i)
+        {
+            edge_id_to_edge.push_back(ReadEdge(reader_, catalogue_));
+        }
+
+        CsrArrays<double> csr;
+
+        csr.offsets = reader_.ReadArray<CompactIndex>();
+        csr.targets = reader_.ReadArray<CompactIndex>();
+        csr.weights = reader_.ReadArray<double>();
+        csr.edge_ids = reader_.ReadArray<CompactIndex>();
+        csr.edge_slots = reader_.ReadArray<CompactIndex>();
+
+        Router<double>::RouterData router_data;
+
+        router_data.mode = static_cast<graph::RouterMode>(reader_.Read<uint8_t>());
+        router_data.all_pairs_weights = reader_.ReadArray<double>();
+        router_data.all_pairs_prev_edges = reader_.ReadArray<CompactIndex>();
+        router_data.hierarchy.hierarchy_edges = reader_.ReadArray<Hierarchy::HierarchyEdge>();
+        router_data.hierarchy.forward_graph = ReadUpwardGraph<Hierarchy>(reader_);
+        router_data.hierarchy.backward_graph = ReadUpwardGraph<Hierarchy>(reader_);
+        router_data.hierarchy.shortcut_count = reader_.Read<uint64_t>();
+
+        router::ConnectionScan::TimetableData timetable_data;
+
+        timetable_data.trip_buses = reader_.ReadArray<BusId>();
+        timetable_data.connections = reader_.ReadArray<router::ConnectionScan::Connection>();
+
+        for (const BusId bus : timetable_data.trip_buses)
+        {
+            if (bus >= catalogue_.GetBuses().size())
+            {
+                throw std::runtime_error("transport base is corrupted"s);
+            }
+        }
+
+        // The graph, the router and the timetable check their own arrays as they are built; a base
+        // they reject is corrupted just as one that ends early.
+        try
+        {
+            return TransportRouter(std::move(routing_settings), std::move(stop_to_router), std::move(edge_id_to_edge), DirectedWeightedGraph<double>(std::move(csr)), std::move(router_data), std::move(timetable_data));
+        }
+        catch (const std::logic_error&)
+        {
+            throw std::runtime_error("transport base is corrupted"s);
+        }
+    }
+
+    void SaveBase(const SerializationSettings& serialization_settings_, const TransportCatalogue& catalogue_, const RenderSettings& render_settings_, const TransportRouter& router_)
+    {
+        const std::string& path = serialization_settings_.file;
+        const std::string temporary_path = path + ".tmp"s;
+
+        try
+        {
+            std::ofstream output(temporary_path, std::ios::binary | std::ios::trunc);
+
+            if (!output)
+            {
+                throw std::runtime_error("unable to create transport base '"s + temporary_path + "'"s);
+            }
+
+            BaseWriter writer(output);
+
+            writer.Write(BASE_MAGIC);
+            writer.Write(BASE_FORMAT_VERSION);
+            writer.Write(BYTE_ORDER_MARK);
+            writer.Write(static_cast<uint8_t>(sizeof(size_t)));
+
+            WriteCatalogue(writer, catalogue_);
+            WriteRenderSettings(writer, render_settings_);
+            WriteRouter(writer, catalogue_, router_);
+
+            output.close();
+
+            if (!output)
+            {
+                throw std::runtime_error("unable to write transport base '"s + temporary_path + "'"s);
+            }
+        }
+        catch (...)
+        {
+            std::remove(temporary_path.c_str());
+            throw;
+        }
+
+        if (std::rename(temporary_path.c_str(), path.c_str()) != 0)
+        {
+            std::remove(temporary_path.c_str());
+            throw std::runtime_error("unable to replace transport base '"s + path + "'"s);
+        }
+    }
+
+    void ReadBaseHeader(BaseReader& reader_, const std::string& path_)
+    {
+        for (const char magic : BASE_MAGIC)
+        {
+            if (reader_.Read<char>() != magic)
+            {
+                throw std::runtime_error("'"s + path_ + "' is not a transport base"s);
+            }
+        }
+        if (reader_.Read<uint32_t>() != BASE_FORMAT_VERSION)
+        {
+            throw std::runtime_error("unsupported transport base version"s);
+        }
+        if (reader_.Read<uint32_t>() != BYTE_ORDER_MARK || reader_.Read<uint8_t>() != sizeof(size_t))
+        {
+            throw std::runtime_error("transport base was written on an incompatible platform"s);
+        }
+    }
+
+    TransportRouter LoadBase(const SerializationSettings& serialization_settings_, TransportCatalogue& catalogue_, RenderSettings& render_settings_)
+    {
+        const MappedFile file(serialization_settings_.file);
+        BaseReader reader(file.begin(), file.end());
+
+        ReadBaseHeader(reader, serialization_settings_.file);
+        FillCatalogue(ReadCatalogueView(reader), catalogue_);
+        render_settings_ = ReadRenderSettings(reader);
+
+        return ReadRouter(reader, catalogue_);
+    }
+
+    BaseCatalogue::BaseCatalogue(const SerializationSettings& serialization_settings_) : file(serialization_settings_.file), view(OpenView(file, serialization_settings_.file)) {}
+
+    CatalogueView BaseCatalogue::OpenView(const MappedFile& file_, const std::string& path_)
+    {
+        BaseReader reader(file_.begin(), file_.end());
+
+        ReadBaseHeader(reader, path_);
+
+        return ReadCatalogueView(reader);
+    }
+
+    const CatalogueView& BaseCatalogue::GetView() const
+    {
+        return view;
+    }
+
+}//end namespace serialization
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "transport_catalogue.h"
+#include "catalogue_view.h"
+#include "map_renderer.h"
+#include "transport_router.h"
+#include "domain.h"
+
+#include <string>
+#include <vector>
+
+namespace serialization
+{
+    using transport::TransportCatalogue;
+    using map_renderer::RenderSettings;
+    using transport::CatalogueView;
+    using router::TransportRouter;
+
+    // Version of the binary base format; a file of any other version is rejected on load.
+    static const uint32_t BASE_FORMAT_VERSION = 4;
+
+    // Read-only view of a whole file: mapped into memory where possible, otherwise read into a buffer.
+    class MappedFile
+    {
+    public:
+
+        explicit MappedFile(const std::string& path_);
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        ~MappedFile();
+
+        const char* begin() const;
+        const char* end() const;
+
+    private:
+
+        const char* mapped_data = nullptr;
+        size_t mapped_size = 0;
+        std::vector<char> buffer;
+    };
+
+    // The catalogue of a saved base, used in place: queries read straight from the mapped file,
+    // so opening it costs no parsing and processes opening the same base share its page cache.
+    class BaseCatalogue
+    {
+    public:
+
+        explicit BaseCatalogue(const SerializationSettings& serialization_settings_);
+
+        const CatalogueView& GetView() const;
+
+    private:
+
+        MappedFile file;
+        CatalogueView view;
+
+        static CatalogueView OpenView(const MappedFile& file_, const std::string& path_);
+    };
+
+    // Writes the catalogue, the render settings and the fully built router (its routing settings,
+    // graph and precomputed routing data) to the file named in serialization_settings_. The base is
+    // written to "<file>.tmp" and renamed over the file once complete, so a failed save leaves the previous
+    // base intact and processes that have it mapped keep reading the old contents.
+    void SaveBase(const SerializationSettings& serialization_settings_, const TransportCatalogue& catalogue_, const RenderSettings& render_settings_, const TransportRouter& router_);
+
+    // Reads a base written by SaveBase into an empty catalogue and returns the router over it,
+    // ready to answer queries. The file is memory-mapped where the platform allows it.
+    TransportRouter LoadBase(const SerializationSettings& serialization_settings_, TransportCatalogue& catalogue_, RenderSettings& render_settings_);
+
+}//end namespace serialization
\ No newline at end of file
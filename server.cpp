@@ -0,0 +1,205 @@
+#include "server.h"
+#include "json_reader.h"
+#include "json_writer.h"
+
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define TRANSPORT_UNIX_SOCKET
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace server
+{
+    using namespace std::string_literals;
+
+    Server::Server(const TransportCatalogue& catalogue_, const RenderSettings& render_settings_, const TransportRouter& routing_) : catalogue(catalogue_), render_settings(render_settings_), routing(routing_) {}
+
+    void Server::ServeStream(std::istream& input_, std::ostream& output_)
+    {
+        std::string line;
+
+        while (std::getline(input_, line))
+        {
+            AnswerBatch(line, output_);
+        }
+    }
+
+    // The response is gathered before it is written, so a batch that fails halfway still gives one
+    // well-formed line.
+    void Server::AnswerBatch(std::string_view line_, std::ostream& output_) const
+    {
+        if (line_.find_first_not_of(" \t\r") == std::string_view::npos)
+        {
+            return;
+        }
+
+        std::ostringstream response;
+
+        try
+        {
+            std::vector<StatRequest> stat_requests;
+
+            json::JSON_R json_reader(json::Load(line_));
+            json_reader.ParseBatch(stat_requests);
+
+            json::Writer writer(response, json::WriterFormat::COMPACT);
+            request_handler.ExecuteQueries(catalogue, stat_requests, render_settings, routing, writer);
+        }
+        catch (const std::exception& e)
+        {
+            response.str(""s);
+            json::Writer(response, json::WriterFormat::COMPACT).StartDict().Key("error_message"s).Value(e.what()).EndDict();
+        }
+
+        response << '\n';
+        output_ << response.str();
+        output_.flush();
+    }
+
+#ifdef TRANSPORT_UNIX_SOCKET
+
+    void Server::ServeSocket(const std::string& path_)
+    {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+
+        if (path_.empty() || path_.size() >= sizeof(address.sun_path))
+        {
+            throw std::runtime_error("bad socket path '"s + path_ + "'"s);
+        }
+        std::memcpy(address.sun_path, path_.c_str(), path_.size() + 1);
+
+        const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+
+        if (listener < 0)
+        {
+            throw std::runtime_error("unable to create socket: "s + std::strerror(errno));
+        }
+
+        unlink(path_.c_str());
+
+        if (bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, SOMAXCONN) != 0)
+        {
+            const std::string error = std::strerror(errno);
+            close(listener);
+            throw std::runtime_error("unable to listen on '"s + path_ + "': "s + error);
+        }
+
+        while (true)
+        {
+            const int connection = accept(listener, nullptr, nullptr);
+
+            if (connection < 0)
+            {
+                if (errno == EINTR || errno == ECONNABORTED)
+                {
+                    continue;
+                }
+
+                const std::string error = std::strerror(errno);
+                close(listener);
+                throw std::runtime_error("unable to accept connection: "s + error);
+            }
+
+            std::thread([this, connection]()
+                {
+                    ServeConnection(connection);
+                    close(connection);
+                }).detach();
+        }
+    }
+
+    // Runs on a thread of its own, so a slow or idle peer holds up no other connection.
+    // Lines may arrive split over several reads or several to a read; whatever follows the last
+    // line break waits for the next read, and is answered as a batch of its own when the peer closes.
+    void Server::ServeConnection(int connection_)
+    {
+        std::string pending;
+        std::ostringstream response;
+        char chunk[1 << 16];
+
+        auto answer = [this, connection_, &response](std::string_view line_)
+            {
+                response.str(""s);
+                AnswerBatch(line_, response);
+
+                const std::string text = response.str();
+
+                for (size_t sent = 0; sent < text.size();)
+                {
+                    const ssize_t count = send(connection_, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+
+                    if (count < 0 && errno == EINTR)
+                    {
+                        continue;
+                    }
+                    if (count <= 0)
+                    {
+                        return false;
+                    }
+                    sent += static_cast<size_t>(count);
+                }
+                return true;
+            };
+
+        while (true)
+        {
+            const ssize_t count = recv(connection_, chunk, sizeof(chunk), 0);
+
+            if (count < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (count <= 0)
+            {
+                break;
+            }
+
+            const size_t scanned = pending.size();
+            pending.append(chunk, static_cast<size_t>(count));
+
+            size_t line_begin = 0;
+
+            for (size_t line_end = pending.find('\n', scanned); line_end != std::string::npos; line_end = pending.find('\n', line_begin))
+            {
+                if (!answer(std::string_view(pending).substr(line_begin, line_end - line_begin)))
+                {
+                    return;
+                }
+                line_begin = line_end + 1;
+            }
+            pending.erase(0, line_begin);
+        }
+
+        if (!pending.empty())
+        {
+            answer(pending);
+        }
+    }
+
+#else
+
+    void Server::ServeSocket(const std::string& path_)
+    {
+        throw std::runtime_error("unable to listen on '"s + path_ + "': Unix sockets are not supported on this platform"s);
+    }
+
+    void Server::ServeConnection(int)
+    {
+    }
+
+#endif
+
+}//end namespace server
\ No newline at end of file
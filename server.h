@@ -0,0 +1,50 @@
+#pragma once
+
+#include "transport_catalogue.h"
+#include "map_renderer.h"
+#include "transport_router.h"
+#include "request_handler.h"
+
+#include <iostream>
+#include <string>
+#include <string_view>
+
+namespace server
+{
+    using transport::TransportCatalogue;
+    using map_renderer::RenderSettings;
+    using router::TransportRouter;
+
+    // Long-lived answering of stat_requests against a catalogue and router built once.
+    // Requests come in batches, one JSON document per line: a document with stat_requests, as given
+    // to process_requests, or the bare array of them. Each batch is answered with one line holding
+    // the compact array of responses, or {"error_message": ...} if the batch could not be read.
+    // Empty lines are skipped.
+    class Server
+    {
+    public:
+
+        Server(const TransportCatalogue& catalogue_, const RenderSettings& render_settings_, const TransportRouter& routing_);
+
+        // Answers the batches of input_ until it ends.
+        void ServeStream(std::istream& input_, std::ostream& output_);
+
+        // Listens on a Unix domain socket at path_, replacing any file already there, and serves
+        // each connection on a thread of its own as a stream of batches until the peer closes it.
+        // Never returns; throws std::runtime_error if the socket cannot be set up.
+        void ServeSocket(const std::string& path_);
+
+        void AnswerBatch(std::string_view line_, std::ostream& output_) const;
+
+    private:
+
+        const TransportCatalogue& catalogue;
+        const RenderSettings& render_settings;
+        const TransportRouter& routing;
+
+        request_handler::RequestHandler request_handler;
+
+        void ServeConnection(int connection_);
+    };
+
+}//end namespace server
\ No newline at end of file
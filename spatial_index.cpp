@@ -0,0 +1,306 @@
+#include "spatial_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace transport
+{
+    // The same constants as geo::ComputeHaversineDistance, so that bounds and distances agree.
+    static const double PI = 3.1415926535;
+    static const double DR = PI / 180.;
+    static const double EARTH_RADIUS = 6371000;
+
+    // Bounds are lowered by this many meters, well above rounding errors, so that no stop is skipped on account of them.
+    static const double BOUND_SLACK = 1e-3;
+
+    static const double NO_BOUND = std::numeric_limits<double>::infinity();
+
+    namespace
+    {
+        // Least distance between points whose latitudes differ by degrees_.
+        double GetLatitudeBound(double degrees_)
+        {
+            return degrees_ * DR * EARTH_RADIUS;
+        }
+
+        // Least distance between points whose longitudes differ by degrees_, at most 180, and whose
+        // latitudes both have a cosine of at least cos_latitude_: by the haversine formula,
+        // sin^2(d / 2R) >= cos(lat1) * cos(lat2) * sin^2(dlon / 2).
+        double GetLongitudeBound(double degrees_, double cos_latitude_)
+        {
+            return 2 * EARTH_RADIUS * std::asin(std::min(1.0, cos_latitude_ * std::sin(degrees_ * DR / 2)));
+        }
+    }//end namespace
+
+    SpatialIndex::SpatialIndex(const std::vector<geo::Coordinates>& points_)
+    {
+        if (points_.empty())
+        {
+            return;
+        }
+
+        min_corner = points_.front();
+        max_corner = points_.front();
+
+        for (const geo::Coordinates& point : points_)
+        {
+            min_corner.latitude = std::min(min_corner.latitude, point.latitude);
+            min_corner.longitude = std::min(min_corner.longitude, point.longitude);
+            max_corner.latitude = std::max(max_corner.latitude, point.latitude);
+            max_corner.longitude = std::max(max_corner.longitude, point.longitude);
+        }
+
+        const int side = std::max(1, static_cast<int>(std::ceil(std::sqrt(static_cast<double>(points_.size()) / POINTS_PER_CELL))));
+
+        rows = side;
+        columns = side;
+
+        if (max_corner.latitude > min_corner.latitude)
+        {
+            latitude_step = (max_corner.latitude - min_corner.latitude) / rows;
+        }
+        if (max_corner.longitude > min_corner.longitude)
+        {
+            longitude_step = (max_corner.longitude - min_corner.longitude) / columns;
+        }
+
+        std::vector<uint32_t> point_cells(points_.size());
+        cell_begin.assign(static_cast<size_t>(rows) * columns + 1, 0);
+
+        for (size_t i = 0; i < points_.size(); ++i)
+        {
+            point_cells[i] = static_cast<uint32_t>(GetRow(points_[i].latitude) * columns + GetColumn(points_[i].longitude));
+            ++cell_begin[point_cells[i] + 1];
+        }
+        std::partial_sum(cell_begin.begin(), cell_begin.end(), cell_begin.begin());
+
+        std::vector<uint32_t> cell_end(cell_begin.begin(), cell_begin.end() - 1);
+        ids.resize(points_.size());
+        points.resize(points_.size());
+
+        for (size_t i = 0; i < points_.size(); ++i)
+        {
+            const uint32_t position = cell_end[point_cells[i]]++;
+
+            ids[position] = static_cast<StopId>(i);
+            points[position] = points_[i];
+        }
+    }
+
+    size_t SpatialIndex::GetSize() const
+    {
+        return ids.size();
+    }
+
+    int SpatialIndex::GetRow(double latitude_) const
+    {
+        const double row = std::floor((latitude_ - min_corner.latitude) / latitude_step);
+
+        return !(row > 0) ? 0 : row >= rows ? rows - 1 : static_cast<int>(row);
+    }
+
+    int SpatialIndex::GetColumn(double longitude_) const
+    {
+        const double column = std::floor((longitude_ - min_corner.longitude) / longitude_step);
+
+        return !(column > 0) ? 0 : column >= columns ? columns - 1 : static_cast<int>(column);
+    }
+
+    // Least distance from point_ to a stop in a cell at least ring_ cells away from (row_, column_),
+    // i.e. outside the rows and columns within ring_ - 1 of it; NO_BOUND if there are no such cells.
+    double SpatialIndex::GetRingBound(geo::Coordinates point_, int row_, int column_, int ring_) const
+    {
+        const int inner = ring_ - 1;
+        const double max_latitude = std::max({ std::abs(point_.latitude), std::abs(min_corner.latitude), std::abs(max_corner.latitude) });
+        const double cos_latitude = std::max(0.0, std::cos(std::min(90.0, max_latitude) * DR));
+
+        double bound = NO_BOUND;
+
+        if (row_ - inner > 0)
+        {
+            const double edge = min_corner.latitude + (row_ - inner) * latitude_step;
+            bound = std::min(bound, GetLatitudeBound(std::max(0.0, point_.latitude - edge)));
+        }
+        if (row_ + inner < rows - 1)
+        {
+            const double edge = min_corner.latitude + (row_ + inner + 1) * latitude_step;
+            bound = std::min(bound, GetLatitudeBound(std::max(0.0, edge - point_.latitude)));
+        }
+
+        // Longitudes are also compared the other way round the globe.
+        if (column_ - inner > 0)
+        {
+            const double edge = min_corner.longitude + (column_ - inner) * longitude_step;
+            const double degrees = std::min(point_.longitude - edge, 360.0 - (point_.longitude - min_corner.longitude));
+            bound = std::min(bound, GetLongitudeBound(std::max(0.0, degrees), cos_latitude));
+        }
+        if (column_ + inner < columns - 1)
+        {
+            const double edge = min_corner.longitude + (column_ + inner + 1) * longitude_step;
+            const double degrees = std::min(edge - point_.longitude, 360.0 - (max_corner.longitude - point_.longitude));
+            bound = std::min(bound, GetLongitudeBound(std::max(0.0, degrees), cos_latitude));
+        }
+
+        return bound == NO_BOUND ? NO_BOUND : bound - BOUND_SLACK;
+    }
+
+    template <typename Visit, typename KeepGoing>
+    void SpatialIndex::VisitRings(geo::Coordinates point_, Visit visit_, KeepGoing keep_going_) const
+    {
+        const int row = GetRow(point_.latitude);
+        const int column = GetColumn(point_.longitude);
+
+        for (int ring = 0; ; ++ring)
+        {
+            if (ring > 0)
+            {
+                const double bound = GetRingBound(point_, row, column, ring);
+
+                if (bound == NO_BOUND || !keep_going_(bound))
+                {
+                    return;
+                }
+            }
+
+            const int first_column = std::max(0, column - ring);
+            const int last_column = std::min(columns - 1, column + ring);
+
+            for (int r = std::max(0, row - ring); r <= std::min(rows - 1, row + ring); ++r)
+            {
+                if (r == row - ring || r == row + ring)
+                {
+                    for (int c = first_column; c <= last_column; ++c)
+                    {
+                        visit_(r, c);
+                    }
+                }
+                else
+                {
+                    if (column - ring >= 0)
+                    {
+                        visit_(r, column - ring);
+                    }
+                    if (column + ring < columns)
+                    {
+                        visit_(r, column + ring);
+                    }
+                }
+            }
+        }
+    }
+
+    std::vector<SpatialIndex::Neighbour> SpatialIndex::FindNearest(geo::Coordinates point_, size_t count_) const
+    {
+        std::vector<Neighbour> nearest;
+
+        if (count_ == 0 || ids.empty())
+        {
+            return nearest;
+        }
+
+        // nearest is a heap with the farthest of the stops found so far on top.
+        const auto is_closer = [](const Neighbour& lhs_, const Neighbour& rhs_)
+            {
+                return lhs_.distance < rhs_.distance || (lhs_.distance == rhs_.distance && lhs_.id < rhs_.id);
+            };
+
+        const auto visit_cell = [&](int row_, int column_)
+            {
+                const size_t cell = static_cast<size_t>(row_) * columns + column_;
+
+                for (uint32_t i = cell_begin[cell]; i < cell_begin[cell + 1]; ++i)
+                {
+                    const Neighbour candidate{ ids[i], geo::ComputeHaversineDistance(point_, points[i]) };
+
+                    if (nearest.size() < count_)
+                    {
+                        nearest.push_back(candidate);
+                        std::push_heap(nearest.begin(), nearest.end(), is_closer);
+                    }
+                    else if (is_closer(candidate, nearest.front()))
+                    {
+                        std::pop_heap(nearest.begin(), nearest.end(), is_closer);
+                        nearest.back() = candidate;
+                        std::push_heap(nearest.begin(), nearest.end(), is_closer);
+                    }
+                }
+            };
+
+        VisitRings(point_, visit_cell, [&](double bound_)
+            {
+                return nearest.size() < count_ || bound_ <= nearest.front().distance;
+            });
+
+        std::sort_heap(nearest.begin(), nearest.end(), is_closer);
+
+        return nearest;
+    }
+
+    std::vector<SpatialIndex::Neighbour> SpatialIndex::FindWithin(geo::Coordinates point_, double radius_) const
+    {
+        std::vector<Neighbour> found;
+
+        if (ids.empty() || !(radius_ >= 0))
+        {
+            return found;
+        }
+
+        const auto visit_cell = [&](int row_, int column_)
+            {
+                const size_t cell = static_cast<size_t>(row_) * columns + column_;
+
+                for (uint32_t i = cell_begin[cell]; i < cell_begin[cell + 1]; ++i)
+                {
+                    const double distance = geo::ComputeHaversineDistance(point_, points[i]);
+
+                    if (distance <= radius_)
+                    {
+                        found.push_back({ ids[i], distance });
+                    }
+                }
+            };
+
+        VisitRings(point_, visit_cell, [radius_](double bound_)
+            {
+                return bound_ <= radius_;
+            });
+
+        std::sort(found.begin(), found.end(), [](const Neighbour& lhs_, const Neighbour& rhs_)
+            {
+                return lhs_.distance < rhs_.distance || (lhs_.distance == rhs_.distance && lhs_.id < rhs_.id);
+            });
+
+        return found;
+    }
+
+    std::vector<StopId> SpatialIndex::FindInBox(geo::Coordinates min_, geo::Coordinates max_) const
+    {
+        std::vector<StopId> found;
+
+        if (ids.empty() || min_.latitude > max_.latitude || min_.longitude > max_.longitude)
+        {
+            return found;
+        }
+
+        for (int r = GetRow(min_.latitude); r <= GetRow(max_.latitude); ++r)
+        {
+            const size_t first_cell = static_cast<size_t>(r) * columns + GetColumn(min_.longitude);
+            const size_t last_cell = static_cast<size_t>(r) * columns + GetColumn(max_.longitude);
+
+            // The cells of a row lie one after another, and so do their stops.
+            for (uint32_t i = cell_begin[first_cell]; i < cell_begin[last_cell + 1]; ++i)
+            {
+                const geo::Coordinates& point = points[i];
+
+                if (point.latitude >= min_.latitude && point.latitude <= max_.latitude && point.longitude >= min_.longitude && point.longitude <= max_.longitude)
+                {
+                    found.push_back(ids[i]);
+                }
+            }
+        }
+        return found;
+    }
+
+}//end namespace transport
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "domain.h"
+#include "geo.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace transport
+{
+    // Uniform grid over stop coordinates, built once: the bounding box of the stops is cut into about
+    // one cell per POINTS_PER_CELL stops, and the stops of every cell lie side by side. Nearest stops
+    // are searched ring by ring outward from the cell of the query point, until no unvisited cell can
+    // hold a stop closer than the ones already found.
+    class SpatialIndex
+    {
+    public:
+
+        struct Neighbour
+        {
+            StopId id = 0;
+            double distance = 0.0;
+        };
+
+        SpatialIndex() = default;
+
+        // points_ is indexed by StopId.
+        explicit SpatialIndex(const std::vector<geo::Coordinates>& points_);
+
+        // Number of stops indexed: those with ids below it.
+        size_t GetSize() const;
+
+        // Up to count_ stops closest to point_ by geo::ComputeHaversineDistance, nearest first; equally
+        // distant stops go in id order.
+        std::vector<Neighbour> FindNearest(geo::Coordinates point_, size_t count_) const;
+
+        // Stops at most radius_ meters from point_, nearest first; equally distant stops go in id order.
+        std::vector<Neighbour> FindWithin(geo::Coordinates point_, double radius_) const;
+
+        // Stops with min_.latitude <= latitude <= max_.latitude and min_.longitude <= longitude <= max_.longitude,
+        // in no particular order.
+        std::vector<StopId> FindInBox(geo::Coordinates min_, geo::Coordinates max_) const;
+
+    private:
+
+        static constexpr size_t POINTS_PER_CELL = 4;
+
+        geo::Coordinates min_corner;
+        geo::Coordinates max_corner;
+        double latitude_step = 1.0;
+        double longitude_step = 1.0;
+        int rows = 0;
+        int columns = 0;
+
+        // The stops of cell c are ids[cell_begin[c] .. cell_begin[c + 1]), at points of the same indices.
+        std::vector<uint32_t> cell_begin;
+        std::vector<StopId> ids;
+        std::vector<geo::Coordinates> points;
+
+        int GetRow(double latitude_) const;
+        int GetColumn(double longitude_) const;
+
+        double GetRingBound(geo::Coordinates point_, int row_, int column_, int ring_) const;
+
+        // Calls visit_(row, column) for the cells of ring 0, 1, 2... around the cell of point_ for as long as
+        // keep_going_(bound) holds, bound being the least distance from point_ to a cell of the next ring.
+        template <typename Visit, typename KeepGoing>
+        void VisitRings(geo::Coordinates point_, Visit visit_, KeepGoing keep_going_) const;
+    };
+
+}//end namespace transport
\ No newline at end of file
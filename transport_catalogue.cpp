@@ -1,178 +1,454 @@
 #include "transport_catalogue.h"
 
 #include <execution>
+#include <numeric>
 
 namespace transport
 {
-    void TransportCatalogue::AddStop(Stop stop_)
+    // Items are stops or buses, ordered by their names in names_.
+    template <typename Item>
+    void InsertSorted(std::vector<const Item*>& items_, const Item* item_, const NameTable& names_)
     {
-        stops.push_back(std::move(stop_));
-        Stop* stop_buf = &stops.back();
+        const auto position = std::lower_bound(items_.begin(), items_.end(), item_, [&names_](const Item* lhs_, const Item* rhs_)
+            {
+                return names_.Get(lhs_->id) < names_.Get(rhs_->id);
+            });
+        items_.insert(position, item_);
+    }
 
-        stopname_to_stop.insert(transport::StopMap::value_type(stop_buf->name, stop_buf));
+    // The first item of every name, sorted by name.
+    template <typename Item>
+    std::vector<const Item*> SortByName(const std::deque<Item>& items_, const NameTable& names_)
+    {
+        std::vector<const Item*> sorted_items;
+        sorted_items.reserve(names_.GetUniqCount());
+
+        for (const Item& item : items_)
+        {
+            if (names_.Find(names_.Get(item.id)) == item.id)
+            {
+                sorted_items.push_back(&item);
+            }
+        }
+        std::sort(sorted_items.begin(), sorted_items.end(), [&names_](const Item* lhs_, const Item* rhs_)
+            {
+                return names_.Get(lhs_->id) < names_.Get(rhs_->id);
+            });
+        return sorted_items;
     }
 
-    void TransportCatalogue::AddBus(Bus bus_)
+    void TransportCatalogue::AddStop(std::string_view name_, geo::Coordinates coordinates_)
     {
-        Bus* bus_buf;
+        Stop& stop = stops.emplace_back();
 
+        stop.id = static_cast<StopId>(stop_names.GetSize());
+        stop_names.Add(name_);
+        stop_coordinates.push_back(coordinates_);
+        stop_name_index = perfect_hash::NameIndex();
+
+        if (is_sorted && stop_names.Find(name_) == stop.id)
+        {
+            InsertSorted(sorted_stops, &stop, stop_names);
+        }
+        UpdateVersion();
+    }
+
+    void TransportCatalogue::AddBus(std::string_view name_, Bus bus_, const std::vector<StopId>& stop_ids_)
+    {
+        // An unknown stop throws before anything is added.
+        for (const StopId stop_id : stop_ids_)
+        {
+            stops.at(stop_id);
+        }
+
+        bus_.id = static_cast<BusId>(bus_names.GetSize());
         buses.push_back(std::move(bus_));
-        bus_buf = &buses.back();
+        bus_names.Add(name_);
 
-        busname_to_bus.insert(BusMap::value_type(bus_buf->name, bus_buf));
+        const Bus& bus = buses.back();
 
-        for (Stop* stop : bus_buf->stops)
+        if (is_sorted && bus_names.Find(name_) == bus.id)
         {
-            stop->buses.push_back(bus_buf);
+            InsertSorted(sorted_buses, &bus, bus_names);
         }
 
-        bus_buf->route_length = GetDistanceToBus(bus_buf);
+        bus_name_index = perfect_hash::NameIndex();
+        are_stop_buses_built = false;
+
+        bus_stop_ids.insert(bus_stop_ids.end(), stop_ids_.begin(), stop_ids_.end());
+        bus_stops_begin.push_back(static_cast<uint32_t>(bus_stop_ids.size()));
+        bus_route_distances.resize(bus_stop_ids.size());
+
+        UpdateRouteDistances(bus.id);
+        buses.back().unique_stops = CountUniqStops(bus.id);
+        buses.back().geo_length = GetLength(bus.id);
+        UpdateVersion();
     }
 
+    // Distances are normally all given before the buses. One that comes later changes the road distances
+    // along the buses through its stops, which are found by a walk over all routes and counted again here.
     void TransportCatalogue::AddDistance(const std::vector<Distance>& distances_)
     {
+        std::vector<bool> is_changed_stop(buses.empty() ? 0 : stops.size(), false);
+
         for (const Distance& distance : distances_)
         {
-            auto dist_pair = std::make_pair(distance.start, distance.end);
-            distance_to_stop.insert(DistanceMap::value_type(dist_pair, distance.distance));
+            distance_to_stop.Set(distance.start->id, distance.end->id, distance.distance);
+
+            if (!buses.empty())
+            {
+                is_changed_stop[distance.start->id] = true;
+            }
+        }
+
+        for (const Bus& bus : buses)
+        {
+            const ranges::Range<const StopId*> stop_ids = GetBusStopIds(bus.id);
+
+            if (std::any_of(stop_ids.begin(), stop_ids.end(), [&is_changed_stop](StopId id_) { return is_changed_stop[id_]; }))
+            {
+                UpdateRouteDistances(bus.id);
+            }
+        }
+        UpdateVersion();
+    }
+
+    void TransportCatalogue::UpdateRouteDistances(BusId id_)
+    {
+        const uint32_t begin = bus_stops_begin[id_];
+        const uint32_t end = bus_stops_begin[id_ + 1];
+        size_t distance = 0;
+
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            if (i > begin)
+            {
+                distance += GetDistanceStop(bus_stop_ids[i - 1], bus_stop_ids[i]);
+            }
+            bus_route_distances[i] = distance;
         }
+        buses[id_].route_length = distance;
     }
 
-    Bus* TransportCatalogue::GetBus(const std::string_view bus_name_)
+    void TransportCatalogue::BuildIndexes()
     {
-        if (busname_to_bus.empty())
+        if (stop_name_index.IsEmpty() && stop_names.GetUniqCount() == stop_names.GetSize())
         {
-            return nullptr;
+            stop_name_index = perfect_hash::NameIndex(stop_names.GetNames());
         }
-        try
+
+        if (bus_name_index.IsEmpty() && bus_names.GetUniqCount() == bus_names.GetSize())
+        {
+            bus_name_index = perfect_hash::NameIndex(bus_names.GetNames());
+        }
+
+        if (!is_sorted)
         {
-            return busname_to_bus.at(bus_name_);
+            sorted_stops = SortByName(stops, stop_names);
+            sorted_buses = SortByName(buses, bus_names);
+            is_sorted = true;
         }
-        catch (const std::out_of_range& e)
+
+        if (!are_stop_buses_built || stop_buses_begin.size() != stops.size() + 1)
         {
-            return nullptr;
+            BuildStopBuses();
+        }
+
+        if (stop_grid.GetSize() != stop_coordinates.size())
+        {
+            stop_grid = SpatialIndex(stop_coordinates);
         }
     }
 
-    Stop* TransportCatalogue::GetStop(const std::string_view stop_name_)
+    // Routes are walked in bus name order, ids breaking ties, and every bus is appended to the stops it
+    // passes unless a bus of the same name is already last there; this leaves the buses of each stop
+    // sorted by name, one per name, without sorting them stop by stop.
+    void TransportCatalogue::BuildStopBuses()
     {
-        if (stopname_to_stop.empty())
+        std::vector<BusId> name_order(buses.size());
+        std::iota(name_order.begin(), name_order.end(), 0);
+
+        std::stable_sort(name_order.begin(), name_order.end(), [this](BusId lhs_, BusId rhs_)
+            {
+                return bus_names.Get(lhs_) < bus_names.Get(rhs_);
+            });
+
+        // Room for every pass of a route through a stop; repeats leave gaps that are closed below.
+        std::vector<uint32_t> slots_begin(stops.size() + 1, 0);
+
+        for (const StopId stop_id : bus_stop_ids)
         {
-            return nullptr;
+            ++slots_begin[stop_id + 1];
         }
-        try
+        std::partial_sum(slots_begin.begin(), slots_begin.end(), slots_begin.begin());
+
+        std::vector<BusId> slots(bus_stop_ids.size());
+        std::vector<uint32_t> slots_end(slots_begin.begin(), std::prev(slots_begin.end()));
+
+        for (const BusId bus_id : name_order)
         {
-            return stopname_to_stop.at(stop_name_);
+            for (const StopId stop_id : GetBusStopIds(bus_id))
+            {
+                uint32_t& end = slots_end[stop_id];
+
+                if (end == slots_begin[stop_id] || (slots[end - 1] != bus_id && bus_names.Get(slots[end - 1]) != bus_names.Get(bus_id)))
+                {
+                    slots[end++] = bus_id;
+                }
+            }
         }
-        catch (const std::out_of_range& e)
+
+        stop_bus_ids.clear();
+        stop_buses_begin.assign(1, 0);
+
+        for (StopId stop_id = 0; stop_id < stops.size(); ++stop_id)
         {
-            return nullptr;
+            stop_bus_ids.insert(stop_bus_ids.end(), slots.begin() + slots_begin[stop_id], slots.begin() + slots_end[stop_id]);
+            stop_buses_begin.push_back(static_cast<uint32_t>(stop_bus_ids.size()));
         }
+
+        are_stop_buses_built = true;
     }
 
-    BusMap TransportCatalogue::GetBusnameToBus() const
+    const Bus* TransportCatalogue::GetBus(const std::string_view bus_name_) const
     {
-        return busname_to_bus;
+        const uint32_t id = bus_name_index.IsEmpty() ? bus_names.Find(bus_name_) : bus_name_index.Find(bus_name_);
+
+        return id != perfect_hash::EMPTY_SLOT ? &buses[id] : nullptr;
     }
 
-    StopMap TransportCatalogue::GetStopnameToStop() const
+    const Stop* TransportCatalogue::GetStop(const std::string_view stop_name_) const
     {
-        return stopname_to_stop;
+        const uint32_t id = stop_name_index.IsEmpty() ? stop_names.Find(stop_name_) : stop_name_index.Find(stop_name_);
+
+        return id != perfect_hash::EMPTY_SLOT ? &stops[id] : nullptr;
     }
 
-    std::unordered_set<const Stop*> TransportCatalogue::GetUniqStops(Bus* bus_)
+    const std::deque<Stop>& TransportCatalogue::GetStops() const
     {
-        std::unordered_set<const Stop*> unique_stops;
+        return stops;
+    }
 
-        unique_stops.insert(bus_->stops.begin(), bus_->stops.end());
+    const std::deque<Bus>& TransportCatalogue::GetBuses() const
+    {
+        return buses;
+    }
 
-        return unique_stops;
+    ranges::Range<const Stop* const*> TransportCatalogue::GetSortedStops() const
+    {
+        return { sorted_stops.data(), sorted_stops.data() + sorted_stops.size() };
     }
 
-    double TransportCatalogue::GetLength(Bus* bus_)
+    ranges::Range<const Bus* const*> TransportCatalogue::GetSortedBuses() const
     {
-        return transform_reduce(next(bus_->stops.begin()), bus_->stops.end(), bus_->stops.begin(), 0.0, std::plus<>{}, [](const Stop* lhs, const Stop* rhs)
-            {
-                return geo::ComputeDistance({ (*lhs).latitude, (*lhs).longitude }, { (*rhs).latitude, (*rhs).longitude });
-            });
+        return { sorted_buses.data(), sorted_buses.data() + sorted_buses.size() };
+    }
+
+    const DistanceTable& TransportCatalogue::GetDistances() const
+    {
+        return distance_to_stop;
     }
 
-    std::unordered_set<const Bus*> TransportCatalogue::StopGetUniqBuses(Stop* stop_)
+    size_t TransportCatalogue::GetStopCount() const
     {
-        std::unordered_set<const Bus*> unique_stops;
+        return stops.size();
+    }
+
+    size_t TransportCatalogue::GetBusCount() const
+    {
+        return buses.size();
+    }
 
-        unique_stops.insert(stop_->buses.begin(), stop_->buses.end());
+    const Stop& TransportCatalogue::GetStopById(StopId id_) const
+    {
+        return stops.at(id_);
+    }
 
-        return unique_stops;
+    const Bus& TransportCatalogue::GetBusById(BusId id_) const
+    {
+        return buses.at(id_);
     }
 
-    size_t TransportCatalogue::GetDistanceStop(const Stop* start_, const Stop* finish_) const
+    std::string_view TransportCatalogue::GetStopName(StopId id_) const
     {
-        if (distance_to_stop.count({ start_, finish_ }))
+        return stop_names.Get(id_);
+    }
+
+    std::string_view TransportCatalogue::GetBusName(BusId id_) const
+    {
+        return bus_names.Get(id_);
+    }
+
+    const geo::Coordinates& TransportCatalogue::GetStopCoordinates(StopId id_) const
+    {
+        return stop_coordinates.at(id_);
+    }
+
+    ranges::Range<const StopId*> TransportCatalogue::GetBusStopIds(BusId id_) const
+    {
+        const StopId* data = bus_stop_ids.data();
+
+        return { data + bus_stops_begin.at(id_), data + bus_stops_begin.at(id_ + 1) };
+    }
+
+    ranges::Range<const BusId*> TransportCatalogue::GetStopBusIds(StopId id_) const
+    {
+        if (size_t(id_) + 1 >= stop_buses_begin.size())
         {
-            return distance_to_stop.at({ start_, finish_ });
+            return { nullptr, nullptr };
         }
-        else if (distance_to_stop.count({ finish_, start_ }))
+
+        const BusId* data = stop_bus_ids.data();
+
+        return { data + stop_buses_begin[id_], data + stop_buses_begin[id_ + 1] };
+    }
+
+    ranges::Range<const size_t*> TransportCatalogue::GetBusRouteDistances(BusId id_) const
+    {
+        const size_t* data = bus_route_distances.data();
+
+        return { data + bus_stops_begin.at(id_), data + bus_stops_begin.at(id_ + 1) };
+    }
+
+    size_t TransportCatalogue::CountUniqStops(BusId id_) const
+    {
+        const ranges::Range<const StopId*> stop_ids = GetBusStopIds(id_);
+        std::vector<StopId> unique_stops(stop_ids.begin(), stop_ids.end());
+
+        std::sort(unique_stops.begin(), unique_stops.end());
+
+        return static_cast<size_t>(std::unique(unique_stops.begin(), unique_stops.end()) - unique_stops.begin());
+    }
+
+    double TransportCatalogue::GetLength(BusId id_) const
+    {
+        const ranges::Range<const StopId*> stop_ids = GetBusStopIds(id_);
+
+        if (stop_ids.begin() == stop_ids.end())
         {
-            return distance_to_stop.at({ finish_, start_ });
+            return 0.0;
         }
-        else
+        return std::transform_reduce(std::next(stop_ids.begin()), stop_ids.end(), stop_ids.begin(), 0.0, std::plus<>{}, [this](StopId lhs, StopId rhs)
+            {
+                return geo::ComputeDistance(stop_coordinates[lhs], stop_coordinates[rhs]);
+            });
+    }
+
+    size_t TransportCatalogue::GetDistanceStop(const Stop* start_, const Stop* finish_) const
+    {
+        return GetDistanceStop(start_->id, finish_->id);
+    }
+
+    size_t TransportCatalogue::GetDistanceStop(StopId start_, StopId finish_) const
+    {
+        return distance_to_stop.Get(start_, finish_);
+    }
+
+    size_t TransportCatalogue::GetDistanceToBus(const Bus* bus_) const
+    {
+        const uint32_t end = bus_stops_begin[bus_->id + 1];
+
+        return end > bus_stops_begin[bus_->id] ? bus_route_distances[end - 1] : 0;
+    }
+
+    std::vector<geo::Coordinates> TransportCatalogue::GetStopCoordinates() const
+    {
+        std::vector<geo::Coordinates> stops_coordinates;
+        stops_coordinates.reserve(bus_stop_ids.size());
+
+        for (const StopId id : bus_stop_ids)
         {
-            return 0;
+            stops_coordinates.push_back(stop_coordinates[id]);
         }
+        return stops_coordinates;
     }
 
-    size_t TransportCatalogue::GetDistanceToBus(Bus* bus_)
+    std::vector<SpatialIndex::Neighbour> TransportCatalogue::GetNearestStops(geo::Coordinates point_, size_t count_) const
     {
-        size_t distance = 0;
-        size_t stops_size = bus_->stops.size() - 1;
+        std::vector<SpatialIndex::Neighbour> nearest = stop_grid.FindNearest(point_, count_);
+
+        if (stop_grid.GetSize() == stop_coordinates.size())
+        {
+            return nearest;
+        }
 
-        for (size_t i = 0; i < stops_size; i++)
+        for (size_t id = stop_grid.GetSize(); id < stop_coordinates.size(); ++id)
         {
-            distance += GetDistanceStop(bus_->stops[i], bus_->stops[i + 1]);
+            nearest.push_back({ static_cast<StopId>(id), geo::ComputeHaversineDistance(point_, stop_coordinates[id]) });
         }
-        return distance;
+        std::sort(nearest.begin(), nearest.end(), [](const SpatialIndex::Neighbour& lhs_, const SpatialIndex::Neighbour& rhs_)
+            {
+                return lhs_.distance < rhs_.distance || (lhs_.distance == rhs_.distance && lhs_.id < rhs_.id);
+            });
+        nearest.resize(std::min(nearest.size(), count_));
+
+        return nearest;
     }
 
-    std::vector<geo::Coordinates> TransportCatalogue::GetStopCoordinates() const
+    std::vector<SpatialIndex::Neighbour> TransportCatalogue::GetStopsWithin(geo::Coordinates point_, double radius_) const
     {
-        std::vector<geo::Coordinates> stops_coordinates;
-        transport::BusMap buses = GetBusnameToBus();
+        std::vector<SpatialIndex::Neighbour> found = stop_grid.FindWithin(point_, radius_);
 
-        for (const auto& [_, bus] : buses)
+        if (stop_grid.GetSize() == stop_coordinates.size())
         {
-            for (const auto& stop : bus->stops)
-            {
-                geo::Coordinates coordinates;
-                coordinates.latitude = stop->latitude;
-                coordinates.longitude = stop->longitude;
+            return found;
+        }
 
-                stops_coordinates.push_back(coordinates);
+        for (size_t id = stop_grid.GetSize(); id < stop_coordinates.size(); ++id)
+        {
+            const double distance = geo::ComputeHaversineDistance(point_, stop_coordinates[id]);
+
+            if (distance <= radius_)
+            {
+                found.push_back({ static_cast<StopId>(id), distance });
             }
         }
-        return stops_coordinates;
+        std::sort(found.begin(), found.end(), [](const SpatialIndex::Neighbour& lhs_, const SpatialIndex::Neighbour& rhs_)
+            {
+                return lhs_.distance < rhs_.distance || (lhs_.distance == rhs_.distance && lhs_.id < rhs_.id);
+            });
+
+        return found;
     }
 
-    std::vector<std::string_view> TransportCatalogue::GetSortedBusesNames() const
+    std::vector<StopId> TransportCatalogue::GetStopsInBox(geo::Coordinates min_, geo::Coordinates max_) const
     {
-        std::vector<std::string_view> buses_names;
+        std::vector<StopId> found = stop_grid.FindInBox(min_, max_);
 
-        transport::BusMap buses = GetBusnameToBus();
-        if (buses.size() > 0)
+        for (size_t id = stop_grid.GetSize(); id < stop_coordinates.size(); ++id)
         {
-            for (const auto& [busname, _] : buses)
+            const geo::Coordinates& point = stop_coordinates[id];
+
+            if (point.latitude >= min_.latitude && point.latitude <= max_.latitude && point.longitude >= min_.longitude && point.longitude <= max_.longitude)
             {
-                buses_names.push_back(busname);
+                found.push_back(static_cast<StopId>(id));
             }
+        }
+        return found;
+    }
 
-            std::sort(buses_names.begin(), buses_names.end());
+    std::vector<std::string_view> TransportCatalogue::GetSortedBusesNames() const
+    {
+        std::vector<std::string_view> buses_names;
+        buses_names.reserve(sorted_buses.size());
 
-            return buses_names;
-        }
-        else
+        for (const Bus* bus : sorted_buses)
         {
-            return {};
+            buses_names.push_back(bus_names.Get(bus->id));
         }
+        return buses_names;
+    }
+
+    uint64_t TransportCatalogue::GetVersion() const
+    {
+        return version;
+    }
+
+    void TransportCatalogue::UpdateVersion()
+    {
+        static std::atomic<uint64_t> last_version{ 0 };
+
+        version = ++last_version;
     }
 
 }//end namespace transport
\ No newline at end of file
@@ -1,54 +1,138 @@
 #pragma once
 
 #include "domain.h"
+#include "distance_table.h"
+#include "name_table.h"
+#include "perfect_hash.h"
+#include "ranges.h"
+#include "spatial_index.h"
 
+#include <atomic>
+#include <cstdint>
 #include <deque>
 #include <string>
 #include <vector>
 #include <iomanip>
 #include <iostream>
-#include <unordered_set>
-#include <unordered_map>
 
 namespace transport
 {
-    typedef  std::unordered_map<std::string_view, Stop*> StopMap;
-    typedef  std::unordered_map<std::string_view, Bus*> BusMap;
-    typedef  std::unordered_map<std::pair<const Stop*, const  Stop*>, int, StopDistancesHasher> DistanceMap;
-
     class TransportCatalogue
     {
     public:
 
-        void AddBus(Bus bus_);
-        void AddStop(Stop stop_);
+        // stop_ids_ is the whole route of the bus, a non-roundtrip one there and back again.
+        void AddBus(std::string_view name_, Bus bus_, const std::vector<StopId>& stop_ids_);
+        void AddStop(std::string_view name_, geo::Coordinates coordinates_);
         void AddDistance(const std::vector<Distance>& distances_);
 
-        Bus* GetBus(const std::string_view bus_name_);
-        Stop* GetStop(const std::string_view stop_name_);
+        // Indexes the names of all stops and buses with a perfect hash, which GetStop and GetBus then use
+        // instead of the name tables, sorts the views of GetSortedStops and GetSortedBuses, lists the buses
+        // of GetStopBusIds and lays the stops out on the grid of GetNearestStops and GetStopsInBox; meant
+        // to be called once loading is done.
+        // Adding a stop or a bus drops the hash index of its kind until the next call, while the sorted
+        // views take it in place and stops added since the grid was built are checked one by one. Buses
+        // added since the last call are not listed by GetStopBusIds until the next one.
+        // Names that repeat are left unindexed.
+        void BuildIndexes();
+
+        // Lookups and the per-bus and per-stop queries below only read, so any number of threads may
+        // run them at once on a catalogue nobody is adding to. An unknown name gives nullptr, and of
+        // stops or buses with the same name the first added is found.
+        const Bus* GetBus(const std::string_view bus_name_) const;
+        const Stop* GetStop(const std::string_view stop_name_) const;
+
+        // Stops and buses in the order they were added, which is the order of their ids.
+        const std::deque<Stop>& GetStops() const;
+        const std::deque<Bus>& GetBuses() const;
+
+        // Stops and buses sorted by name, one per name. Empty until BuildIndexes is first called.
+        ranges::Range<const Stop* const*> GetSortedStops() const;
+        ranges::Range<const Bus* const*> GetSortedBuses() const;
+        const DistanceTable& GetDistances() const;
+
+        size_t GetStopCount() const;
+        size_t GetBusCount() const;
+
+        const Stop& GetStopById(StopId id_) const;
+        const Bus& GetBusById(BusId id_) const;
 
-        BusMap GetBusnameToBus() const;
-        StopMap GetStopnameToStop() const;
+        // Views of the names stay valid as long as the catalogue does.
+        std::string_view GetStopName(StopId id_) const;
+        std::string_view GetBusName(BusId id_) const;
 
-        std::unordered_set<const Bus*> StopGetUniqBuses(Stop* stop_);
-        std::unordered_set<const Stop*> GetUniqStops(Bus* bus_);
-        double GetLength(Bus* bus_);
+        const geo::Coordinates& GetStopCoordinates(StopId id_) const;
+        ranges::Range<const StopId*> GetBusStopIds(BusId id_) const;
 
-        size_t GetDistanceToBus(Bus* bus_);
+        // Buses through the stop, one per name and sorted by name; of buses with the same name, the first
+        // added among those through the stop. Empty until BuildIndexes is first called.
+        ranges::Range<const BusId*> GetStopBusIds(StopId id_) const;
+
+        // Road distance from the first stop of the route to each of its stops, so the distance
+        // between stop positions i and j of a bus is distances[j] - distances[i].
+        ranges::Range<const size_t*> GetBusRouteDistances(BusId id_) const;
+
+        size_t GetDistanceToBus(const Bus* bus_) const;
         size_t GetDistanceStop(const Stop* start_, const Stop* finish_) const;
+        size_t GetDistanceStop(StopId start_, StopId finish_) const;
 
         std::vector<geo::Coordinates> GetStopCoordinates() const;
+
+        // Up to count_ stops closest to point_, nearest first, with equally distant ones in id order.
+        std::vector<SpatialIndex::Neighbour> GetNearestStops(geo::Coordinates point_, size_t count_) const;
+
+        // Stops at most radius_ meters from point_, nearest first.
+        std::vector<SpatialIndex::Neighbour> GetStopsWithin(geo::Coordinates point_, double radius_) const;
+
+        // Stops within the latitude and longitude bounds of min_ and max_, inclusive, in no particular order.
+        std::vector<StopId> GetStopsInBox(geo::Coordinates min_, geo::Coordinates max_) const;
         std::vector<std::string_view> GetSortedBusesNames() const;
 
+        // Changes with every stop, bus or distance added. Versions are unique across all catalogues of
+        // the process, so equal versions mean the same catalogue in the same state.
+        uint64_t GetVersion() const;
+
     private:
 
+        // Stops and buses never move once added, so pointers to them stay valid; the rest of their
+        // data is kept in the arrays below, indexed by StopId and BusId.
         std::deque<Stop> stops;
-        StopMap stopname_to_stop;
-
         std::deque<Bus> buses;
-        BusMap busname_to_bus;
 
-        DistanceMap distance_to_stop;
+        NameTable stop_names;
+        NameTable bus_names;
+        std::vector<geo::Coordinates> stop_coordinates;
+
+        perfect_hash::NameIndex stop_name_index;
+        perfect_hash::NameIndex bus_name_index;
+
+        std::vector<const Stop*> sorted_stops;
+        std::vector<const Bus*> sorted_buses;
+        bool is_sorted = false;
+
+        SpatialIndex stop_grid;
+
+        // The stop ids of bus i are bus_stop_ids[bus_stops_begin[i] .. bus_stops_begin[i + 1]).
+        std::vector<StopId> bus_stop_ids;
+        std::vector<uint32_t> bus_stops_begin{ 0 };
+
+        // Prefix sums of road distances along the routes, laid out like bus_stop_ids.
+        std::vector<size_t> bus_route_distances;
+
+        // The buses of GetStopBusIds for stop i are stop_bus_ids[stop_buses_begin[i] .. stop_buses_begin[i + 1]).
+        std::vector<BusId> stop_bus_ids;
+        std::vector<uint32_t> stop_buses_begin{ 0 };
+        bool are_stop_buses_built = false;
+
+        DistanceTable distance_to_stop;
+
+        uint64_t version = 0;
+
+        void UpdateVersion();
+        void UpdateRouteDistances(BusId id_);
+        void BuildStopBuses();
+        size_t CountUniqStops(BusId id_) const;
+        double GetLength(BusId id_) const;
     };
 
 } //end namespace transport
\ No newline at end of file
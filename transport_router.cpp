@@ -2,6 +2,72 @@
 
 namespace router
 {
+    // Turns the graph edges of a found route into response items: a board, ride..., alight run of the
+    // ride-chain model becomes a single BusEdge, just like one pairwise bus edge would.
+    struct RouteInfoCollector
+    {
+        RouteInfo& route_info;
+        std::optional<BusEdge> bus_ride;
+
+        void operator()(const StopEdge& edge_)
+        {
+            route_info.edges.emplace_back(edge_);
+        }
+
+        void operator()(const BusEdge& edge_)
+        {
+            route_info.edges.emplace_back(edge_);
+        }
+
+        void operator()(const BoardEdge& edge_)
+        {
+            bus_ride = BusEdge{ edge_.bus_name, 0, 0 };
+        }
+
+        // A restored graph may hold rides with no board before them; those are left out.
+        void operator()(const RideEdge& edge_)
+        {
+            if (bus_ride)
+            {
+                ++bus_ride->span_count;
+                bus_ride->time += edge_.time;
+            }
+        }
+
+        void operator()(const AlightEdge&)
+        {
+            // Boarding and alighting at the same stop is not a ride at all.
+            if (bus_ride && bus_ride->span_count > 0)
+            {
+                route_info.edges.emplace_back(*bus_ride);
+            }
+            bus_ride.reset();
+        }
+    };
+
+    TransportRouter::TransportRouter(RoutingSettings routing_settings_, StopToRouter stop_to_router_, EdgeIdToEdge edge_id_to_edge_, DirectedWeightedGraph<double> graph_, Router<double>::RouterData router_data_, ConnectionScan::TimetableData timetable_data_) : stop_to_router(std::move(stop_to_router_)), edge_id_to_edge(std::move(edge_id_to_edge_))
+    {
+        using namespace std::string_literals;
+
+        SetRoutingSettings(std::move(routing_settings_));
+
+        if (edge_id_to_edge.size() != graph_.GetEdgeCount())
+        {
+            throw std::invalid_argument("route edges do not match the graph"s);
+        }
+
+        for (const StopVertexPair& vertices : stop_to_router)
+        {
+            if (vertices.bus_wait_start >= graph_.GetVertexCount() || vertices.bus_wait_end >= graph_.GetVertexCount())
+            {
+                throw std::invalid_argument("stop vertices do not match the graph"s);
+            }
+        }
+
+        graph = std::make_unique<DirectedWeightedGraph<double>>(std::move(graph_));
+        router = std::make_unique<Router<double>>(*graph, std::move(router_data_));
+        timetable = std::make_unique<ConnectionScan>(std::move(timetable_data_), stop_to_router.size());
+    }
 
     void TransportRouter::SetRoutingSettings(RoutingSettings routing_settings_)
     {
@@ -13,11 +79,11 @@ namespace router
         return routing_settings;
     }
 
-    void TransportRouter::BuildRouter(TransportCatalogue& transport_catalogue_)
+    void TransportRouter::BuildRouter(const TransportCatalogue& transport_catalogue_)
     {
         SetGraph(transport_catalogue_);
-        router = std::make_unique<Router<double>>(*graph);
-        router->Build();
+        router = std::make_unique<Router<double>>(*graph, routing_settings.router_mode);
+        SetTimetable(transport_catalogue_);
     }
 
     const DirectedWeightedGraph<double>& TransportRouter::GetGraph() const
@@ -30,16 +96,21 @@ namespace router
         return *router;
     }
 
-    const std::variant<StopEdge, BusEdge>& TransportRouter::GetEdge(EdgeId id_) const
+    const ConnectionScan& TransportRouter::GetTimetable() const
+    {
+        return *timetable;
+    }
+
+    const RouterEdge& TransportRouter::GetEdge(EdgeId id_) const
     {
         return edge_id_to_edge.at(id_);
     }
 
-    std::optional<StopVertexPair> TransportRouter::GetRouterByStop(Stop* stop_) const
+    std::optional<StopVertexPair> TransportRouter::GetRouterByStop(const Stop* stop_) const
     {
-        if (stop_to_router.count(stop_))
+        if (stop_ != nullptr && stop_->id < stop_to_router.size())
         {
-            return stop_to_router.at(stop_);
+            return stop_to_router[stop_->id];
         }
         else
         {
@@ -55,9 +126,11 @@ namespace router
             RouteInfo result;
             result.total_time = route_info->weight;
 
+            RouteInfoCollector collector{ result, std::nullopt };
+
             for (const auto edge : route_info->edges) 
             {
-                result.edges.emplace_back(GetEdge(edge));
+                std::visit(collector, GetEdge(edge));
             }
             return result;
         }
@@ -67,6 +140,118 @@ namespace router
         }
     }
 
+    std::optional<RouteInfo> TransportRouter::GetRouterInfo(const TransportCatalogue& catalogue_, const RoutePoint& from_, const RoutePoint& to_) const
+    {
+        const std::vector<SpatialIndex::Neighbour> from_walks = GetWalks(catalogue_, from_);
+        const std::vector<SpatialIndex::Neighbour> to_walks = GetWalks(catalogue_, to_);
+
+        std::vector<Terminal<double>> sources;
+        std::vector<Terminal<double>> targets;
+
+        for (const SpatialIndex::Neighbour& walk : from_walks)
+        {
+            sources.push_back({ stop_to_router[walk.id].bus_wait_start, GetWalkTime(walk.distance) });
+        }
+        for (const SpatialIndex::Neighbour& walk : to_walks)
+        {
+            targets.push_back({ stop_to_router[walk.id].bus_wait_start, GetWalkTime(walk.distance) });
+        }
+
+        std::optional<RouteInfo> result;
+        const auto route = router->BuildRoute(sources, targets);
+
+        if (route)
+        {
+            result = RouteInfo{ route->weight, {} };
+
+            if (std::holds_alternative<geo::Coordinates>(from_))
+            {
+                result->edges.emplace_back(MakeWalk(from_walks, route->from));
+            }
+
+            RouteInfoCollector collector{ *result, std::nullopt };
+
+            for (const auto edge : route->edges)
+            {
+                std::visit(collector, GetEdge(edge));
+            }
+
+            if (std::holds_alternative<geo::Coordinates>(to_))
+            {
+                result->edges.emplace_back(MakeWalk(to_walks, route->to));
+            }
+        }
+
+        if (std::holds_alternative<geo::Coordinates>(from_) && std::holds_alternative<geo::Coordinates>(to_))
+        {
+            const double distance = geo::ComputeHaversineDistance(std::get<geo::Coordinates>(from_), std::get<geo::Coordinates>(to_));
+            const double time = GetWalkTime(distance);
+
+            if (distance <= routing_settings.max_walking_distance && (!result || time <= result->total_time))
+            {
+                result = RouteInfo{ time, { WalkEdge{ distance, time } } };
+            }
+        }
+        return result;
+    }
+
+    std::optional<RouteInfo> TransportRouter::GetTimetableRouteInfo(const TransportCatalogue& catalogue_, const Stop* from_, const Stop* to_, double departure_time_) const
+    {
+        if (from_ == nullptr || to_ == nullptr)
+        {
+            return std::nullopt;
+        }
+
+        const auto journey = timetable->FindEarliestArrival(from_->id, to_->id, departure_time_);
+
+        if (!journey)
+        {
+            return std::nullopt;
+        }
+
+        RouteInfo result{ journey->arrival - departure_time_, {} };
+        double time = departure_time_;
+
+        for (const ConnectionScan::Leg& leg : journey->legs)
+        {
+            result.edges.emplace_back(StopEdge{ catalogue_.GetStopName(leg.from), leg.departure - time });
+            result.edges.emplace_back(BusEdge{ catalogue_.GetBusName(leg.bus), leg.span_count, leg.arrival - leg.departure });
+            time = leg.arrival;
+        }
+        return result;
+    }
+
+    std::vector<SpatialIndex::Neighbour> TransportRouter::GetWalks(const TransportCatalogue& transport_catalogue_, const RoutePoint& point_) const
+    {
+        if (const Stop* const* stop = std::get_if<const Stop*>(&point_))
+        {
+            if (*stop == nullptr || (*stop)->id >= stop_to_router.size())
+            {
+                return {};
+            }
+            return { SpatialIndex::Neighbour{ (*stop)->id, 0.0 } };
+        }
+
+        std::vector<SpatialIndex::Neighbour> walks = transport_catalogue_.GetStopsWithin(std::get<geo::Coordinates>(point_), routing_settings.max_walking_distance);
+
+        walks.erase(std::remove_if(walks.begin(), walks.end(), [this](const SpatialIndex::Neighbour& walk_)
+            {
+                return walk_.id >= stop_to_router.size();
+            }), walks.end());
+
+        return walks;
+    }
+
+    WalkEdge TransportRouter::MakeWalk(const std::vector<SpatialIndex::Neighbour>& walks_, VertexId vertex_) const
+    {
+        const auto walk = std::find_if(walks_.begin(), walks_.end(), [this, vertex_](const SpatialIndex::Neighbour& walk_)
+            {
+                return stop_to_router[walk_.id].bus_wait_start == vertex_;
+            });
+
+        return WalkEdge{ walk->distance, GetWalkTime(walk->distance) };
+    }
+
     const StopToRouter& TransportRouter::GetStopToVertex() const
     {
         return stop_to_router;
@@ -77,86 +262,176 @@ namespace router
         return edge_id_to_edge;
     }
 
-    std::deque<Stop*> TransportRouter::GetStopsPtr(TransportCatalogue& transport_catalogue_)
+    void TransportRouter::SetStops(size_t stops_count_)
     {
-        std::deque<Stop*> stops_ptr;
+        stop_to_router.resize(stops_count_);
 
-        for (const auto& [_, stop_ptr] : transport_catalogue_.GetStopnameToStop())
+        for (size_t i = 0; i < stops_count_; ++i)
         {
-            stops_ptr.push_back(stop_ptr);
+            stop_to_router[i] = StopVertexPair{ 2 * i, 2 * i + 1 };
         }
+    }
+
+    void TransportRouter::AddEdgeToStop(const TransportCatalogue& transport_catalogue_)
+    {
+        for (const Stop& stop : transport_catalogue_.GetStops())
+        {
+            const StopVertexPair& num = stop_to_router[stop.id];
 
-        return stops_ptr;
+            AddEdge(Edge<double>{num.bus_wait_start, num.bus_wait_end, routing_settings.bus_wait_time}, StopEdge{ transport_catalogue_.GetStopName(stop.id), routing_settings.bus_wait_time });
+        }
     }
 
-    std::deque<Bus*> TransportRouter::GetBusPtr(TransportCatalogue& transport_catalogue_)
+    void TransportRouter::AddEdgeToBus(const TransportCatalogue& transport_catalogue_)
     {
-        std::deque<Bus*> buses_ptr;
+        VertexId ride_vertex = 2 * stop_to_router.size();
 
-        for (const auto& [_, bus_ptr] : transport_catalogue_.GetBusnameToBus())
+        // A non-roundtrip bus already stores its stops there and back again, and that sequence reads
+        // the same in reverse, so a second pass over the reversed stops would only add duplicate edges.
+        for (const Bus& bus : transport_catalogue_.GetBuses())
         {
-            buses_ptr.push_back(bus_ptr);
+            if (routing_settings.bus_graph_model == BusGraphModel::PAIRWISE)
+            {
+                ParseBusToEdges(transport_catalogue_, bus);
+            }
+            else
+            {
+                AddRideChainToBus(transport_catalogue_, bus, ride_vertex);
+                ride_vertex += transport_catalogue_.GetBusStopIds(bus.id).size();
+            }
         }
-
-        return buses_ptr;
     }
 
-    void TransportRouter::SetStops(const std::deque<Stop*>& stops_)
+    void TransportRouter::ParseBusToEdges(const TransportCatalogue& transport_catalogue_, const Bus& bus_)
     {
-        size_t i = 0;
+        const StopId* stops = transport_catalogue_.GetBusStopIds(bus_.id).begin();
+        const size_t* distances = transport_catalogue_.GetBusRouteDistances(bus_.id).begin();
+        const size_t stops_count = transport_catalogue_.GetBusStopIds(bus_.id).size();
+        const std::string_view bus_name = transport_catalogue_.GetBusName(bus_.id);
 
-        for (const auto stop : stops_)
+        for (size_t i = 0; i < stops_count; ++i)
         {
-            VertexId first = i++;
-            VertexId second = i++;
+            for (size_t j = i + 1; j < stops_count; ++j)
+            {
+                const Edge<double> edge = MakeEdgeToBus(stops[i], stops[j], distances[j] - distances[i]);
 
-            stop_to_router[stop] = StopVertexPair{ first, second };
+                AddEdge(edge, BusEdge{ bus_name, j - i, edge.weight });
+            }
         }
     }
 
-    void TransportRouter::AddEdgeToStop()
+    void TransportRouter::AddRideChainToBus(const TransportCatalogue& transport_catalogue_, const Bus& bus_, VertexId first_vertex_)
     {
-        for (const auto& [stop, num] : stop_to_router)
+        const StopId* stops = transport_catalogue_.GetBusStopIds(bus_.id).begin();
+        const size_t* distances = transport_catalogue_.GetBusRouteDistances(bus_.id).begin();
+        const size_t stops_count = transport_catalogue_.GetBusStopIds(bus_.id).size();
+        const std::string_view bus_name = transport_catalogue_.GetBusName(bus_.id);
+
+        for (size_t i = 0; i < stops_count; ++i)
         {
-            EdgeId id = graph->AddEdge(Edge<double>{num.bus_wait_start, num.bus_wait_end, routing_settings.bus_wait_time});
+            const VertexId ride_vertex = first_vertex_ + i;
+            const StopVertexPair& stop_vertex = stop_to_router[stops[i]];
 
-            edge_id_to_edge[id] = StopEdge{ stop->name, routing_settings.bus_wait_time };
+            if (i + 1 < stops_count)
+            {
+                const double time = GetRideTime(distances[i + 1] - distances[i]);
+
+                AddEdge(Edge<double>{ stop_vertex.bus_wait_end, ride_vertex, 0 }, BoardEdge{ bus_name });
+                AddEdge(Edge<double>{ ride_vertex, ride_vertex + 1, time }, RideEdge{ time });
+            }
+            if (i > 0)
+            {
+                AddEdge(Edge<double>{ ride_vertex, stop_vertex.bus_wait_start, 0 }, AlightEdge{});
+            }
         }
     }
 
-    void TransportRouter::AddEdgeToBus(TransportCatalogue& transport_catalogue_)
+    void TransportRouter::SetGraph(const TransportCatalogue& transport_catalogue_)
     {
-        for (auto bus : GetBusPtr(transport_catalogue_))
-        {
-            ParseBusToEdges(bus->stops.begin(), bus->stops.end(), transport_catalogue_, bus);
+        const size_t stops_count = transport_catalogue_.GetStopCount();
+        size_t vertex_count = 2 * stops_count;
 
-            if (!bus->is_roundtrip)
+        if (routing_settings.bus_graph_model == BusGraphModel::RIDE_CHAIN)
+        {
+            for (const Bus& bus : transport_catalogue_.GetBuses())
             {
-                ParseBusToEdges(bus->stops.rbegin(), bus->stops.rend(), transport_catalogue_, bus);
+                vertex_count += transport_catalogue_.GetBusStopIds(bus.id).size();
             }
         }
+
+        graph = std::make_unique<DirectedWeightedGraph<double>>(vertex_count);
+
+        SetStops(stops_count);
+        AddEdgeToStop(transport_catalogue_);
+        AddEdgeToBus(transport_catalogue_);
+
+        graph->Freeze();
     }
 
-    void TransportRouter::SetGraph(TransportCatalogue& transport_catalogue_)
+    // Every departure of a bus is a trip over all of its stops, a non-roundtrip one there and back;
+    // the arrival at each stop is reckoned from the start of the trip, so rounding does not add up.
+    void TransportRouter::SetTimetable(const TransportCatalogue& transport_catalogue_)
     {
-        const auto stops_ptr_size = GetStopsPtr(transport_catalogue_).size();
+        ConnectionScan::TimetableData timetable_data;
 
-        graph = std::make_unique<DirectedWeightedGraph<double>>(2 * stops_ptr_size);
+        for (const Bus& bus : transport_catalogue_.GetBuses())
+        {
+            const StopId* stops = transport_catalogue_.GetBusStopIds(bus.id).begin();
+            const size_t* distances = transport_catalogue_.GetBusRouteDistances(bus.id).begin();
+            const size_t stops_count = transport_catalogue_.GetBusStopIds(bus.id).size();
 
-        SetStops(GetStopsPtr(transport_catalogue_));
-        AddEdgeToStop();
-        AddEdgeToBus(transport_catalogue_);
+            if (stops_count < 2)
+            {
+                continue;
+            }
+
+            for (const double departure : bus.departures)
+            {
+                const uint32_t trip = static_cast<uint32_t>(timetable_data.trip_buses.size());
+
+                timetable_data.trip_buses.push_back(bus.id);
+
+                for (size_t i = 0; i + 1 < stops_count; ++i)
+                {
+                    const double from_time = departure + GetRideTime(distances[i] - distances[0]);
+                    const double to_time = departure + GetRideTime(distances[i + 1] - distances[0]);
+
+                    timetable_data.connections.push_back({ from_time, to_time, stops[i], stops[i + 1], trip, static_cast<uint32_t>(i) });
+                }
+            }
+        }
+
+        timetable = std::make_unique<ConnectionScan>(std::move(timetable_data), stop_to_router.size());
     }
 
-    Edge<double> TransportRouter::MakeEdgeToBus(Stop* start_, Stop* end_, const double distance_) const
+    Edge<double> TransportRouter::MakeEdgeToBus(StopId start_, StopId end_, const double distance_) const
     {
         Edge<double> result;
 
-        result.from = stop_to_router.at(start_).bus_wait_end;
-        result.to = stop_to_router.at(end_).bus_wait_start;
-        result.weight = distance_ * 1.0 / (routing_settings.bus_velocity * KILOMETER / HOUR);
+        result.from = stop_to_router[start_].bus_wait_end;
+        result.to = stop_to_router[end_].bus_wait_start;
+        result.weight = GetRideTime(distance_);
 
         return result;
     }
 
+    double TransportRouter::GetRideTime(const double distance_) const
+    {
+        return distance_ * 1.0 / (routing_settings.bus_velocity * KILOMETER / HOUR);
+    }
+
+    double TransportRouter::GetWalkTime(const double distance_) const
+    {
+        return distance_ * 1.0 / (routing_settings.walking_velocity * KILOMETER / HOUR);
+    }
+
+    EdgeId TransportRouter::AddEdge(const Edge<double>& edge_, RouterEdge router_edge_)
+    {
+        const EdgeId id = graph->AddEdge(edge_);
+
+        edge_id_to_edge.push_back(std::move(router_edge_));
+
+        return id;
+    }
+
 }//end namespace router
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "connection_scan.h"
 #include "transport_catalogue.h"
 #include "router.h"
 #include "domain.h"
@@ -12,80 +13,88 @@
 
 namespace router
 {
+    using transport::SpatialIndex;
     using transport::TransportCatalogue;
     using namespace graph;
 
     static const uint16_t KILOMETER = 1000;
     static const uint16_t HOUR = 60;
 
-    typedef std::unordered_map<Stop*, StopVertexPair> StopToRouter;
-    typedef std::unordered_map<EdgeId, std::variant<StopEdge, BusEdge>> EdgeIdToEdge;
+    // Indexed by StopId: stop i waits for a bus from vertex 2 * i to vertex 2 * i + 1. Bus edges are added
+    // bus by bus in BusId order, so of routes equally fast the one picked depends only on the order in
+    // which stops and buses were added, not on how the catalogue hashes their names.
+    typedef std::vector<StopVertexPair> StopToRouter;
+    typedef std::vector<RouterEdge> EdgeIdToEdge;
+
+    // Start or end of a route: a stop, or coordinates to walk from or to.
+    using RoutePoint = std::variant<const Stop*, geo::Coordinates>;
 
     class TransportRouter
     {
     public:
 
-        TransportRouter(TransportCatalogue& catalogue_, RoutingSettings routing_settings_)
+        TransportRouter(const TransportCatalogue& catalogue_, RoutingSettings routing_settings_)
         {
             SetRoutingSettings(routing_settings_);
             BuildRouter(catalogue_);
         }
 
+        // Restores a router saved earlier from its parts instead of building the graph and routing data anew.
+        TransportRouter(RoutingSettings routing_settings_, StopToRouter stop_to_router_, EdgeIdToEdge edge_id_to_edge_, DirectedWeightedGraph<double> graph_, Router<double>::RouterData router_data_, ConnectionScan::TimetableData timetable_data_);
+
         const RoutingSettings& GetRoutingSettings() const;
 
-        std::optional<StopVertexPair> GetRouterByStop(Stop* stop_) const;
+        std::optional<StopVertexPair> GetRouterByStop(const Stop* stop_) const;
         std::optional<RouteInfo> GetRouterInfo(VertexId start, graph::VertexId end) const;
 
-    private:
-
-        StopToRouter stop_to_router;
-        EdgeIdToEdge edge_id_to_edge;
-
-        std::unique_ptr<DirectedWeightedGraph<double>> graph;
-        std::unique_ptr<Router<double>> router;
-
-        RoutingSettings routing_settings;
+        // Coordinates are joined by a walk to every stop within max_walking_distance of them, and to
+        // each other when that close; one search then runs from all the stops at the start to all
+        // those at the end. Stops added to the catalogue after the router was built are not used.
+        std::optional<RouteInfo> GetRouterInfo(const TransportCatalogue& catalogue_, const RoutePoint& from_, const RoutePoint& to_) const;
 
-        Edge<double> MakeEdgeToBus(Stop* start_, Stop* end_, const double distance_) const;
+        // Earliest arrival at to_ for a rider at from_ from departure_time_ on, by the timetabled trips of
+        // the buses alone: waits are those until the next departure, and bus_wait_time plays no part.
+        // Times are in minutes since midnight; total_time counts from departure_time_.
+        std::optional<RouteInfo> GetTimetableRouteInfo(const TransportCatalogue& catalogue_, const Stop* from_, const Stop* to_, double departure_time_) const;
 
         const DirectedWeightedGraph<double>& GetGraph() const;
         const Router<double>& GetRouter() const;
-        const std::variant<StopEdge, BusEdge>& GetEdge(EdgeId id_) const;
+        const ConnectionScan& GetTimetable() const;
 
         const StopToRouter& GetStopToVertex() const;
         const EdgeIdToEdge& GetEdgeIdToEdge() const;
 
-        std::deque<Stop*> GetStopsPtr(TransportCatalogue& transport_catalogue_);
-        std::deque<Bus*> GetBusPtr(TransportCatalogue& transport_catalogue_);
+    private:
 
-        void AddEdgeToStop();
-        void AddEdgeToBus(TransportCatalogue& transport_catalogue_);
+        StopToRouter stop_to_router;
+        EdgeIdToEdge edge_id_to_edge;
 
-        void SetStops(const std::deque<Stop*>& stops_);
-        void SetGraph(TransportCatalogue& transport_catalogue_);
+        std::unique_ptr<DirectedWeightedGraph<double>> graph;
+        std::unique_ptr<Router<double>> router;
+        std::unique_ptr<ConnectionScan> timetable;
 
-        void SetRoutingSettings(RoutingSettings routing_settings_);
-        void BuildRouter(TransportCatalogue& transport_catalogue_);
+        RoutingSettings routing_settings;
 
-        template <typename Iterator>
-        void ParseBusToEdges(Iterator first_, Iterator last_, const TransportCatalogue& transport_catalogue_, const Bus* bus_)
-        {
-            for (auto it = first_; it != last_; ++it)
-            {
-                size_t distance = 0;
-                size_t span = 0;
+        Edge<double> MakeEdgeToBus(StopId start_, StopId end_, const double distance_) const;
+        double GetRideTime(const double distance_) const;
+        double GetWalkTime(const double distance_) const;
+        std::vector<SpatialIndex::Neighbour> GetWalks(const TransportCatalogue& transport_catalogue_, const RoutePoint& point_) const;
+        WalkEdge MakeWalk(const std::vector<SpatialIndex::Neighbour>& walks_, VertexId vertex_) const;
+        EdgeId AddEdge(const Edge<double>& edge_, RouterEdge router_edge_);
 
-                for (auto it2 = std::next(it); it2 != last_; ++it2)
-                {
-                    distance += transport_catalogue_.GetDistanceStop(*prev(it2), *it2);
-                    ++span;
+        const RouterEdge& GetEdge(EdgeId id_) const;
 
-                    EdgeId id = graph->AddEdge(MakeEdgeToBus(*it, *it2, distance));
+        void AddEdgeToStop(const TransportCatalogue& transport_catalogue_);
+        void AddEdgeToBus(const TransportCatalogue& transport_catalogue_);
+        void ParseBusToEdges(const TransportCatalogue& transport_catalogue_, const Bus& bus_);
+        void AddRideChainToBus(const TransportCatalogue& transport_catalogue_, const Bus& bus_, VertexId first_vertex_);
 
-                    edge_id_to_edge[id] = BusEdge{ bus_->name, span, graph->GetEdge(id).weight };
-                }
-            }
-        }
+        void SetStops(size_t stops_count_);
+        void SetGraph(const TransportCatalogue& transport_catalogue_);
+        void SetTimetable(const TransportCatalogue& transport_catalogue_);
+
+        void SetRoutingSettings(RoutingSettings routing_settings_);
+        void BuildRouter(const TransportCatalogue& transport_catalogue_);
     };
 
 }//end namespace router
\ No newline at end of file